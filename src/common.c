@@ -1938,17 +1938,13 @@ byte *COM_LoadMallocFile (const char *path, unsigned int *path_id)
 	return COM_LoadFile (path, LOADFILE_MALLOC, path_id);
 }
 
-byte *COM_LoadMallocFile_TextMode_OSPath (const char *path, long *len_out)
+static byte *COM_LoadMallocFile_OSPathMode (const char *path, const char *mode, long *len_out)
 {
 	FILE	*f;
 	byte	*data;
 	long	len, actuallen;
 
-	// ericw -- this is used by Host_Loadgame_f. Translate CRLF to LF on load games,
-	// othewise multiline messages have a garbage character at the end of each line.
-	// TODO: could handle in a way that allows loading CRLF savegames on mac/linux
-	// without the junk characters appearing.
-	f = fopen (path, "rt");
+	f = fopen (path, mode);
 	if (f == NULL)
 		return NULL;
 
@@ -1982,6 +1978,20 @@ byte *COM_LoadMallocFile_TextMode_OSPath (const char *path, long *len_out)
 	return data;
 }
 
+byte *COM_LoadMallocFile_TextMode_OSPath (const char *path, long *len_out)
+{
+	// ericw -- this is used by Host_Loadgame_f. Translate CRLF to LF on load games,
+	// othewise multiline messages have a garbage character at the end of each line.
+	// TODO: could handle in a way that allows loading CRLF savegames on mac/linux
+	// without the junk characters appearing.
+	return COM_LoadMallocFile_OSPathMode (path, "rt", len_out);
+}
+
+byte *COM_LoadMallocFile_OSPath (const char *path, long *len_out)
+{
+	return COM_LoadMallocFile_OSPathMode (path, "rb", len_out);
+}
+
 const char *COM_ParseIntNewline(const char *buffer, int *value)
 {
 	int consumed = 0;
@@ -2572,6 +2582,219 @@ unsigned COM_HashString (const char *str)
 	return hash;
 }
 
+/*
+===============================================================================
+
+DEFLATE
+
+The bundled miniz only carries the inflater, so the writer side is a small
+single-block deflate encoder: greedy hash-chain matching over a 32K window
+and the fixed Huffman tables from RFC 1951.  It compresses engine-generated
+binary data well enough and any inflater, including tinfl, reads it back.
+===============================================================================
+*/
+
+#define	DEFL_WINDOW	32768
+#define	DEFL_HASHBITS	15
+#define	DEFL_MAXCHAIN	32
+#define	DEFL_MINMATCH	3
+#define	DEFL_MAXMATCH	258
+
+typedef struct
+{
+	byte		*out;
+	int		outlen;
+	unsigned int	bits;
+	int		numbits;
+} deflstream_t;
+
+static const unsigned short defl_lenbase[29] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+	35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const byte defl_lenextra[29] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+	3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const unsigned short defl_distbase[30] = {
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+	257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+static const byte defl_distextra[30] = {
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+	7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+static void Defl_PutBits (deflstream_t *s, unsigned int value, int count)
+{
+	s->bits |= value << s->numbits;
+	s->numbits += count;
+	while (s->numbits >= 8)
+	{
+		s->out[s->outlen++] = (byte)s->bits;
+		s->bits >>= 8;
+		s->numbits -= 8;
+	}
+}
+
+// Huffman codes go out most significant bit first
+static void Defl_PutCode (deflstream_t *s, unsigned int code, int count)
+{
+	unsigned int	rev = 0;
+	int		i;
+
+	for (i = 0; i < count; i++, code >>= 1)
+		rev = (rev << 1) | (code & 1);
+	Defl_PutBits (s, rev, count);
+}
+
+static void Defl_PutSymbol (deflstream_t *s, int sym)
+{
+	if (sym < 144)
+		Defl_PutCode (s, 0x30 + sym, 8);
+	else if (sym < 256)
+		Defl_PutCode (s, 0x190 + sym - 144, 9);
+	else if (sym < 280)
+		Defl_PutCode (s, sym - 256, 7);
+	else
+		Defl_PutCode (s, 0xc0 + sym - 280, 8);
+}
+
+static void Defl_PutMatch (deflstream_t *s, int len, int dist)
+{
+	int	i;
+
+	for (i = 28; defl_lenbase[i] > len; i--)
+		;
+	Defl_PutSymbol (s, 257 + i);
+	Defl_PutBits (s, len - defl_lenbase[i], defl_lenextra[i]);
+
+	for (i = 29; defl_distbase[i] > dist; i--)
+		;
+	Defl_PutCode (s, i, 5);
+	Defl_PutBits (s, dist - defl_distbase[i], defl_distextra[i]);
+}
+
+/*
+================
+COM_Deflate
+
+Compresses in into a malloc'd raw deflate stream.  Returns NULL if memory
+runs out.
+================
+*/
+byte *COM_Deflate (const byte *in, int inlen, int *outlen)
+{
+	deflstream_t	s;
+	int		*head, *prev;
+	int		pos, cand, len, bestlen, bestdist, chain, h;
+
+	s.out = (byte *) malloc (inlen + inlen / 8 + 64);
+	head = (int *) malloc ((1 << DEFL_HASHBITS) * sizeof(int));
+	prev = (int *) malloc (DEFL_WINDOW * sizeof(int));
+	if (!s.out || !head || !prev)
+	{
+		free (s.out);
+		free (head);
+		free (prev);
+		return NULL;
+	}
+	memset (head, -1, (1 << DEFL_HASHBITS) * sizeof(int));
+	s.outlen = 0;
+	s.bits = 0;
+	s.numbits = 0;
+
+	Defl_PutBits (&s, 1, 1);	// final block
+	Defl_PutBits (&s, 1, 2);	// fixed Huffman codes
+
+#define DEFL_HASH(p)	((((in[p] << 16) | (in[(p)+1] << 8) | in[(p)+2]) * 0x9E3779B1u) >> (32 - DEFL_HASHBITS))
+#define DEFL_INSERT(p)	do { h = DEFL_HASH(p); prev[(p) & (DEFL_WINDOW - 1)] = head[h]; head[h] = (p); } while (0)
+
+	pos = 0;
+	while (pos < inlen)
+	{
+		bestlen = 0;
+		bestdist = 0;
+		if (pos + DEFL_MINMATCH <= inlen)
+		{
+			h = DEFL_HASH(pos);
+			cand = head[h];
+			for (chain = 0; cand >= 0 && pos - cand < DEFL_WINDOW && chain < DEFL_MAXCHAIN; chain++)
+			{
+				if (in[cand + bestlen] == in[pos + bestlen])
+				{
+					for (len = 0; len < DEFL_MAXMATCH && pos + len < inlen && in[cand + len] == in[pos + len]; len++)
+						;
+					if (len > bestlen)
+					{
+						bestlen = len;
+						bestdist = pos - cand;
+						if (len == DEFL_MAXMATCH || pos + len == inlen)
+							break;
+					}
+				}
+				cand = prev[cand & (DEFL_WINDOW - 1)];
+			}
+		}
+
+		if (bestlen >= DEFL_MINMATCH)
+		{
+			Defl_PutMatch (&s, bestlen, bestdist);
+			for (len = 0; len < bestlen; len++, pos++)
+			{
+				if (pos + DEFL_MINMATCH <= inlen)
+					DEFL_INSERT(pos);
+			}
+		}
+		else
+		{
+			Defl_PutSymbol (&s, in[pos]);
+			if (pos + DEFL_MINMATCH <= inlen)
+				DEFL_INSERT(pos);
+			pos++;
+		}
+	}
+
+#undef DEFL_HASH
+#undef DEFL_INSERT
+
+	Defl_PutSymbol (&s, 256);	// end of block
+	if (s.numbits)
+		Defl_PutBits (&s, 0, 8 - s.numbits);
+
+	free (head);
+	free (prev);
+	*outlen = s.outlen;
+	return s.out;
+}
+
+/*
+================
+COM_Inflate
+
+Decompresses a raw deflate stream into a buffer of exactly outlen bytes.
+================
+*/
+qboolean COM_Inflate (const byte *in, int inlen, byte *out, int outlen)
+{
+	tinfl_decompressor	*inflator;
+	size_t			insize, outsize;
+	tinfl_status		status;
+
+	inflator = (tinfl_decompressor *) malloc (sizeof(tinfl_decompressor));
+	if (!inflator)
+		return false;
+	tinfl_init (inflator);
+
+	insize = inlen;
+	outsize = outlen;
+	status = tinfl_decompress (inflator, in, &insize, out, out, &outsize,
+				TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF);
+	free (inflator);
+
+	return status == TINFL_STATUS_DONE && outsize == (size_t)outlen;
+}
+
 static size_t mz_zip_file_read_func(void *opaque, mz_uint64 ofs, void *buf, size_t n)
 {
 	if (SDL_RWseek((SDL_RWops*)opaque, (Sint64)ofs, RW_SEEK_SET) < 0)
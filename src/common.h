@@ -282,6 +282,11 @@ char *va (const char *format, ...) FUNC_PRINTF(1,2);
 
 unsigned COM_HashString (const char *str);
 
+byte *COM_Deflate (const byte *in, int inlen, int *outlen);
+// returns a malloc'd raw deflate stream, NULL if out of memory
+qboolean COM_Inflate (const byte *in, int inlen, byte *out, int outlen);
+// false unless the stream decodes to exactly outlen bytes
+
 // localization support for 2021 rerelease version:
 void LOC_Init (void);
 void LOC_Shutdown (void);
@@ -357,6 +362,8 @@ byte *COM_LoadMallocFile (const char *path, unsigned int *path_id);
 // Returns NULL on failure, or else a '\0'-terminated malloc'ed buffer.
 // Loads in "t" mode so CRLF to LF translation is performed on Windows.
 byte *COM_LoadMallocFile_TextMode_OSPath (const char *path, long *len_out);
+// Same as above in binary mode, without the translation.
+byte *COM_LoadMallocFile_OSPath (const char *path, long *len_out);
 
 // Attempts to parse an int, followed by a newline.
 // Returns advanced buffer position.
@@ -1708,6 +1708,34 @@ static void Mod_LoadLeafs (lump_t *l, int bsp2)
 		Mod_ProcessLeafs_S  ((dsleaf_t *) in, l->filelen);
 }
 
+/*
+=================
+Mod_PackHullNodes
+
+Copies each clipnode's plane next to its children for the hull walks
+=================
+*/
+static mhullnode_t *Mod_PackHullNodes (mclipnode_t *in, int count)
+{
+	mhullnode_t	*out;
+	mplane_t	*plane;
+	int			i;
+
+	out = (mhullnode_t *) Hunk_AllocName ( count*sizeof(*out), loadname);
+	for (i=0 ; i<count ; i++, in++)
+	{
+		plane = loadmodel->planes + in->planenum;
+		VectorCopy (plane->normal, out[i].normal);
+		out[i].dist = plane->dist;
+		out[i].type = plane->type;
+		out[i].children[0] = in->children[0];
+		out[i].children[1] = in->children[1];
+		out[i].planenum = in->planenum;
+	}
+
+	return out;
+}
+
 /*
 =================
 Mod_LoadClipnodes
@@ -1812,6 +1840,8 @@ static void Mod_LoadClipnodes (lump_t *l, qboolean bsp2)
 			//johnfitz
 		}
 	}
+
+	loadmodel->hulls[1].nodes = loadmodel->hulls[2].nodes = Mod_PackHullNodes (loadmodel->clipnodes, count);
 }
 
 /*
@@ -1851,6 +1881,8 @@ static void Mod_MakeHull0 (void)
 				out->children[j] = child - loadmodel->nodes;
 		}
 	}
+
+	hull->nodes = Mod_PackHullNodes (hull->clipnodes, count);
 }
 
 /*
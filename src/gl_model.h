@@ -224,6 +224,16 @@ typedef struct mclipnode_s
 } mclipnode_t;
 //johnfitz
 
+// clipnode with a copy of its plane, so a hull walk reads one record per node
+typedef struct mhullnode_s
+{
+	float		normal[3];
+	float		dist;
+	int			type;		// plane type, 0-2 are axial
+	int			children[2]; // negative numbers are contents
+	int			planenum;
+} mhullnode_t;
+
 // !!! if this is changed, it must be changed in asm_i386.h too !!!
 typedef struct
 {
@@ -233,6 +243,7 @@ typedef struct
 	int			lastclipnode;
 	vec3_t		clip_mins;
 	vec3_t		clip_maxs;
+	mhullnode_t	*nodes;		// clipnodes packed with their planes, same indices
 } hull_t;
 
 /*
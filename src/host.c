@@ -76,6 +76,8 @@ cvar_t	deathmatch = {"deathmatch","0",CVAR_NONE};	// 0, 1, or 2
 cvar_t	coop = {"coop","0",CVAR_NONE};			// 0 or 1
 
 cvar_t	pausable = {"pausable","1",CVAR_NONE};
+cvar_t	savegame_binary = {"savegame_binary","0",CVAR_ARCHIVE};	// write compressed binary saves
+cvar_t	savegame_autosave = {"savegame_autosave","0",CVAR_ARCHIVE};	// seconds between autosaves, 0 = off
 
 cvar_t	developer = {"developer","0",CVAR_NONE};
 
@@ -290,6 +292,8 @@ void Host_InitLocal (void)
 	Cvar_RegisterVariable (&sv_cheats);
 
 	Cvar_RegisterVariable (&pausable);
+	Cvar_RegisterVariable (&savegame_binary);
+	Cvar_RegisterVariable (&savegame_autosave);
 
 	Cvar_RegisterVariable (&temp1);
 
@@ -485,6 +489,8 @@ void Host_ShutdownServer(qboolean crash)
 
 	sv.active = false;
 
+	SV_LockstepStop ();
+
 // stop all client sounds immediately
 	if (cls.state == ca_connected)
 		CL_Disconnect ();
@@ -547,6 +553,7 @@ not reinitialize anything.
 void Host_ClearMemory (void)
 {
 	Con_DPrintf ("Clearing memory\n");
+	Host_WaitAutosave ();	// the worker reads the progs being freed
 	D_FlushCaches ();
 	Mod_ClearAll ();
 	Sky_ClearAll();
@@ -632,6 +639,9 @@ void Host_ServerFrame (void)
 	int		i, active; //johnfitz
 	edict_t	*ent; //johnfitz
 
+// a lockstep replay dictates the frame time
+	SV_LockstepBeginFrame ();
+
 // run the world state
 	pr_global_struct->frametime = host_frametime;
 
@@ -647,7 +657,7 @@ void Host_ServerFrame (void)
 
 // move things around and think
 // always pause in single player if in console or menus
-	if (!sv.paused && (svs.maxclients > 1 || key_dest == key_game) )
+	if (SV_LockstepPhysics (!sv.paused && (svs.maxclients > 1 || key_dest == key_game)))
 		SV_Physics ();
 
 //johnfitz -- devstats
@@ -668,6 +678,8 @@ void Host_ServerFrame (void)
 
 // send all messages to the clients
 	SV_SendClientMessages ();
+
+	SV_LockstepEndFrame ();
 }
 
 /*
@@ -726,7 +738,10 @@ void _Host_Frame (float time)
 	Host_GetConsoleCommands ();
 
 	if (sv.active)
+	{
 		Host_ServerFrame ();
+		Host_AutosaveFrame ();
+	}
 
 //-------------------
 //
@@ -774,6 +789,7 @@ void _Host_Frame (float time)
 		pass3 = (time3 - time2)*1000;
 		Con_Printf ("%3i tot %3i server %3i gfx %3i snd\n",
 					pass1+pass2+pass3, pass1, pass2, pass3);
+		Jobs_PrintSpeeds ();
 	}
 
 	host_framecount++;
@@ -844,6 +860,7 @@ void Host_Init (void)
 	COM_Init ();
 	COM_InitFilesystem ();
 	Host_InitLocal ();
+	Jobs_Init ();
 	W_LoadWadFile (); //johnfitz -- filename is now hard-coded for honesty
 	if (cls.state != ca_dedicated)
 	{
@@ -934,6 +951,8 @@ void Host_Shutdown(void)
 	scr_disabled_for_loading = true;
 
 	Host_WriteConfiguration ();
+	Host_WaitAutosave ();
+	Jobs_Shutdown ();
 
 	PyQ_Shutdown (); // tuorqai
 
@@ -27,6 +27,8 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #endif
 
 extern cvar_t	pausable;
+extern cvar_t	savegame_binary;
+extern cvar_t	savegame_autosave;
 
 int	current_skill;
 
@@ -449,7 +451,7 @@ static void Host_Status_f (void)
 	{
 		if (!client->active)
 			continue;
-		seconds = (int)(net_time - NET_QSocketGetTime(client->netconnection));
+		seconds = client->netconnection ? (int)(net_time - NET_QSocketGetTime(client->netconnection)) : 0;
 		minutes = seconds / 60;
 		if (minutes)
 		{
@@ -461,7 +463,7 @@ static void Host_Status_f (void)
 		else
 			hours = 0;
 		print_fn ("#%-2u %-16.16s  %3i  %2i:%02i:%02i\n", j+1, client->name, (int)client->edict->v.frags, hours, minutes, seconds);
-		print_fn ("   %s\n", NET_QSocketGetAddressString(client->netconnection));
+		print_fn ("   %s\n", client->netconnection ? NET_QSocketGetAddressString(client->netconnection) : "lockstep replay");
 	}
 }
 
@@ -983,6 +985,13 @@ LOAD / SAVE GAME
 
 #define	SAVEGAME_VERSION	5
 
+/*
+Binary saves start with the same two text lines as text saves, so the
+menu can list them, followed by three little endian ints (raw size, CRC of
+the raw data, compressed size) and the deflated payload.
+*/
+#define	SAVEGAME_BINARY_VERSION	100
+
 /*
 ===============
 Host_SavegameComment
@@ -1024,37 +1033,259 @@ static void Host_SavegameComment (char text[SAVEGAME_COMMENT_LENGTH + 1])
 
 /*
 ===============
-Host_Savegame_f
+Host_SavegameAllowed
 ===============
 */
-static void Host_Savegame_f (void)
+static qboolean Host_SavegameAllowed (qboolean verbose)
 {
-	char	name[MAX_OSPATH];
-	FILE	*f;
 	int	i;
-	char	comment[SAVEGAME_COMMENT_LENGTH+1];
-
-	if (cmd_source != src_command)
-		return;
 
 	if (!sv.active)
 	{
-		Con_Printf ("Not playing a local game.\n");
-		return;
+		if (verbose)
+			Con_Printf ("Not playing a local game.\n");
+		return false;
 	}
 
 	if (cl.intermission)
 	{
-		Con_Printf ("Can't save in intermission.\n");
-		return;
+		if (verbose)
+			Con_Printf ("Can't save in intermission.\n");
+		return false;
 	}
 
 	if (svs.maxclients != 1)
 	{
-		Con_Printf ("Can't save multiplayer games.\n");
-		return;
+		if (verbose)
+			Con_Printf ("Can't save multiplayer games.\n");
+		return false;
 	}
 
+	for (i=0 ; i<svs.maxclients ; i++)
+	{
+		if (svs.clients[i].active && (svs.clients[i].edict->v.health <= 0) )
+		{
+			if (verbose)
+				Con_Printf ("Can't savegame with a dead player\n");
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+===============
+Host_SavegameHeader
+
+Everything in a binary save that is not progs state
+===============
+*/
+static void Host_SavegameHeader (savebuf_t *buf)
+{
+	int	i;
+
+	for (i = 0; i < NUM_SPAWN_PARMS; i++)
+		SaveBuf_WriteFloat (buf, svs.clients->spawn_parms[i]);
+	SaveBuf_WriteLong (buf, current_skill);
+	SaveBuf_WriteString (buf, sv.name);
+	SaveBuf_WriteFloat (buf, sv.time);
+	for (i = 0; i < MAX_LIGHTSTYLES; i++)
+		SaveBuf_WriteString (buf, sv.lightstyles[i] ? sv.lightstyles[i] : "m");
+}
+
+/*
+===============
+Host_WriteBinarySave
+
+Compresses a finished payload and writes the file; may run off the main
+thread, so it reports failure instead of printing
+===============
+*/
+static qboolean Host_WriteBinarySave (FILE *f, savebuf_t *buf, const char *comment)
+{
+	byte	*packed;
+	int	packedsize, header[3];
+	qboolean	ok;
+
+	packed = COM_Deflate (buf->data, buf->cursize, &packedsize);
+	if (!packed)
+		return false;
+
+	header[0] = LittleLong (buf->cursize);
+	header[1] = LittleLong (CRC_Block (buf->data, buf->cursize));
+	header[2] = LittleLong (packedsize);
+
+	fprintf (f, "%i\n%s\n", SAVEGAME_BINARY_VERSION, comment);
+	ok = fwrite (header, sizeof(header), 1, f) == 1 &&
+		fwrite (packed, 1, packedsize, f) == (size_t) packedsize;
+
+	free (packed);
+	return ok;
+}
+
+/*
+===============
+Host_SavegameBinary
+===============
+*/
+static void Host_SavegameBinary (FILE *f)
+{
+	savebuf_t	buf;
+	char		comment[SAVEGAME_COMMENT_LENGTH+1];
+
+	memset (&buf, 0, sizeof(buf));
+	Host_SavegameHeader (&buf);
+	ED_WriteBinary (&buf);
+
+	Host_SavegameComment (comment);
+	if (!Host_WriteBinarySave (f, &buf, comment))
+		Con_Printf ("ERROR: couldn't write.\n");
+	SaveBuf_Free (&buf);
+}
+
+/*
+===============================================================================
+
+AUTOSAVE
+
+Every savegame_autosave seconds of game time the edicts and globals are
+copied into a snapshot between frames; building the payload, compressing
+and writing autosave.sav then happens on a worker thread.  Anything that
+frees the progs or reuses the file waits for the worker first.
+===============================================================================
+*/
+
+typedef struct
+{
+	savesnapshot_t	*snap;
+	savebuf_t	buf;		// non-progs part, filled on the main thread
+	char		name[MAX_OSPATH];
+	char		comment[SAVEGAME_COMMENT_LENGTH+1];
+	qboolean	ok;
+#if defined(USE_SDL2)
+	SDL_Thread	*thread;
+	SDL_atomic_t	done;
+#endif
+} autosave_t;
+
+static autosave_t	autosave;
+static double		autosave_last;
+static qboolean		autosave_busy;
+
+static int SDLCALL Host_AutosaveWrite (void *unused)
+{
+	FILE	*f;
+
+	ED_WriteSnapshot (autosave.snap, &autosave.buf);
+	autosave.ok = false;
+	f = fopen (autosave.name, "wb");
+	if (f)
+	{
+		autosave.ok = Host_WriteBinarySave (f, &autosave.buf, autosave.comment);
+		if (fclose (f))
+			autosave.ok = false;
+	}
+#if defined(USE_SDL2)
+	SDL_AtomicSet (&autosave.done, 1);
+#endif
+	return 0;
+}
+
+static void Host_AutosaveFinish (void)
+{
+#if defined(USE_SDL2)
+	if (autosave.thread)
+		SDL_WaitThread (autosave.thread, NULL);
+	autosave.thread = NULL;
+#endif
+	if (autosave.ok)
+		Con_DPrintf ("Autosaved to %s\n", autosave.name);
+	else
+		Con_Printf ("Autosave to %s failed\n", autosave.name);
+
+	ED_FreeSnapshot (autosave.snap);
+	autosave.snap = NULL;
+	SaveBuf_Free (&autosave.buf);
+	autosave_busy = false;
+}
+
+/*
+===============
+Host_WaitAutosave
+
+Blocks until a running autosave has been written
+===============
+*/
+void Host_WaitAutosave (void)
+{
+	if (autosave_busy)
+		Host_AutosaveFinish ();
+}
+
+/*
+===============
+Host_AutosaveFrame
+
+Called between frames: reaps a finished autosave and starts the next one
+when it is due
+===============
+*/
+void Host_AutosaveFrame (void)
+{
+	if (autosave_busy)
+	{
+#if defined(USE_SDL2)
+		if (!SDL_AtomicGet (&autosave.done))
+			return;
+#endif
+		Host_AutosaveFinish ();
+	}
+
+	if (savegame_autosave.value <= 0 || !Host_SavegameAllowed (false))
+		return;
+	if (sv.time < autosave_last)
+		autosave_last = 0;	// new map
+	if (sv.time - autosave_last < savegame_autosave.value)
+		return;
+	autosave_last = sv.time;
+
+	q_snprintf (autosave.name, sizeof(autosave.name), "%s/autosave.sav", com_gamedir);
+	Host_SavegameComment (autosave.comment);
+	memset (&autosave.buf, 0, sizeof(autosave.buf));
+	Host_SavegameHeader (&autosave.buf);
+	autosave.snap = ED_CreateSnapshot ();
+	autosave_busy = true;
+
+#if defined(USE_SDL2)
+	SDL_AtomicSet (&autosave.done, 0);
+	autosave.thread = SDL_CreateThread (Host_AutosaveWrite, "autosave", NULL);
+	if (autosave.thread)
+		return;
+#endif
+	// no worker thread, write it now
+	Host_AutosaveWrite (NULL);
+	Host_AutosaveFinish ();
+}
+
+/*
+===============
+Host_Savegame_f
+===============
+*/
+static void Host_Savegame_f (void)
+{
+	char	name[MAX_OSPATH];
+	FILE	*f;
+	int	i;
+	char	comment[SAVEGAME_COMMENT_LENGTH+1];
+
+	if (cmd_source != src_command)
+		return;
+
+	if (!Host_SavegameAllowed (true))
+		return;
+
 	if (Cmd_Argc() != 2)
 	{
 		Con_Printf ("save <savename> : save a game\n");
@@ -1067,26 +1298,27 @@ static void Host_Savegame_f (void)
 		return;
 	}
 
-	for (i=0 ; i<svs.maxclients ; i++)
-	{
-		if (svs.clients[i].active && (svs.clients[i].edict->v.health <= 0) )
-		{
-			Con_Printf ("Can't savegame with a dead player\n");
-			return;
-		}
-	}
+	Host_WaitAutosave ();
 
 	q_snprintf (name, sizeof(name), "%s/%s", com_gamedir, Cmd_Argv(1));
 	COM_AddExtension (name, ".sav", sizeof(name));
 
 	Con_Printf ("Saving game to %s...\n", name);
-	f = fopen (name, "w");
+	f = fopen (name, savegame_binary.value ? "wb" : "w");
 	if (!f)
 	{
 		Con_Printf ("ERROR: couldn't open.\n");
 		return;
 	}
 
+	if (savegame_binary.value)
+	{
+		Host_SavegameBinary (f);
+		fclose (f);
+		Con_Printf ("done.\n");
+		return;
+	}
+
 	fprintf (f, "%i\n", SAVEGAME_VERSION);
 	Host_SavegameComment (comment);
 	fprintf (f, "%s\n", comment);
@@ -1115,6 +1347,161 @@ static void Host_Savegame_f (void)
 	Con_Printf ("done.\n");
 }
 
+/*
+===============
+Host_FinishLoadgame
+
+Common tail of text and binary loads, once the edicts are in place
+===============
+*/
+static void Host_FinishLoadgame (int entnum, float time, const float *spawn_parms)
+{
+	int	i;
+
+	// Free edicts allocated during map loading but no longer used after restoring saved game state
+	for (i = entnum; i < sv.num_edicts; i++)
+		ED_Free(EDICT_NUM(i));
+
+	sv.num_edicts = entnum;
+	sv.time = time;
+	ED_RebuildFreeList ();
+	ED_HotInit (ed_hot.count != 0);
+
+	for (i = 0; i < NUM_SPAWN_PARMS; i++)
+		svs.clients->spawn_parms[i] = spawn_parms[i];
+
+	if (cls.state != ca_dedicated)
+	{
+		CL_EstablishConnection ("local");
+		Host_Reconnect_f ();
+	}
+
+	if (cls.state != ca_dedicated)
+		IN_Activate(); // moved to here from M_Load_Key()
+}
+
+/*
+===============
+Host_SavegameVersion
+
+Reads just the version line, -1 if the file can't be opened
+===============
+*/
+static int Host_SavegameVersion (const char *name)
+{
+	FILE	*f;
+	int	version;
+
+	f = fopen (name, "rb");
+	if (!f)
+		return -1;
+	if (fscanf (f, "%i", &version) != 1)
+		version = 0;
+	fclose (f);
+	return version;
+}
+
+/*
+===============
+Host_LoadgameBinary
+===============
+*/
+static void Host_LoadgameBinary (const char *name)
+{
+	static byte	*start;
+	static savebuf_t	buf;
+
+	char	mapname[MAX_QPATH];
+	float	time;
+	float	spawn_parms[NUM_SPAWN_PARMS];
+	const byte	*data;
+	long	len;
+	int	i, header[3], entnum;
+
+// avoid leaking if the previous load failed with a Host_Error
+	free (start);
+	start = NULL;
+	SaveBuf_Free (&buf);
+
+	start = COM_LoadMallocFile_OSPath (name, &len);
+	if (start == NULL)
+	{
+		Con_Printf ("ERROR: couldn't open.\n");
+		return;
+	}
+
+	// skip the version and comment lines
+	data = start;
+	for (i = 0; i < 2; i++)
+	{
+		data = (const byte *) memchr (data, '\n', len - (data - start));
+		if (!data)
+			break;
+		data++;
+	}
+	if (!data || len - (data - start) < (long) sizeof(header))
+	{
+		free (start);
+		start = NULL;
+		Host_Error ("Savegame is truncated");
+		return;
+	}
+	memcpy (header, data, sizeof(header));
+	data += sizeof(header);
+	for (i = 0; i < 3; i++)
+		header[i] = LittleLong (header[i]);
+
+	if (header[0] < 0 || header[2] < 0 || header[2] > len - (data - start))
+	{
+		free (start);
+		start = NULL;
+		Host_Error ("Savegame is truncated");
+		return;
+	}
+	buf.data = (byte *) malloc (header[0] + 1);
+	buf.maxsize = buf.cursize = header[0];
+	if (!buf.data || !COM_Inflate (data, header[2], buf.data, header[0]) ||
+		CRC_Block (buf.data, header[0]) != (unsigned short) header[1])
+	{
+		free (start);
+		start = NULL;
+		SaveBuf_Free (&buf);
+		Host_Error ("Savegame is corrupt");
+		return;
+	}
+	free (start);
+	start = NULL;
+
+	for (i = 0; i < NUM_SPAWN_PARMS; i++)
+		spawn_parms[i] = SaveBuf_ReadFloat (&buf);
+	current_skill = SaveBuf_ReadLong (&buf);
+	Cvar_SetValue ("skill", (float)current_skill);
+	q_strlcpy (mapname, SaveBuf_ReadString (&buf), sizeof(mapname));
+	time = SaveBuf_ReadFloat (&buf);
+
+	CL_Disconnect_f ();
+
+	SV_SpawnServer (mapname);
+
+	if (!sv.active)
+	{
+		SaveBuf_Free (&buf);
+		SCR_EndLoadingPlaque ();
+		Con_Printf ("Couldn't load map\n");
+		return;
+	}
+	sv.paused = true;		// pause until all clients connect
+	sv.loadgame = true;
+
+	for (i = 0; i < MAX_LIGHTSTYLES; i++)
+		sv.lightstyles[i] = (const char *)Hunk_Strdup (SaveBuf_ReadString (&buf), "lightstyles");
+
+	entnum = ED_ReadBinary (&buf);
+	SaveBuf_Free (&buf);
+
+	Host_FinishLoadgame (entnum, time, spawn_parms);
+}
+
 /*
 ===============
 Host_Loadgame_f
@@ -1153,6 +1540,7 @@ static void Host_Loadgame_f (void)
 
 	q_snprintf (name, sizeof(name), "%s/%s", com_gamedir, Cmd_Argv(1));
 	COM_AddExtension (name, ".sav", sizeof(name));
+	Host_WaitAutosave ();	// it may be writing this very file
 
 // we can't call SCR_BeginLoadingPlaque, because too much stack space has
 // been used.  The menu calls it before stuffing loadgame command
@@ -1160,6 +1548,12 @@ static void Host_Loadgame_f (void)
 
 	Con_Printf ("Loading game from %s...\n", name);
 	
+	if (Host_SavegameVersion (name) == SAVEGAME_BINARY_VERSION)
+	{
+		Host_LoadgameBinary (name);
+		return;
+	}
+
 // avoid leaking if the previous Host_Loadgame_f failed with a Host_Error
 	if (start != NULL)
 		free (start);
@@ -1251,27 +1645,10 @@ static void Host_Loadgame_f (void)
 		entnum++;
 	}
 
-	// Free edicts allocated during map loading but no longer used after restoring saved game state
-	for (i = entnum; i < sv.num_edicts; i++)
-		ED_Free(EDICT_NUM(i));
-
-	sv.num_edicts = entnum;
-	sv.time = time;
-
 	free (start);
 	start = NULL;
 
-	for (i = 0; i < NUM_SPAWN_PARMS; i++)
-		svs.clients->spawn_parms[i] = spawn_parms[i];
-
-	if (cls.state != ca_dedicated)
-	{
-		CL_EstablishConnection ("local");
-		Host_Reconnect_f ();
-	}
-
-	if (cls.state != ca_dedicated)
-		IN_Activate(); // moved to here from M_Load_Key()
+	Host_FinishLoadgame (entnum, time, spawn_parms);
 }
 
 //============================================================================
@@ -1659,7 +2036,7 @@ static void Host_Spawn_f (void)
 		pr_global_struct->self = EDICT_TO_PROG(sv_player);
 		PR_ExecuteProgram (pr_global_struct->ClientConnect);
 
-		if ((Sys_DoubleTime() - NET_QSocketGetTime(host_client->netconnection)) <= sv.time)
+		if (host_client->netconnection && (Sys_DoubleTime() - NET_QSocketGetTime(host_client->netconnection)) <= sv.time)
 			Sys_Printf ("%s entered the game\n", host_client->name);
 
 		PR_ExecuteProgram (pr_global_struct->PutClientInServer);
@@ -0,0 +1,359 @@
+/*
+Copyright (C) 1996-2001 Id Software, Inc.
+Copyright (C) 2002-2009 John Fitzgibbons and others
+Copyright (C) 2010-2014 QuakeSpasm developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// jobs.c -- fork-join job pool with work stealing
+
+#include "quakedef.h"
+
+/*
+Jobs_Run splits [0, count) evenly between the main thread and the
+host_jobthreads helper threads.  Each worker claims grain sized ranges
+from the front of its own share; one that runs dry steals the back half
+of whatever another worker has left, so uneven jobs still finish
+together.  Jobs_Run returns once every worker has run out, which makes
+everything the job wrote visible to the caller.
+
+Jobs must not touch the hunk, the zone, the cache, QC or the console,
+and must not call Host_Error or Sys_Error; anything they need from
+those is prepared by the caller first.  Without SDL2 or with
+host_jobthreads 0 the whole range runs on the main thread.
+*/
+
+cvar_t	host_jobthreads = {"host_jobthreads","0",CVAR_ARCHIVE};
+
+#define	MAX_JOBSTATS	16
+
+typedef struct
+{
+	jobctx_t	ctx;
+#if defined(USE_SDL2)
+	SDL_SpinLock	lock;
+	int			next, end;		// unclaimed part of the current run
+	SDL_Thread	*thread;
+#endif
+} jobworker_t;
+
+static	jobworker_t	jobworkers[MAX_JOBWORKERS];
+static	int			jobs_numworkers = 1;
+static	qboolean	jobs_running;
+
+#if defined(USE_SDL2)
+static	jobfunc_t	jobs_func;
+static	void		*jobs_data;
+static	int			jobs_grain;
+static	SDL_sem		*jobs_go, *jobs_done;
+static	qboolean	jobs_quit;
+static	int			jobs_requested;	// last count given to Jobs_SetThreads
+#endif
+
+static	struct
+{
+	const char	*name;
+	double		time;
+	int			runs, items;
+} jobstats[MAX_JOBSTATS];
+static	int			jobs_numstats;
+
+#if defined(USE_SDL2)
+/*
+================
+Jobs_Claim
+
+Takes the next range from the front of the worker's own share
+================
+*/
+static qboolean Jobs_Claim (jobworker_t *w, int *first, int *last)
+{
+	qboolean	ok;
+
+	SDL_AtomicLock (&w->lock);
+	ok = w->next < w->end;
+	if (ok)
+	{
+		*first = w->next;
+		*last = q_min (w->next + jobs_grain, w->end);
+		w->next = *last;
+	}
+	SDL_AtomicUnlock (&w->lock);
+	return ok;
+}
+
+/*
+================
+Jobs_Steal
+
+Moves the back half of another worker's share into w's.  False when
+there was nothing left anywhere.
+================
+*/
+static qboolean Jobs_Steal (jobworker_t *w)
+{
+	jobworker_t	*victim;
+	int		i, first, last;
+
+	for (i = 1; i < jobs_numworkers; i++)
+	{
+		victim = &jobworkers[(w->ctx.worker + i) % jobs_numworkers];
+		SDL_AtomicLock (&victim->lock);
+		first = victim->next + (victim->end - victim->next) / 2;
+		last = victim->end;
+		victim->end = first;
+		SDL_AtomicUnlock (&victim->lock);
+
+		if (first < last)
+		{
+			SDL_AtomicLock (&w->lock);
+			w->next = first;
+			w->end = last;
+			SDL_AtomicUnlock (&w->lock);
+			return true;
+		}
+	}
+	return false;
+}
+
+/*
+================
+Jobs_Work
+
+Runs ranges until no worker has any left
+================
+*/
+static void Jobs_Work (jobworker_t *w)
+{
+	int		first, last;
+
+	do
+	{
+		while (Jobs_Claim (w, &first, &last))
+			jobs_func (&w->ctx, jobs_data, first, last);
+	} while (Jobs_Steal (w));
+}
+
+static int SDLCALL Jobs_Thread (void *arg)
+{
+	jobworker_t	*w = (jobworker_t *) arg;
+
+	while (1)
+	{
+		SDL_SemWait (jobs_go);
+		if (jobs_quit)
+			break;
+		Jobs_Work (w);
+		SDL_SemPost (jobs_done);
+	}
+	return 0;
+}
+
+/*
+================
+Jobs_SetThreads
+
+Starts or stops helper threads until count are running.  If a thread
+can't be started, the ones that did are kept until host_jobthreads
+changes again rather than retrying on every run.
+================
+*/
+static void Jobs_SetThreads (int count)
+{
+	int		i;
+
+	if (count == jobs_requested)
+		return;
+	jobs_requested = count;
+
+	if (!jobs_go)
+	{
+		jobs_go = SDL_CreateSemaphore (0);
+		jobs_done = SDL_CreateSemaphore (0);
+		if (!jobs_go || !jobs_done)
+			Sys_Error ("Jobs_SetThreads: %s", SDL_GetError());
+	}
+
+	jobs_quit = true;
+	for (i = 1; i < jobs_numworkers; i++)
+		SDL_SemPost (jobs_go);
+	for (i = 1; i < jobs_numworkers; i++)
+		SDL_WaitThread (jobworkers[i].thread, NULL);
+	jobs_quit = false;
+
+	for (jobs_numworkers = 1; jobs_numworkers <= count; jobs_numworkers++)
+	{
+		jobworkers[jobs_numworkers].thread = SDL_CreateThread (Jobs_Thread, "jobs", &jobworkers[jobs_numworkers]);
+		if (!jobworkers[jobs_numworkers].thread)
+		{
+			Con_Printf ("Couldn't start a job thread: %s\n", SDL_GetError());
+			break;
+		}
+	}
+}
+#endif
+
+/*
+================
+Jobs_Run
+
+================
+*/
+void Jobs_Run (const char *name, jobfunc_t func, void *data, int count, int grain, int scratch)
+{
+	extern	cvar_t	host_speeds;
+	jobworker_t	*w;
+	double	time1 = 0;
+	int		i;
+
+	if (jobs_running)
+		Sys_Error ("Jobs_Run: %s started from a job", name);
+	if (count <= 0)
+		return;
+	if (host_speeds.value)
+		time1 = Sys_DoubleTime ();
+
+#if defined(USE_SDL2)
+	Jobs_SetThreads (CLAMP(0, (int)host_jobthreads.value, MAX_JOBWORKERS - 1));
+	if (count <= grain)
+		i = 1;		// not worth waking anyone
+	else
+		i = jobs_numworkers;
+#else
+	i = 1;
+#endif
+
+	for (w = jobworkers; w < jobworkers + i; w++)
+	{
+		w->ctx.worker = w - jobworkers;
+		w->ctx.scratchused = 0;
+		if (w->ctx.scratchsize < scratch)
+		{
+			free (w->ctx.scratch);
+			w->ctx.scratchsize = (scratch + 0xffff) & ~0xffff;
+			w->ctx.scratch = (byte *) malloc (w->ctx.scratchsize);
+			if (!w->ctx.scratch)
+				Sys_Error ("Jobs_Run: out of memory for %i bytes of scratch", w->ctx.scratchsize);
+		}
+	}
+
+	jobs_running = true;
+	if (i == 1)
+		func (&jobworkers[0].ctx, data, 0, count);
+#if defined(USE_SDL2)
+	else
+	{
+		jobs_func = func;
+		jobs_data = data;
+		jobs_grain = q_max (grain, 1);
+		for (w = jobworkers; w < jobworkers + i; w++)
+		{
+			w->next = count * (w - jobworkers) / i;
+			w->end = count * (w - jobworkers + 1) / i;
+		}
+
+		for (i = 1; i < jobs_numworkers; i++)
+			SDL_SemPost (jobs_go);
+		Jobs_Work (&jobworkers[0]);
+		for (i = 1; i < jobs_numworkers; i++)
+			SDL_SemWait (jobs_done);
+	}
+#endif
+	jobs_running = false;
+
+	if (!host_speeds.value)
+		return;
+	for (i = 0; i < jobs_numstats; i++)
+		if (jobstats[i].name == name)
+			break;
+	if (i == MAX_JOBSTATS)
+		return;
+	if (i == jobs_numstats)
+	{
+		jobstats[i].name = name;
+		jobs_numstats++;
+	}
+	jobstats[i].time += Sys_DoubleTime () - time1;
+	jobstats[i].runs++;
+	jobstats[i].items += count;
+}
+
+/*
+================
+Jobs_Alloc
+
+================
+*/
+void *Jobs_Alloc (jobctx_t *ctx, int size)
+{
+	void	*p;
+
+	size = (size + 15) & ~15;
+	if (ctx->scratchused + size > ctx->scratchsize)
+		Sys_Error ("Jobs_Alloc: %i bytes overflows the scratch arena", size);
+	p = ctx->scratch + ctx->scratchused;
+	ctx->scratchused += size;
+	return p;
+}
+
+/*
+================
+Jobs_PrintSpeeds
+
+================
+*/
+void Jobs_PrintSpeeds (void)
+{
+	int		i;
+
+	if (!jobs_numstats)
+		return;
+
+	Con_Printf ("%i workers:", jobs_numworkers);
+	for (i = 0; i < jobs_numstats; i++)
+	{
+		Con_Printf (" %s %i/%i %.2fms", jobstats[i].name, jobstats[i].items, jobstats[i].runs, jobstats[i].time * 1000);
+		jobstats[i].time = 0;
+		jobstats[i].runs = jobstats[i].items = 0;
+	}
+	Con_Printf ("\n");
+}
+
+/*
+================
+Jobs_Init
+
+================
+*/
+void Jobs_Init (void)
+{
+	Cvar_RegisterVariable (&host_jobthreads);
+}
+
+/*
+================
+Jobs_Shutdown
+
+================
+*/
+void Jobs_Shutdown (void)
+{
+#if defined(USE_SDL2)
+	if (jobs_go)
+		Jobs_SetThreads (0);
+#endif
+}
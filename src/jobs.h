@@ -0,0 +1,53 @@
+/*
+Copyright (C) 1996-2001 Id Software, Inc.
+Copyright (C) 2002-2009 John Fitzgibbons and others
+Copyright (C) 2010-2014 QuakeSpasm developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#ifndef _QUAKE_JOBS_H
+#define _QUAKE_JOBS_H
+
+/* jobs.h -- fork-join job pool, see jobs.c */
+
+#define	MAX_JOBWORKERS	16		// including the main thread, which is worker 0
+
+typedef struct jobctx_s
+{
+	int		worker;
+	byte	*scratch;			// reset at the start of every Jobs_Run
+	int		scratchsize, scratchused;
+} jobctx_t;
+
+// called for the indices first <= i < last, from any worker
+typedef void (*jobfunc_t) (jobctx_t *ctx, void *data, int first, int last);
+
+void Jobs_Init (void);
+void Jobs_Shutdown (void);
+
+void Jobs_Run (const char *name, jobfunc_t func, void *data, int count, int grain, int scratch);
+// runs func over [0, count) in ranges of at most grain and returns when all
+// are done.  every worker has at least scratch bytes for Jobs_Alloc.
+
+void *Jobs_Alloc (jobctx_t *ctx, int size);
+// 16 byte aligned, valid until the next Jobs_Run
+
+void Jobs_PrintSpeeds (void);
+// for host_speeds: prints and clears the time spent in each job
+
+#endif	/* _QUAKE_JOBS_H */
@@ -221,7 +221,7 @@ void VectorAngles (const vec3_t forward, vec3_t angles)
 	angles[ROLL] = 0;
 }
 
-void AngleVectors (vec3_t angles, vec3_t forward, vec3_t right, vec3_t up)
+void AngleVectorsScalar (vec3_t angles, vec3_t forward, vec3_t right, vec3_t up)
 {
 	float		angle;
 	float		sr, sp, sy, cr, cp, cy;
@@ -247,6 +247,51 @@ void AngleVectors (vec3_t angles, vec3_t forward, vec3_t right, vec3_t up)
 	up[2] = cr*cp;
 }
 
+/*
+=================
+AngleVectors
+
+The SSE2 path keeps the libm sin/cos calls and combines the results four
+lanes at a time.  Every lane evaluates the same products as the scalar
+expressions below (sign flips and multiplies by +-1 are exact), so the
+output is bit-identical.
+=================
+*/
+void AngleVectors (vec3_t angles, vec3_t forward, vec3_t right, vec3_t up)
+{
+#if defined(USE_SSE2)
+	float		angle;
+	float		sr, sp, sy, cr, cp, cy;
+	__m128		p, q, f, r;
+
+	angle = angles[YAW] * (M_PI*2 / 360);
+	sy = sin(angle);
+	cy = cos(angle);
+	angle = angles[PITCH] * (M_PI*2 / 360);
+	sp = sin(angle);
+	cp = cos(angle);
+	angle = angles[ROLL] * (M_PI*2 / 360);
+	sr = sin(angle);
+	cr = cos(angle);
+
+	// lanes: right[0], right[1], up[0], up[1]
+	p = _mm_mul_ps (_mm_setr_ps (sr*sp, sr*sp, cr*sp, cr*sp), _mm_setr_ps (cy, sy, cy, sy));
+	q = _mm_mul_ps (_mm_setr_ps (cr, cr, sr, sr), _mm_setr_ps (sy, cy, sy, cy));
+	r = _mm_add_ps (_mm_mul_ps (p, _mm_setr_ps (-1, -1, 1, 1)), _mm_mul_ps (q, _mm_setr_ps (1, -1, 1, -1)));
+	// lanes: forward[0], forward[1], -right[2], up[2]
+	f = _mm_mul_ps (_mm_setr_ps (cp, cp, sr, cr), _mm_setr_ps (cy, sy, cp, cp));
+
+	_mm_storel_pi ((__m64 *) forward, f);
+	forward[2] = -sp;
+	_mm_storel_pi ((__m64 *) right, r);
+	right[2] = -_mm_cvtss_f32 (_mm_shuffle_ps (f, f, _MM_SHUFFLE (2, 2, 2, 2)));
+	_mm_storel_pi ((__m64 *) up, _mm_movehl_ps (r, r));
+	up[2] = _mm_cvtss_f32 (_mm_shuffle_ps (f, f, _MM_SHUFFLE (3, 3, 3, 3)));
+#else
+	AngleVectorsScalar (angles, forward, right, up);
+#endif
+}
+
 int VectorCompare (vec3_t v1, vec3_t v2)
 {
 	int		i;
@@ -72,6 +72,127 @@ static inline int IS_NAN (float x) {
 	}\
 }
 
+/*
+==============================================================================
+
+SIMD VECTOR HELPERS
+
+Three-lane vector ops used by the QuakeC vector opcodes and math builtins.
+They read and write exactly three floats (globals and entity fields are
+packed, so a fourth lane would touch the neighbouring variable) and keep
+the scalar operation order, so results are bit-identical to the plain C
+versions.  Dot products are only vectorized with SSE2: aarch64 compilers
+contract the scalar a*b+c into fused multiply-adds, and a separate
+multiply and add there would change the rounding.
+
+==============================================================================
+*/
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define USE_SSE2	1
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define USE_NEON	1
+#include <arm_neon.h>
+#endif
+
+#if defined(USE_SSE2)
+static inline __m128 SIMD_Load3 (const float *v)
+{
+	return _mm_movelh_ps (_mm_loadl_pi (_mm_setzero_ps (), (const __m64 *) v), _mm_load_ss (v + 2));
+}
+
+static inline void SIMD_Store3 (float *v, __m128 x)
+{
+	_mm_storel_pi ((__m64 *) v, x);
+	_mm_store_ss (v + 2, _mm_movehl_ps (x, x));
+}
+#endif
+
+static inline void SIMD_VectorAdd (const float *a, const float *b, float *c)
+{
+#if defined(USE_SSE2)
+	SIMD_Store3 (c, _mm_add_ps (SIMD_Load3 (a), SIMD_Load3 (b)));
+#elif defined(USE_NEON)
+	float32x2_t lo = vadd_f32 (vld1_f32 (a), vld1_f32 (b));
+	float z = a[2] + b[2];
+	vst1_f32 (c, lo);
+	c[2] = z;
+#else
+	float x = a[0] + b[0], y = a[1] + b[1], z = a[2] + b[2];
+	c[0] = x; c[1] = y; c[2] = z;
+#endif
+}
+
+static inline void SIMD_VectorSubtract (const float *a, const float *b, float *c)
+{
+#if defined(USE_SSE2)
+	SIMD_Store3 (c, _mm_sub_ps (SIMD_Load3 (a), SIMD_Load3 (b)));
+#elif defined(USE_NEON)
+	float32x2_t lo = vsub_f32 (vld1_f32 (a), vld1_f32 (b));
+	float z = a[2] - b[2];
+	vst1_f32 (c, lo);
+	c[2] = z;
+#else
+	float x = a[0] - b[0], y = a[1] - b[1], z = a[2] - b[2];
+	c[0] = x; c[1] = y; c[2] = z;
+#endif
+}
+
+static inline void SIMD_VectorScale (const float *a, float s, float *c)
+{
+#if defined(USE_SSE2)
+	SIMD_Store3 (c, _mm_mul_ps (SIMD_Load3 (a), _mm_set1_ps (s)));
+#elif defined(USE_NEON)
+	float32x2_t lo = vmul_n_f32 (vld1_f32 (a), s);
+	float z = a[2] * s;
+	vst1_f32 (c, lo);
+	c[2] = z;
+#else
+	float x = a[0] * s, y = a[1] * s, z = a[2] * s;
+	c[0] = x; c[1] = y; c[2] = z;
+#endif
+}
+
+static inline float SIMD_DotProduct (const float *a, const float *b)
+{
+#if defined(USE_SSE2)
+	__m128 p = _mm_mul_ps (SIMD_Load3 (a), SIMD_Load3 (b));
+	__m128 s = _mm_add_ss (p, _mm_shuffle_ps (p, p, _MM_SHUFFLE (1, 1, 1, 1)));
+	return _mm_cvtss_f32 (_mm_add_ss (s, _mm_movehl_ps (p, p)));
+#else
+	return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+#endif
+}
+
+// squared length in double precision, summed as ((x*x + y*y) + z*z)
+static inline double SIMD_LengthSquaredD (const float *v)
+{
+#if defined(USE_SSE2)
+	__m128d xy = _mm_cvtps_pd (_mm_loadl_pi (_mm_setzero_ps (), (const __m64 *) v));
+	__m128d z = _mm_cvtss_sd (_mm_setzero_pd (), _mm_load_ss (v + 2));
+	__m128d sq = _mm_mul_pd (xy, xy);
+	sq = _mm_add_sd (sq, _mm_unpackhi_pd (sq, sq));
+	return _mm_cvtsd_f64 (_mm_add_sd (sq, _mm_mul_sd (z, z)));
+#else
+	return (double)v[0] * v[0] + (double)v[1] * v[1] + (double)v[2] * v[2];
+#endif
+}
+
+// float vector times a double scale, each lane rounded back to float
+static inline void SIMD_VectorScaleD (const float *a, double s, float *c)
+{
+#if defined(USE_SSE2)
+	__m128d sc = _mm_set1_pd (s);
+	__m128d xy = _mm_mul_pd (_mm_cvtps_pd (_mm_loadl_pi (_mm_setzero_ps (), (const __m64 *) a)), sc);
+	__m128d z = _mm_mul_sd (_mm_cvtss_sd (_mm_setzero_pd (), _mm_load_ss (a + 2)), sc);
+	SIMD_Store3 (c, _mm_movelh_ps (_mm_cvtpd_ps (xy), _mm_cvtpd_ps (z)));
+#else
+	float x = a[0] * s, y = a[1] * s, z = a[2] * s;
+	c[0] = x; c[1] = y; c[2] = z;
+#endif
+}
+
 void TurnVector (vec3_t out, const vec3_t forward, const vec3_t side, float angle); //johnfitz
 void VectorAngles (const vec3_t forward, vec3_t angles); //johnfitz
 
@@ -99,6 +220,7 @@ fixed16_t Invert24To16(fixed16_t val);
 int GreatestCommonDivisor (int i1, int i2);
 
 void AngleVectors (vec3_t angles, vec3_t forward, vec3_t right, vec3_t up);
+void AngleVectorsScalar (vec3_t angles, vec3_t forward, vec3_t right, vec3_t up);
 int BoxOnPlaneSide (vec3_t emins, vec3_t emaxs, struct mplane_s *plane);
 float	anglemod(float a);
 
@@ -22,7 +22,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "quakedef.h"
 
-#define	STRINGTEMP_BUFFERS		16
+#define	STRINGTEMP_BUFFERS		64	// power of two
 #define	STRINGTEMP_LENGTH		1024
 static	char	pr_string_temp[STRINGTEMP_BUFFERS][STRINGTEMP_LENGTH];
 static	byte	pr_string_tempindex = 0;
@@ -32,6 +32,102 @@ static char *PR_GetTempString (void)
 	return pr_string_temp[(STRINGTEMP_BUFFERS-1) & ++pr_string_tempindex];
 }
 
+/*
+=================
+PR_FormatInt
+
+sprintf "%d" without going through the format parser.
+Returns the end of the string.
+=================
+*/
+static char *PR_FormatInt (char *s, int v)
+{
+	char			buf[12];
+	unsigned int	u;
+	int				n;
+
+	u = (v < 0) ? 0u - (unsigned int)v : (unsigned int)v;
+	n = 0;
+	do
+	{
+		buf[n++] = '0' + u % 10;
+		u /= 10;
+	} while (u);
+
+	if (v < 0)
+		*s++ = '-';
+	while (n)
+		*s++ = buf[--n];
+	*s = 0;
+	return s;
+}
+
+/*
+=================
+PR_FormatTenths
+
+sprintf "%5.1f" for a float, byte for byte: the exact binary value is
+rounded to tenths with ties to even, as the C library does.  Infinities,
+NaNs and anything from 2^48 up still go through sprintf.
+Returns the end of the string.
+=================
+*/
+static char *PR_FormatTenths (char *s, float v)
+{
+	union { float f; uint32_t u; } bits;
+	uint64_t	m, tenths, rest, half;
+	int			e, n;
+	char		buf[24];
+
+	bits.f = v;
+	e = (bits.u >> 23) & 0xff;
+	if (e >= 127 + 48)
+		return s + sprintf (s, "%5.1f", v);
+
+	// v = m * 2^e exactly
+	m = bits.u & 0x7fffff;
+	if (e)
+	{
+		m |= 0x800000;
+		e -= 150;
+	}
+	else
+		e = -149;
+
+	m *= 10;
+	if (e >= 0)
+		tenths = m << e;
+	else if (e < -32)
+		tenths = 0;		// m * 10 < 2^28, well under half a tenth
+	else
+	{
+		tenths = m >> -e;
+		rest = m & (((uint64_t)1 << -e) - 1);
+		half = (uint64_t)1 << (-e - 1);
+		if (rest > half || (rest == half && (tenths & 1)))
+			tenths++;
+	}
+
+	n = 0;
+	buf[n++] = '0' + tenths % 10;
+	buf[n++] = '.';
+	tenths /= 10;
+	do
+	{
+		buf[n++] = '0' + tenths % 10;
+		tenths /= 10;
+	} while (tenths);
+	if (bits.u >> 31)
+		buf[n++] = '-';
+
+	for (e = n; e < 5; e++)
+		*s++ = ' ';
+	while (n)
+		*s++ = buf[--n];
+	*s = 0;
+	return s;
+}
+
 #define	RETURN_EDICT(e) (((int *)pr_globals)[OFS_RETURN] = EDICT_TO_PROG(e))
 
 #define	MSG_BROADCAST	0		// unreliable to all
@@ -315,6 +411,7 @@ static void PF_setmodel (void)
 	}
 	e->v.model = PR_SetEngineString(*check);
 	e->v.modelindex = i; //SV_ModelIndex (m);
+	ED_HotDirty (e);
 
 	mod = sv.models[ (int)e->v.modelindex];  // Mod_ForName (m, true);
 
@@ -425,18 +522,12 @@ static void PF_normalize (void)
 
 	value1 = G_VECTOR(OFS_PARM0);
 
-	new_temp = (double)value1[0] * value1[0] + (double)value1[1] * value1[1] + (double)value1[2]*value1[2];
-	new_temp = sqrt (new_temp);
+	new_temp = sqrt (SIMD_LengthSquaredD (value1));
 
 	if (new_temp == 0)
 		newvalue[0] = newvalue[1] = newvalue[2] = 0;
 	else
-	{
-		new_temp = 1 / new_temp;
-		newvalue[0] = value1[0] * new_temp;
-		newvalue[1] = value1[1] * new_temp;
-		newvalue[2] = value1[2] * new_temp;
-	}
+		SIMD_VectorScaleD (value1, 1 / new_temp, newvalue);
 
 	VectorCopy (newvalue, G_VECTOR(OFS_RETURN));
 }
@@ -455,8 +546,7 @@ static void PF_vlen (void)
 
 	value1 = G_VECTOR(OFS_PARM0);
 
-	new_temp = (double)value1[0] * value1[0] + (double)value1[1] * value1[1] + (double)value1[2]*value1[2];
-	new_temp = sqrt(new_temp);
+	new_temp = sqrt (SIMD_LengthSquaredD (value1));
 
 	G_FLOAT(OFS_RETURN) = new_temp;
 }
@@ -541,7 +631,7 @@ static void PF_random (void)
 {
 	float		num;
 
-	num = (rand() & 0x7fff) / ((float)0x7fff);
+	num = (SV_Rand() & 0x7fff) / ((float)0x7fff);
 
 	G_FLOAT(OFS_RETURN) = num;
 }
@@ -800,7 +890,7 @@ static int PF_newcheckclient (int check)
 // get the PVS for the entity
 	VectorAdd (ent->v.origin, ent->v.view_ofs, org);
 	leaf = Mod_PointInLeaf (org, sv.worldmodel);
-	pvs = Mod_LeafPVS (leaf, sv.worldmodel);
+	pvs = SV_LeafPVS (leaf);
 	
 	pvsbytes = (sv.worldmodel->numleafs+7)>>3;
 	if (checkpvs == NULL || pvsbytes > checkpvs_capacity)
@@ -957,6 +1047,11 @@ PF_findradius
 Returns a chain of entities that have origins within a spherical area
 
 findradius (origin, radius)
+
+This stays a scan of every edict rather than an area tree query: QC
+often moves an entity or changes its solid with a plain field write and
+no setorigin, and findradius has to see it where it is now, not where
+it was last linked.
 =================
 */
 static void PF_findradius (void)
@@ -1019,9 +1114,9 @@ static void PF_ftos (void)
 	v = G_FLOAT(OFS_PARM0);
 	s = PR_GetTempString();
 	if (v == (int)v)
-		sprintf (s, "%d",(int)v);
+		PR_FormatInt (s, (int)v);
 	else
-		sprintf (s, "%5.1f",v);
+		PR_FormatTenths (s, v);
 	G_INT(OFS_RETURN) = PR_SetEngineString(s);
 }
 
@@ -1034,10 +1129,18 @@ static void PF_fabs (void)
 
 static void PF_vtos (void)
 {
-	char	*s;
+	char	*s, *p;
 
 	s = PR_GetTempString();
-	sprintf (s, "'%5.1f %5.1f %5.1f'", G_VECTOR(OFS_PARM0)[0], G_VECTOR(OFS_PARM0)[1], G_VECTOR(OFS_PARM0)[2]);
+	p = s;
+	*p++ = '\'';
+	p = PR_FormatTenths (p, G_VECTOR(OFS_PARM0)[0]);
+	*p++ = ' ';
+	p = PR_FormatTenths (p, G_VECTOR(OFS_PARM0)[1]);
+	*p++ = ' ';
+	p = PR_FormatTenths (p, G_VECTOR(OFS_PARM0)[2]);
+	*p++ = '\'';
+	*p = 0;
 	G_INT(OFS_RETURN) = PR_SetEngineString(s);
 }
 
@@ -1073,6 +1176,12 @@ static void PF_Find (void)
 	if (!s)
 		PR_RunError ("PF_Find: bad search string");
 
+	if (f == (int)(offsetof(entvars_t, classname) / sizeof(float)) && *s)
+	{
+		RETURN_EDICT(ED_FindClassname (e, s));
+		return;
+	}
+
 	for (e++ ; e < sv.num_edicts ; e++)
 	{
 		ed = EDICT_NUM(e);
@@ -1245,6 +1354,7 @@ static void PF_droptofloor (void)
 		SV_LinkEdict (ent, false);
 		ent->v.flags = (int)ent->v.flags | FL_ONGROUND;
 		ent->v.groundentity = EDICT_TO_PROG(trace.ent);
+		ED_HotDirty (ent);
 		G_FLOAT(OFS_RETURN) = 1;
 	}
 }
@@ -1721,10 +1831,6 @@ static void PF_CheckPlayerEXFlags (void)
 {
 	G_FLOAT(OFS_RETURN) = 0;
 }
-static void PF_walkpathtogoal (void)
-{
-	G_FLOAT(OFS_RETURN) = 0; /* PATH_ERROR */
-}
 static void PF_localsound (void)
 {
 	const char	*sample;
@@ -1744,6 +1850,376 @@ static void PF_Fixme (void)
 	PR_RunError ("unimplemented builtin");
 }
 
+/*
+===============================================================================
+
+	EXTENSION BUILTINS
+
+The common DP/FTE extensions mods otherwise emulate with QuakeC loops.
+They have no slot in pr_builtin; PR_BindBuiltins attaches them to progs
+functions by name.
+
+===============================================================================
+*/
+
+static const char *pr_extensions[] =
+{
+	"DP_QC_CVAR_STRING",
+	"DP_QC_ETOS",
+	"DP_QC_FINDCHAIN",
+	"DP_QC_FINDCHAINFLOAT",
+	"DP_QC_FINDFLOAT",
+	"DP_QC_MINMAXBOUND",
+	"DP_QC_SINCOSSQRTPOW",
+	NULL
+};
+
+/*
+=================
+PF_checkextension
+
+float checkextension(string name)
+=================
+*/
+static void PF_checkextension (void)
+{
+	const char	*name;
+	int			i;
+
+	name = G_STRING(OFS_PARM0);
+	for (i = 0; pr_extensions[i]; i++)
+	{
+		if (!q_strcasecmp (name, pr_extensions[i]))
+		{
+			G_FLOAT(OFS_RETURN) = 1;
+			return;
+		}
+	}
+	G_FLOAT(OFS_RETURN) = 0;
+}
+
+/*
+=================
+PF_findfloat
+
+entity findfloat(entity start, .float field, float match)
+=================
+*/
+static void PF_findfloat (void)
+{
+	int		e;
+	int		f;
+	float	s;
+	edict_t	*ed;
+
+	e = G_EDICTNUM(OFS_PARM0);
+	f = G_INT(OFS_PARM1);
+	s = G_FLOAT(OFS_PARM2);
+
+	for (e++ ; e < sv.num_edicts ; e++)
+	{
+		ed = EDICT_NUM(e);
+		if (ed->free)
+			continue;
+		if (E_FLOAT(ed,f) == s)
+		{
+			RETURN_EDICT(ed);
+			return;
+		}
+	}
+
+	RETURN_EDICT(sv.edicts);
+}
+
+static int PF_ChainField (void)
+{
+	ddef_t	*d;
+
+	d = ED_FindField ("chain");
+	if (!d || (d->type & ~DEF_SAVEGLOBAL) != ev_entity)
+		PR_RunError ("no .entity chain field");
+	return d->ofs;
+}
+
+/*
+=================
+PF_findchain
+
+entity findchain(.string field, string match)
+Links every match through .chain, most recent edict first.
+=================
+*/
+static void PF_findchain (void)
+{
+	int		e;
+	int		f;
+	int		chainfield;
+	const char	*s, *t;
+	edict_t	*ed, *chain;
+
+	f = G_INT(OFS_PARM0);
+	s = G_STRING(OFS_PARM1);
+	chainfield = PF_ChainField ();
+	chain = sv.edicts;
+
+	if (f == (int)(offsetof(entvars_t, classname) / sizeof(float)) && *s)
+	{
+		for (ed = ED_FindClassname (0, s); ed != sv.edicts; ed = ED_FindClassname (NUM_FOR_EDICT(ed), s))
+		{
+			E_INT(ed, chainfield) = EDICT_TO_PROG(chain);
+			chain = ed;
+		}
+		RETURN_EDICT(chain);
+		return;
+	}
+
+	for (e = 1 ; e < sv.num_edicts ; e++)
+	{
+		ed = EDICT_NUM(e);
+		if (ed->free)
+			continue;
+		t = E_STRING(ed,f);
+		if (strcmp (t ? t : "", s))
+			continue;
+		E_INT(ed, chainfield) = EDICT_TO_PROG(chain);
+		chain = ed;
+	}
+
+	RETURN_EDICT(chain);
+}
+
+/*
+=================
+PF_findchainfloat
+
+entity findchainfloat(.float field, float match)
+=================
+*/
+static void PF_findchainfloat (void)
+{
+	int		e;
+	int		f;
+	int		chainfield;
+	float	s;
+	edict_t	*ed, *chain;
+
+	f = G_INT(OFS_PARM0);
+	s = G_FLOAT(OFS_PARM1);
+	chainfield = PF_ChainField ();
+	chain = sv.edicts;
+
+	for (e = 1 ; e < sv.num_edicts ; e++)
+	{
+		ed = EDICT_NUM(e);
+		if (ed->free)
+			continue;
+		if (E_FLOAT(ed,f) != s)
+			continue;
+		E_INT(ed, chainfield) = EDICT_TO_PROG(chain);
+		chain = ed;
+	}
+
+	RETURN_EDICT(chain);
+}
+
+/*
+=================
+PF_min / PF_max / PF_bound
+
+float min(float a, float b, ...)
+float max(float a, float b, ...)
+float bound(float min, float value, float max)
+=================
+*/
+static void PF_min (void)
+{
+	float	f;
+	int		i;
+
+	if (pr_argc < 2)
+		PR_RunError ("min: needs at least 2 parameters");
+	f = G_FLOAT(OFS_PARM0);
+	for (i = 1; i < pr_argc; i++)
+		f = q_min (f, G_FLOAT(OFS_PARM0 + i * 3));
+	G_FLOAT(OFS_RETURN) = f;
+}
+
+static void PF_max (void)
+{
+	float	f;
+	int		i;
+
+	if (pr_argc < 2)
+		PR_RunError ("max: needs at least 2 parameters");
+	f = G_FLOAT(OFS_PARM0);
+	for (i = 1; i < pr_argc; i++)
+		f = q_max (f, G_FLOAT(OFS_PARM0 + i * 3));
+	G_FLOAT(OFS_RETURN) = f;
+}
+
+static float PF_bound (float minval, float val, float maxval)
+{
+	return q_max (minval, q_min (val, maxval));
+}
+
+static float PF_stof (const char *s)
+{
+	return atof (s);
+}
+
+static float PF_strlen (const char *s)
+{
+	return strlen (s);
+}
+
+/*
+=================
+PF_etos
+
+string etos(entity e)
+=================
+*/
+static void PF_etos (void)
+{
+	char	*s;
+
+	s = PR_GetTempString();
+	memcpy (s, "entity ", 7);
+	PR_FormatInt (s + 7, G_EDICTNUM(OFS_PARM0));
+	G_INT(OFS_RETURN) = PR_SetEngineString(s);
+}
+
+/*
+=================
+PF_stov
+
+vector stov(string s)
+Accepts the vtos format, quotes included.
+=================
+*/
+static void PF_stov (void)
+{
+	const char	*s;
+	char		*end;
+	float		*v;
+	int			i;
+
+	s = G_STRING(OFS_PARM0);
+	v = G_VECTOR(OFS_RETURN);
+	v[0] = v[1] = v[2] = 0;
+	for (i = 0; i < 3; i++)
+	{
+		while (*s == ' ' || *s == '\t' || *s == '\'')
+			s++;
+		v[i] = strtod (s, &end);
+		if (end == s)
+			break;
+		s = end;
+	}
+}
+
+/*
+=================
+PF_strcat
+
+string strcat(string s1, ...)
+=================
+*/
+static void PF_strcat (void)
+{
+	char	*s;
+	int		i;
+
+	s = PR_GetTempString();
+	s[0] = 0;
+	for (i = 0; i < pr_argc; i++)
+		q_strlcat (s, G_STRING(OFS_PARM0 + i * 3), STRINGTEMP_LENGTH);
+	G_INT(OFS_RETURN) = PR_SetEngineString(s);
+}
+
+/*
+=================
+PF_substring
+
+string substring(string s, float start, float length)
+A negative start counts from the end, a negative length stops short of it.
+=================
+*/
+static void PF_substring (void)
+{
+	const char	*str;
+	char		*s;
+	int			len, start, length;
+
+	str = G_STRING(OFS_PARM0);
+	start = (int)G_FLOAT(OFS_PARM1);
+	length = (int)G_FLOAT(OFS_PARM2);
+	len = strlen (str);
+
+	if (start < 0)
+		start += len;
+	if (length < 0)
+		length += len - start + 1;
+	if (start < 0)
+	{
+		length += start;
+		start = 0;
+	}
+	length = q_min (length, len - start);
+	length = q_min (length, STRINGTEMP_LENGTH - 1);
+
+	s = PR_GetTempString();
+	if (start >= len || length <= 0)
+		s[0] = 0;
+	else
+	{
+		memcpy (s, str + start, length);
+		s[length] = 0;
+	}
+	G_INT(OFS_RETURN) = PR_SetEngineString(s);
+}
+
+/*
+=================
+PF_strzone / PF_strunzone
+
+string strzone(string s)
+void strunzone(string s)
+=================
+*/
+static void PF_strzone (void)
+{
+	const char	*s;
+	char		*buf;
+	int			len;
+
+	s = G_STRING(OFS_PARM0);
+	len = strlen (s) + 1;
+	G_INT(OFS_RETURN) = PR_AllocString (len, &buf);
+	memcpy (buf, s, len);
+}
+
+static void PF_strunzone (void)
+{
+	PR_FreeString (G_INT(OFS_PARM0));
+}
+
+/*
+=================
+PF_cvar_string
+
+string cvar_string(string name)
+=================
+*/
+static void PF_cvar_string (void)
+{
+	char	*s;
+
+	s = PR_GetTempString();
+	q_strlcpy (s, Cvar_VariableString (G_STRING(OFS_PARM0)), STRINGTEMP_LENGTH);
+	G_INT(OFS_RETURN) = PR_SetEngineString(s);
+}
+
 
 static builtin_t pr_builtin[] =
 {
@@ -1849,10 +2325,173 @@ static builtin_t pr_builtin[] =
 	PF_Fixme,		// void draw_cylinder (vector origin, float halfHeight, float radius, float colormap, float lifetime, float depthtest) = #89
 
 	PF_CheckPlayerEXFlags,
-	PF_walkpathtogoal,
+	SV_WalkPathToGoal,
 
 	PF_Fixme,
 };
 
 const builtin_t *pr_builtins = pr_builtin;
 const int pr_numbuiltins = Q_COUNTOF(pr_builtin);
+
+
+/*
+===============================================================================
+
+	BUILTIN BINDING
+
+Every builtin progs function gets its prcall_t when progs are loaded:
+numbered builtins index pr_builtin, extensions are looked up by name.
+A typed builtin is plain C with a signature; its thunk decodes the
+arguments from the parm globals and stores the result, so libm
+functions can be bound directly.  Those take the double signatures, so
+they round exactly as the old PF_sin and friends did.  Only the
+extension list is typed; numbered builtins keep decoding their own
+parms.
+
+===============================================================================
+*/
+
+typedef enum
+{
+	PR_SIG_RAW,			// builtin_t, does its own decoding
+	PR_SIG_F_FFF,		// float (float, float, float)
+	PR_SIG_F_S,			// float (const char *)
+	PR_SIG_D_D,			// double (double)
+	PR_SIG_D_DD			// double (double, double)
+} prsig_t;
+
+typedef struct
+{
+	const char	*name;
+	int			number;		// the usual number in the DP/FTE lists
+	prsig_t		sig;
+	builtin_t	func;		// cast back to sig before calling
+} prextbuiltin_t;
+
+static void PR_CallF_FFF (builtin_t func)
+{
+	G_FLOAT(OFS_RETURN) = ((float (*) (float, float, float)) func) (G_FLOAT(OFS_PARM0), G_FLOAT(OFS_PARM1), G_FLOAT(OFS_PARM2));
+}
+
+static void PR_CallF_S (builtin_t func)
+{
+	G_FLOAT(OFS_RETURN) = ((float (*) (const char *)) func) (G_STRING(OFS_PARM0));
+}
+
+static void PR_CallD_D (builtin_t func)
+{
+	G_FLOAT(OFS_RETURN) = ((double (*) (double)) func) (G_FLOAT(OFS_PARM0));
+}
+
+static void PR_CallD_DD (builtin_t func)
+{
+	G_FLOAT(OFS_RETURN) = ((double (*) (double, double)) func) (G_FLOAT(OFS_PARM0), G_FLOAT(OFS_PARM1));
+}
+
+static const prthunk_t pr_thunks[] =
+{
+	NULL,
+	PR_CallF_FFF,
+	PR_CallF_S,
+	PR_CallD_D,
+	PR_CallD_DD
+};
+
+static const prextbuiltin_t pr_extbuiltins[] =
+{
+	{ "sin",			60,		PR_SIG_D_D,		(builtin_t) sin },
+	{ "cos",			61,		PR_SIG_D_D,		(builtin_t) cos },
+	{ "sqrt",			62,		PR_SIG_D_D,		(builtin_t) sqrt },
+	{ "etos",			65,		PR_SIG_RAW,		PF_etos },
+	{ "stof",			81,		PR_SIG_F_S,		(builtin_t) PF_stof },
+	{ "min",			94,		PR_SIG_RAW,		PF_min },
+	{ "max",			95,		PR_SIG_RAW,		PF_max },
+	{ "bound",			96,		PR_SIG_F_FFF,	(builtin_t) PF_bound },
+	{ "pow",			97,		PR_SIG_D_DD,	(builtin_t) pow },
+	{ "findfloat",		98,		PR_SIG_RAW,		PF_findfloat },
+	{ "checkextension",	99,		PR_SIG_RAW,		PF_checkextension },
+	{ "strlen",			114,	PR_SIG_F_S,		(builtin_t) PF_strlen },
+	{ "strcat",			115,	PR_SIG_RAW,		PF_strcat },
+	{ "substring",		116,	PR_SIG_RAW,		PF_substring },
+	{ "stov",			117,	PR_SIG_RAW,		PF_stov },
+	{ "strzone",		118,	PR_SIG_RAW,		PF_strzone },
+	{ "strunzone",		119,	PR_SIG_RAW,		PF_strunzone },
+	{ "findchain",		402,	PR_SIG_RAW,		PF_findchain },
+	{ "findchainfloat",	403,	PR_SIG_RAW,		PF_findchainfloat },
+	{ "cvar_string",	448,	PR_SIG_RAW,		PF_cvar_string },
+	{ NULL,				0,		PR_SIG_RAW,		NULL }
+};
+
+// the 2021 re-release took #79-#91 for its own builtins
+#define PR_REREL_FIRST		79
+#define PR_REREL_LAST		91
+
+prcall_t	*pr_funccalls;
+
+static void PR_BadBuiltin (void)
+{
+	func_t	fnum;
+
+	fnum = G_FUNCTION((unsigned short)pr_statements[pr_xstatement].a);
+	PR_RunError ("Bad builtin call number %d", -pr_functions[fnum].first_statement);
+}
+
+/*
+=================
+PR_MatchExtBuiltin
+
+By name with #0 or the usual number; by number alone only where
+pr_builtin has nothing there and the re-release can't have claimed it.
+=================
+*/
+static qboolean PR_MatchExtBuiltin (const prextbuiltin_t *ext, const char *name, int num)
+{
+	if (!strcmp (name, ext->name))
+		return num == 0 || num == ext->number;
+	if (num != ext->number || (num >= PR_REREL_FIRST && num <= PR_REREL_LAST))
+		return false;
+	return num >= pr_numbuiltins || pr_builtins[num] == PF_Fixme;
+}
+
+/*
+=================
+PR_BindBuiltins
+
+Bound extensions get a number past pr_builtin, so the call site's
+first_statement < 0 test keeps working.  Unmatched #0 functions are
+left alone, mods are expected to checkextension before using them.
+=================
+*/
+void PR_BindBuiltins (void)
+{
+	const prextbuiltin_t	*ext;
+	dfunction_t	*f;
+	const char	*name;
+	int			i, num;
+
+	pr_funccalls = (prcall_t *) Hunk_AllocName (progs->numfunctions * sizeof(prcall_t), "builtins");
+
+	for (i = 1; i < progs->numfunctions; i++)
+	{
+		f = &pr_functions[i];
+		if (f->first_statement > 0)
+			continue;
+
+		num = -f->first_statement;
+		name = PR_GetString (f->s_name);
+		for (ext = pr_extbuiltins; ext->name; ext++)
+		{
+			if (PR_MatchExtBuiltin (ext, name, num))
+				break;
+		}
+
+		if (ext->name)
+		{
+			f->first_statement = -(pr_numbuiltins + (int)(ext - pr_extbuiltins));
+			pr_funccalls[i].thunk = pr_thunks[ext->sig];
+			pr_funccalls[i].func = ext->func;
+		}
+		else if (num > 0)
+			pr_funccalls[i].func = (num < pr_numbuiltins) ? pr_builtins[num] : PR_BadBuiltin;
+	}
+}
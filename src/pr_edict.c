@@ -28,9 +28,13 @@ dfunction_t		*pr_functions;
 
 static	char		*pr_strings;
 static	int		pr_stringssize;
+static	int		pr_progssize;	// bytes in progs.dat
 static	const char	**pr_knownstrings;
 static	int		pr_maxknownstrings;
 static	int		pr_numknownstrings;
+static void PR_ClearStrings (void);
+static qboolean PR_AllocatedString (int num);
+static void ED_ClearClassIndex (void);
 static	ddef_t		*pr_fielddefs;
 static	ddef_t		*pr_globaldefs;
 
@@ -60,20 +64,6 @@ int		type_size[8] = {
 static ddef_t	*ED_FieldAtOfs (int ofs);
 static qboolean	ED_ParseEpair (void *base, ddef_t *key, const char *s);
 
-#define	MAX_FIELD_LEN	64
-#define	GEFV_CACHESIZE	2
-
-typedef struct {
-	ddef_t	*pcache;
-	char	field[MAX_FIELD_LEN];
-} gefv_cache;
-
-static gefv_cache	gefvCache[GEFV_CACHESIZE] =
-{
-		{ NULL,	"" },
-		{ NULL,	"" }
-};
-
 cvar_t	nomonsters = {"nomonsters", "0", CVAR_NONE};
 cvar_t	gamecfg = {"gamecfg", "0", CVAR_NONE};
 cvar_t	scratch1 = {"scratch1", "0", CVAR_NONE};
@@ -97,6 +87,66 @@ void ED_ClearEdict (edict_t *e)
 {
 	memset (&e->v, 0, progs->entityfields * 4);
 	e->free = false;
+	ED_UpdateClassIndex (e);
+	ED_HotDirty (e);
+}
+
+/*
+=================
+ED_CanReuse
+
+The first couple seconds of server time can involve a lot of freeing and
+allocating, so relax the replacement policy
+=================
+*/
+static qboolean ED_CanReuse (edict_t *e)
+{
+	return e->freetime < 2 || sv.time - e->freetime > 0.5;
+}
+
+/*
+=================
+ED_UnlinkFree
+
+Removes an edict from the free queue if it is on it
+=================
+*/
+static void ED_UnlinkFree (edict_t *e)
+{
+	int		num = NUM_FOR_EDICT(e);
+
+	if (num >= sv.num_edicts || (!e->freeprev && sv.free_head != num))
+		return;		// not queued
+
+	if (e->freeprev)
+		EDICT_NUM(e->freeprev)->freenext = e->freenext;
+	else
+		sv.free_head = e->freenext;
+	if (e->freenext)
+		EDICT_NUM(e->freenext)->freeprev = e->freeprev;
+	else
+		sv.free_tail = e->freeprev;
+	e->freeprev = e->freenext = 0;
+}
+
+/*
+=================
+ED_LinkFree
+
+Appends an edict to the free queue, which is kept in freetime order
+=================
+*/
+static void ED_LinkFree (edict_t *e)
+{
+	int		num = NUM_FOR_EDICT(e);
+
+	e->freenext = 0;
+	e->freeprev = sv.free_tail;
+	if (sv.free_tail)
+		EDICT_NUM(sv.free_tail)->freenext = num;
+	else
+		sv.free_head = num;
+	sv.free_tail = num;
 }
 
 /*
@@ -108,6 +158,9 @@ Try to avoid reusing an entity that was recently freed, because it
 can cause the client to think the entity morphed into something else
 instead of being removed and recreated, which can cause interpolated
 angles and bad trails.
+
+Free edicts wait on a queue in the order they were freed, so only the
+head ever needs to be checked against the reuse delay.
 =================
 */
 edict_t *ED_Alloc (void)
@@ -115,18 +168,18 @@ edict_t *ED_Alloc (void)
 	int			i;
 	edict_t		*e;
 
-	for (i = svs.maxclients + 1; i < sv.num_edicts; i++)
+	if (sv.free_head)
 	{
-		e = EDICT_NUM(i);
-		// the first couple seconds of server time can involve a lot of
-		// freeing and allocating, so relax the replacement policy
-		if (e->free && ( e->freetime < 2 || sv.time - e->freetime > 0.5 ) )
+		e = EDICT_NUM(sv.free_head);
+		if (ED_CanReuse (e))
 		{
+			ED_UnlinkFree (e);
 			ED_ClearEdict (e);
 			return e;
 		}
 	}
 
+	i = sv.num_edicts;
 	if (i == sv.max_edicts) //johnfitz -- use sv.max_edicts instead of MAX_EDICTS
 		Host_Error ("ED_Alloc: no free edicts (max_edicts is %i)", sv.max_edicts);
 
@@ -134,6 +187,7 @@ edict_t *ED_Alloc (void)
 	e = EDICT_NUM(i);
 	memset(e, 0, pr_edict_size); // ericw -- switched sv.edicts to malloc(), so we are accessing uninitialized memory and must fully zero it, not just ED_ClearEdict
 	e->baseline.scale = ENTSCALE_DEFAULT;
+	ED_HotDirty (e);
 
 	return e;
 }
@@ -148,6 +202,8 @@ FIXME: walk all entities and NULL out references to this entity
 */
 void ED_Free (edict_t *ed)
 {
+	int		num;
+
 	SV_UnlinkEdict (ed);		// unlink from world bsp
 
 	ed->free = true;
@@ -165,809 +221,2501 @@ void ED_Free (edict_t *ed)
 	ed->scale = ENTSCALE_DEFAULT;
 
 	ed->freetime = sv.time;
-}
 
-//===========================================================================
+	ED_UpdateClassIndex (ed);
+	ED_HotDirty (ed);
+
+	// requeue at the tail, client slots and trimmed edicts are never handed out
+	ED_UnlinkFree (ed);
+	num = NUM_FOR_EDICT(ed);
+	if (num > svs.maxclients && num < sv.num_edicts)
+		ED_LinkFree (ed);
+}
 
 /*
-============
-ED_GlobalAtOfs
-============
+=================
+ED_TrimFreeEdicts
+
+Drops free edicts off the end of the edict list once their reuse delay has
+passed, so per-edict loops don't keep scanning dead slots.  Called once per
+server frame.
+=================
 */
-static ddef_t *ED_GlobalAtOfs (int ofs)
+void ED_TrimFreeEdicts (void)
 {
-	ddef_t		*def;
-	int			i;
+	edict_t		*e;
 
-	for (i = 0; i < progs->numglobaldefs; i++)
+	while (sv.num_edicts > svs.maxclients + 1)
 	{
-		def = &pr_globaldefs[i];
-		if (def->ofs == ofs)
-			return def;
+		e = EDICT_NUM(sv.num_edicts - 1);
+		if (!e->free || !ED_CanReuse (e))
+			break;
+		ED_UnlinkFree (e);
+		sv.num_edicts--;
 	}
-	return NULL;
 }
 
-/*
-============
-ED_FieldAtOfs
-============
-*/
-static ddef_t *ED_FieldAtOfs (int ofs)
+static int ED_CompareFreetime (const void *a, const void *b)
 {
-	ddef_t		*def;
-	int			i;
+	const edict_t	*ea = EDICT_NUM(*(const int *)a);
+	const edict_t	*eb = EDICT_NUM(*(const int *)b);
 
-	for (i = 0; i < progs->numfielddefs; i++)
-	{
-		def = &pr_fielddefs[i];
-		if (def->ofs == ofs)
-			return def;
-	}
-	return NULL;
+	if (ea->freetime != eb->freetime)
+		return ea->freetime < eb->freetime ? -1 : 1;
+	return *(const int *)a - *(const int *)b;
 }
 
 /*
-============
-ED_FindField
-============
+=================
+ED_RebuildFreeList
+
+Recreates the free queue from the free flags, for when edicts have been
+overwritten wholesale (loading a saved game)
+=================
 */
-static ddef_t *ED_FindField (const char *name)
+void ED_RebuildFreeList (void)
 {
-	ddef_t		*def;
-	int			i;
+	int		i, count;
+	int		*order;
+	edict_t		*e;
 
-	for (i = 0; i < progs->numfielddefs; i++)
+	sv.free_head = sv.free_tail = 0;
+	order = (int *) malloc (sv.num_edicts * sizeof(int));
+	if (!order)
+		Sys_Error ("ED_RebuildFreeList: out of memory");
+
+	for (i = 0; i < sv.num_edicts; i++)
 	{
-		def = &pr_fielddefs[i];
-		if ( !strcmp(PR_GetString(def->s_name), name) )
-			return def;
+		e = EDICT_NUM(i);
+		e->freeprev = e->freenext = 0;
 	}
-	return NULL;
+	for (i = svs.maxclients + 1, count = 0; i < sv.num_edicts; i++)
+	{
+		if (EDICT_NUM(i)->free)
+			order[count++] = i;
+	}
+	qsort (order, count, sizeof(int), ED_CompareFreetime);
+	for (i = 0; i < count; i++)
+		ED_LinkFree (EDICT_NUM(order[i]));
+
+	free (order);
 }
 
+/*
+===============================================================================
+
+HOT FIELD MIRROR
+
+Optional structure-of-arrays copy of the edict fields the per-frame loops
+filter on, so idle edicts can be skipped without touching their edict_t.
+An entry is only trusted while valid[] is set: it is refreshed after the
+physics loop has visited the edict, and cleared by any progs store into the
+edict, by ED_Alloc/ED_Free and by engine code that changes a mirrored field
+outside the physics loop.
+
+On top of the mirror sits the think scheduler.  An edict whose entry is
+valid and whose movetype does nothing without a think is asleep; every
+other edict has its awake bit set.  Sleeping edicts with a pending think
+wait in a min-heap on nextthink, so a frame only visits the awake edicts
+and the ones ED_HotWakeDue pops off the heap.
+===============================================================================
+*/
+
+edicthot_t	ed_hot;
+
+static void ED_HotFree (void)
+{
+	free (ed_hot.valid);
+	free (ed_hot.free);
+	free (ed_hot.movetype);
+	free (ed_hot.flags);
+	free (ed_hot.nextthink);
+	free (ed_hot.modelindex);
+	free (ed_hot.awake);
+	free (ed_hot.due);
+	free (ed_hot.queued);
+	free (ed_hot.heap);
+	memset (&ed_hot, 0, sizeof(ed_hot));
+}
 
 /*
-============
-ED_FindGlobal
-============
+=================
+ED_HotInit
+
+(Re)allocates the mirror for sv.max_edicts, or turns it off.  Every entry
+starts out invalid and awake.
+=================
 */
-static ddef_t *ED_FindGlobal (const char *name)
+void ED_HotInit (qboolean enable)
 {
-	ddef_t		*def;
-	int			i;
+	int		n, words;
 
-	for (i = 0; i < progs->numglobaldefs; i++)
+	ED_HotFree ();
+	if (!enable)
+		return;
+
+	n = sv.max_edicts;
+	words = (n + 31) >> 5;
+	ed_hot.valid = (byte *) calloc (n, sizeof(byte));
+	ed_hot.free = (byte *) calloc (n, sizeof(byte));
+	ed_hot.movetype = (byte *) calloc (n, sizeof(byte));
+	ed_hot.flags = (int *) calloc (n, sizeof(int));
+	ed_hot.nextthink = (float *) calloc (n, sizeof(float));
+	ed_hot.modelindex = (float *) calloc (n, sizeof(float));
+	ed_hot.awake = (unsigned int *) malloc (words * sizeof(unsigned int));
+	ed_hot.due = (unsigned int *) calloc (words, sizeof(unsigned int));
+	ed_hot.queued = (float *) calloc (n, sizeof(float));
+	if (!ed_hot.valid || !ed_hot.free || !ed_hot.movetype || !ed_hot.flags || !ed_hot.nextthink
+	 || !ed_hot.modelindex || !ed_hot.awake || !ed_hot.due || !ed_hot.queued)
+		Sys_Error ("ED_HotInit: failed on allocation for %i edicts", n);
+	memset (ed_hot.awake, 0xff, words * sizeof(unsigned int));
+	ed_hot.count = n;
+}
+
+/*
+=================
+ED_HotSleepable
+
+True if physics for this movetype does nothing unless a think is due
+=================
+*/
+qboolean ED_HotSleepable (int movetype, int flags)
+{
+	switch (movetype)
 	{
-		def = &pr_globaldefs[i];
-		if ( !strcmp(PR_GetString(def->s_name), name) )
-			return def;
+	case MOVETYPE_NONE:
+		return true;
+	case MOVETYPE_STEP:
+		return (flags & (FL_ONGROUND | FL_FLY | FL_SWIM)) != 0;
+	case MOVETYPE_TOSS:
+	case MOVETYPE_GIB:
+	case MOVETYPE_BOUNCE:
+	case MOVETYPE_FLY:
+	case MOVETYPE_FLYMISSILE:
+		return (flags & FL_ONGROUND) != 0;
+	default:
+		return false;
 	}
-	return NULL;
 }
 
+static void ED_HotHeapPush (float time, int num)
+{
+	thinkentry_t	entry;
+	int		i, parent;
 
-/*
-============
-ED_FindFunction
-============
-*/
-static dfunction_t *ED_FindFunction (const char *fn_name)
+	if (ed_hot.heapsize == ed_hot.heapmax)
+	{
+		ed_hot.heapmax = ed_hot.heapmax ? ed_hot.heapmax * 2 : 1024;
+		ed_hot.heap = (thinkentry_t *) realloc (ed_hot.heap, ed_hot.heapmax * sizeof(thinkentry_t));
+		if (!ed_hot.heap)
+			Sys_Error ("ED_HotHeapPush: failed on allocation of %i entries", ed_hot.heapmax);
+	}
+
+	entry.time = time;
+	entry.num = num;
+	for (i = ed_hot.heapsize++; i > 0; i = parent)
+	{
+		parent = (i - 1) >> 1;
+		if (ed_hot.heap[parent].time <= time)
+			break;
+		ed_hot.heap[i] = ed_hot.heap[parent];
+	}
+	ed_hot.heap[i] = entry;
+}
+
+static thinkentry_t ED_HotHeapPop (void)
 {
-	dfunction_t		*func;
-	int				i;
+	thinkentry_t	top, last;
+	int		i, child;
 
-	for (i = 0; i < progs->numfunctions; i++)
+	top = ed_hot.heap[0];
+	last = ed_hot.heap[--ed_hot.heapsize];
+	for (i = 0; (child = 2 * i + 1) < ed_hot.heapsize; i = child)
 	{
-		func = &pr_functions[i];
-		if ( !strcmp(PR_GetString(func->s_name), fn_name) )
-			return func;
+		if (child + 1 < ed_hot.heapsize && ed_hot.heap[child + 1].time < ed_hot.heap[child].time)
+			child++;
+		if (last.time <= ed_hot.heap[child].time)
+			break;
+		ed_hot.heap[i] = ed_hot.heap[child];
 	}
-	return NULL;
+	ed_hot.heap[i] = last;
+	return top;
 }
 
 /*
-============
-GetEdictFieldValue
-============
+=================
+ED_HotRefresh
+
+Copies the mirrored fields of an edict into the mirror, and puts it to
+sleep or queues its think when it has nothing else to do
+=================
 */
-eval_t *GetEdictFieldValue(edict_t *ed, const char *field)
+void ED_HotRefresh (edict_t *ed, int num)
 {
-	ddef_t			*def = NULL;
-	int				i;
-	static int		rep = 0;
-
-	for (i = 0; i < GEFV_CACHESIZE; i++)
+	int		movetype = (int)ed->v.movetype;
+	qboolean	asleep;
+
+	ed_hot.free[num] = ed->free;
+	ed_hot.movetype[num] = (movetype >= 0 && movetype < 255) ? movetype : 255;
+	ed_hot.flags[num] = (int)ed->v.flags;
+	ed_hot.nextthink[num] = ed->v.nextthink;
+	ed_hot.modelindex[num] = ed->v.modelindex;
+	ed_hot.valid[num] = true;
+
+	asleep = ed->free || ED_HotSleepable (ed_hot.movetype[num], ed_hot.flags[num]);
+	if (!asleep)
 	{
-		if (!strcmp(field, gefvCache[i].field))
-		{
-			def = gefvCache[i].pcache;
-			goto Done;
-		}
+		ed_hot.awake[num >> 5] |= 1u << (num & 31);
+		return;
 	}
+	ed_hot.awake[num >> 5] &= ~(1u << (num & 31));
 
-	def = ED_FindField (field);
-
-	if (strlen(field) < MAX_FIELD_LEN)
+	// one live heap entry per edict, keyed on the nextthink it was queued with
+	if (!ed->free && ed->v.nextthink > 0 && ed_hot.queued[num] != ed->v.nextthink)
 	{
-		gefvCache[rep].pcache = def;
-		strcpy (gefvCache[rep].field, field);
-		rep ^= 1;
+		ed_hot.queued[num] = ed->v.nextthink;
+		ED_HotHeapPush (ed->v.nextthink, num);
 	}
+}
 
-Done:
-	if (!def)
-		return NULL;
+/*
+=================
+ED_HotDirty
 
-	return (eval_t *)((char *)&ed->v + def->ofs*4);
-}
+Call after changing movetype, flags, nextthink, modelindex or frame from
+engine code outside the physics loop
+=================
+*/
+void ED_HotDirty (edict_t *ed)
+{
+	int		num;
 
+	if (ed_hot.count)
+	{
+		num = NUM_FOR_EDICT(ed);
+		ed_hot.valid[num] = false;
+		ed_hot.awake[num >> 5] |= 1u << (num & 31);
+	}
+}
 
 /*
-============
-PR_ValueString
-(etype_t type, eval_t *val)
+=================
+ED_HotWakeDue
 
-Returns a string describing *data in a type specific manner
-=============
+Marks the sleeping edicts whose think falls before time as due for this
+frame.  Stale heap entries (edicts woken or requeued since) are dropped.
+=================
 */
-static const char *PR_ValueString (int type, eval_t *val)
+void ED_HotWakeDue (double time)
 {
-	static char	line[512];
-	ddef_t		*def;
-	dfunction_t	*f;
+	thinkentry_t	entry;
+	int		i, num;
 
-	type &= ~DEF_SAVEGLOBAL;
+	memset (ed_hot.due, 0, ((sv.num_edicts + 31) >> 5) * sizeof(unsigned int));
 
-	switch (type)
+	while (ed_hot.heapsize && ed_hot.heap[0].time <= time)
 	{
-	case ev_string:
-		q_snprintf (line, sizeof(line), "%s", PR_GetString(val->string));
-		break;
-	case ev_entity:
-		q_snprintf (line, sizeof(line), "entity %i", NUM_FOR_EDICT(PROG_TO_EDICT(val->edict)) );
-		break;
-	case ev_function:
-		f = pr_functions + val->function;
-		q_snprintf (line, sizeof(line), "%s()", PR_GetString(f->s_name));
-		break;
-	case ev_field:
-		def = ED_FieldAtOfs ( val->_int );
-		q_snprintf (line, sizeof(line), ".%s", PR_GetString(def->s_name));
-		break;
-	case ev_void:
-		q_snprintf (line, sizeof(line), "void");
-		break;
-	case ev_float:
-		q_snprintf (line, sizeof(line), "%5.1f", val->_float);
-		break;
-	case ev_vector:
-		q_snprintf (line, sizeof(line), "'%5.1f %5.1f %5.1f'", val->vector[0], val->vector[1], val->vector[2]);
-		break;
-	case ev_pointer:
-		q_snprintf (line, sizeof(line), "pointer");
-		break;
-	default:
-		q_snprintf (line, sizeof(line), "bad type %i", type);
-		break;
+		entry = ED_HotHeapPop ();
+		num = entry.num;
+		if (ed_hot.queued[num] != entry.time)
+			continue;	// requeued with another nextthink
+		ed_hot.queued[num] = 0;
+		if (num >= sv.num_edicts || !ed_hot.valid[num] || ed_hot.nextthink[num] != entry.time)
+			continue;	// changed since, the awake bit covers it
+		ed_hot.due[num >> 5] |= 1u << (num & 31);
 	}
 
-	return line;
+	// too many stale entries, rebuild from the sleeping edicts
+	if (ed_hot.heapsize > 2 * sv.num_edicts + 1024)
+	{
+		ed_hot.heapsize = 0;
+		for (i = 0; i < sv.num_edicts; i++)
+		{
+			ed_hot.queued[i] = 0;
+			if (ed_hot.valid[i] && !ed_hot.free[i] && ed_hot.nextthink[i] > 0
+			 && !(ed_hot.awake[i >> 5] & (1u << (i & 31))))
+			{
+				ed_hot.queued[i] = ed_hot.nextthink[i];
+				ED_HotHeapPush (ed_hot.nextthink[i], i);
+			}
+		}
+	}
 }
 
 /*
-============
-PR_UglyValueString
-(etype_t type, eval_t *val)
+=================
+ED_HotNextActive
 
-Returns a string describing *data in a type specific manner
-Easier to parse than PR_ValueString
-=============
+Returns the first edict after num that is awake or due, or end if none
+=================
 */
-static const char *PR_UglyValueString (int type, eval_t *val)
+int ED_HotNextActive (int num, int end)
 {
-	static char	line[1024];
-	ddef_t		*def;
-	dfunction_t	*f;
+	unsigned int	bits;
+	int		word, lastword;
 
-	type &= ~DEF_SAVEGLOBAL;
+	num++;
+	if (num >= end)
+		return end;
 
-	switch (type)
+	word = num >> 5;
+	lastword = (end - 1) >> 5;
+	bits = (ed_hot.awake[word] | ed_hot.due[word]) & (~0u << (num & 31));
+	while (!bits)
 	{
-	case ev_string:
-		q_snprintf (line, sizeof(line), "%s", PR_GetString(val->string));
-		break;
-	case ev_entity:
-		q_snprintf (line, sizeof(line), "%i", NUM_FOR_EDICT(PROG_TO_EDICT(val->edict)));
-		break;
-	case ev_function:
-		f = pr_functions + val->function;
-		q_snprintf (line, sizeof(line), "%s", PR_GetString(f->s_name));
-		break;
-	case ev_field:
-		def = ED_FieldAtOfs ( val->_int );
-		q_snprintf (line, sizeof(line), "%s", PR_GetString(def->s_name));
-		break;
-	case ev_void:
-		q_snprintf (line, sizeof(line), "void");
-		break;
-	case ev_float:
-		q_snprintf (line, sizeof(line), "%f", val->_float);
-		break;
-	case ev_vector:
-		q_snprintf (line, sizeof(line), "%f %f %f", val->vector[0], val->vector[1], val->vector[2]);
-		break;
-	default:
-		q_snprintf (line, sizeof(line), "bad type %i", type);
-		break;
+		if (++word > lastword)
+			return end;
+		bits = ed_hot.awake[word] | ed_hot.due[word];
 	}
 
-	return line;
+	num = word << 5;
+	while (!(bits & 1))
+	{
+		bits >>= 1;
+		num++;
+	}
+	return num < end ? num : end;
 }
 
 /*
-============
-PR_GlobalString
-
-Returns a string with a description and the contents of a global,
-padded to 20 field width
-============
+===============================================================================
+
+CLASSNAME INDEX
+
+find (e, classname, "name") loops used to rescan every edict on each call.
+Every non-free edict with a non-empty classname is kept on a per-classname
+list sorted by edict number, so a find only walks edicts of that class.
+ED_UpdateClassIndex must be called whenever an edict's classname may have
+changed.  Edicts whose classname is an engine string (a temp buffer, or
+memory the engine may rewrite) are kept on one volatile list instead, and
+every lookup checks their live text.  The text behind a strzone string
+changes when strunzone frees its slot for reuse, so a free marks the index
+stale, and so does a lookup that meets an edict whose live classname no
+longer matches its list; the next lookup then files every edict again.
+===============================================================================
 */
-const char *PR_GlobalString (int ofs)
+
+typedef struct
+{
+	char		*name;
+	int		count, maxcount;
+	int		*ents;		// sorted edict numbers
+} edictclass_t;
+
+static	edictclass_t	*ed_classes;
+static	int		ed_numclasses, ed_maxclasses;
+static	int		*ed_classhash;	// class+1, 0 = empty
+static	int		ed_classhashsize;
+static	edictclass_t	ed_classvolatile;	// classindex -1
+static	qboolean	ed_classstale;
+
+static void ED_ClearClassIndex (void)
 {
-	static char	line[512];
-	const char	*s;
 	int		i;
-	ddef_t		*def;
-	void		*val;
 
-	val = (void *)&pr_globals[ofs];
-	def = ED_GlobalAtOfs(ofs);
-	if (!def)
-		q_snprintf (line, sizeof(line), "%i(?)", ofs);
-	else
+	for (i = 0; i < ed_numclasses; i++)
 	{
-		s = PR_ValueString (def->type, (eval_t *)val);
-		q_snprintf (line, sizeof(line), "%i(%s)%s", ofs, PR_GetString(def->s_name), s);
+		Z_Free (ed_classes[i].name);
+		free (ed_classes[i].ents);
 	}
-
-	i = strlen(line);
-	for ( ; i < 20; i++)
-		strcat (line, " ");
-	strcat (line, " ");
-
-	return line;
+	ed_numclasses = 0;
+	if (ed_classhash)
+		memset (ed_classhash, 0, ed_classhashsize * sizeof(int));
+	ed_classvolatile.count = 0;
+	ed_classstale = false;
 }
 
-const char *PR_GlobalStringNoContents (int ofs)
+static int ED_ClassForName (const char *name, qboolean create)
 {
-	static char	line[512];
+	unsigned int	h;
 	int		i;
-	ddef_t		*def;
 
-	def = ED_GlobalAtOfs(ofs);
-	if (!def)
-		q_snprintf (line, sizeof(line), "%i(?)", ofs);
-	else
-		q_snprintf (line, sizeof(line), "%i(%s)", ofs, PR_GetString(def->s_name));
+	if (ed_classhashsize)
+	{
+		for (h = COM_HashString (name) & (ed_classhashsize - 1); ed_classhash[h]; h = (h + 1) & (ed_classhashsize - 1))
+		{
+			if (!strcmp (ed_classes[ed_classhash[h] - 1].name, name))
+				return ed_classhash[h] - 1;
+		}
+	}
+	if (!create)
+		return -1;
 
-	i = strlen(line);
-	for ( ; i < 20; i++)
-		strcat (line, " ");
-	strcat (line, " ");
+	if (ed_numclasses == ed_maxclasses)
+	{
+		ed_maxclasses = ed_maxclasses ? ed_maxclasses * 2 : 256;
+		ed_classes = (edictclass_t *) realloc (ed_classes, ed_maxclasses * sizeof(edictclass_t));
+		free (ed_classhash);
+		ed_classhashsize = ed_maxclasses * 2;
+		ed_classhash = (int *) calloc (ed_classhashsize, sizeof(int));
+		if (!ed_classes || !ed_classhash)
+			Sys_Error ("ED_ClassForName: out of memory");
+		for (i = 0; i < ed_numclasses; i++)
+		{
+			for (h = COM_HashString (ed_classes[i].name) & (ed_classhashsize - 1); ed_classhash[h]; h = (h + 1) & (ed_classhashsize - 1))
+				;
+			ed_classhash[h] = i + 1;
+		}
+	}
 
-	return line;
+	// probe again: the lookup above may not have run, or the table was rebuilt
+	for (h = COM_HashString (name) & (ed_classhashsize - 1); ed_classhash[h]; h = (h + 1) & (ed_classhashsize - 1))
+		;
+	i = ed_numclasses++;
+	ed_classes[i].name = Z_Strdup (name);
+	ed_classes[i].count = ed_classes[i].maxcount = 0;
+	ed_classes[i].ents = NULL;
+	ed_classhash[h] = i + 1;
+	return i;
 }
 
+// first position in the class list holding an edict number greater than num
+static int ED_ClassLowerBound (const edictclass_t *c, int num)
+{
+	int		lo = 0, hi = c->count, mid;
+
+	while (lo < hi)
+	{
+		mid = (lo + hi) / 2;
+		if (c->ents[mid] <= num)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
 
 /*
-=============
-ED_Print
+=================
+ED_UpdateClassIndex
 
-For debugging
-=============
+Files the edict under its current classname, or drops it from the index
+if it is free or has no classname
+=================
 */
-void ED_Print (edict_t *ed)
+void ED_UpdateClassIndex (edict_t *ed)
 {
-	ddef_t	*d;
-	int		*v;
-	int		i, j, l;
+	edictclass_t	*c;
 	const char	*name;
-	int		type;
+	int		num, newclass, pos, str;
 
-	if (ed->free)
+	num = NUM_FOR_EDICT(ed);
+	newclass = 0;
+	str = ed->v.classname;
+	if (!ed->free && num > 0 && str)
 	{
-		Con_Printf ("FREE\n");
-		return;
+		name = PR_GetString (str);
+		if (str < 0 && !PR_AllocatedString (str))
+			newclass = -1;
+		else if (*name)
+			newclass = ED_ClassForName (name, true) + 1;
 	}
+	if (newclass == ed->classindex)
+		return;
 
-	Con_SafePrintf("\nEDICT %i:\n", NUM_FOR_EDICT(ed)); //johnfitz -- was Con_Printf
-	for (i = 1; i < progs->numfielddefs; i++)
+	if (ed->classindex)
 	{
-		d = &pr_fielddefs[i];
-		name = PR_GetString(d->s_name);
-		l = strlen (name);
-		if (l > 1 && name[l - 2] == '_')
-			continue;	// skip _x, _y, _z vars
-
-		v = (int *)((char *)&ed->v + d->ofs*4);
-
-	// if the value is still all 0, skip the field
-		type = d->type & ~DEF_SAVEGLOBAL;
-
-		if (type >= NUM_TYPE_SIZES)
-			continue;
+		c = (ed->classindex < 0) ? &ed_classvolatile : &ed_classes[ed->classindex - 1];
+		pos = ED_ClassLowerBound (c, num) - 1;
+		if (pos >= 0 && c->ents[pos] == num)
+		{
+			memmove (c->ents + pos, c->ents + pos + 1, (c->count - pos - 1) * sizeof(int));
+			c->count--;
+		}
+	}
 
-		for (j = 0; j < type_size[type]; j++)
+	if (newclass)
+	{
+		c = (newclass < 0) ? &ed_classvolatile : &ed_classes[newclass - 1];
+		if (c->count == c->maxcount)
 		{
-			if (v[j])
-				break;
+			c->maxcount = c->maxcount ? c->maxcount * 2 : 16;
+			c->ents = (int *) realloc (c->ents, c->maxcount * sizeof(int));
+			if (!c->ents)
+				Sys_Error ("ED_UpdateClassIndex: out of memory");
 		}
-		if (j == type_size[type])
-			continue;
+		pos = ED_ClassLowerBound (c, num);
+		memmove (c->ents + pos + 1, c->ents + pos, (c->count - pos) * sizeof(int));
+		c->ents[pos] = num;
+		c->count++;
+	}
 
-		Con_SafePrintf ("%s", name); //johnfitz -- was Con_Printf
-		while (l++ < 15)
-			Con_SafePrintf (" "); //johnfitz -- was Con_Printf
+	ed->classindex = newclass;
+}
 
-		Con_SafePrintf ("%s\n", PR_ValueString(d->type, (eval_t *)v)); //johnfitz -- was Con_Printf
-	}
+/*
+=================
+ED_RefreshClassIndex
+
+Files every edict again under its live classname
+=================
+*/
+static void ED_RefreshClassIndex (void)
+{
+	int		i;
+
+	ed_classstale = false;
+	for (i = 1; i < sv.num_edicts; i++)
+		ED_UpdateClassIndex (EDICT_NUM(i));
 }
 
 /*
-=============
-ED_Write
+=================
+ED_FindClassname
 
-For savegames
-=============
+Returns the first non-free edict after start whose classname is name, or
+the world if there is none.  Same result as scanning every edict.
+=================
 */
-void ED_Write (FILE *f, edict_t *ed)
+edict_t *ED_FindClassname (int start, const char *name)
 {
-	ddef_t	*d;
-	int		*v;
-	int		i, j;
-	const char	*name;
-	int		type;
+	edictclass_t	*c;
+	edict_t		*ed, *best;
+	int		i;
 
-	fprintf (f, "{\n");
+retry:
+	if (ed_classstale)
+		ED_RefreshClassIndex ();
 
-	if (ed->free)
+	best = NULL;
+	i = ED_ClassForName (name, false);
+	if (i >= 0)
 	{
-		fprintf (f, "}\n");
-		return;
+		c = &ed_classes[i];
+		for (i = ED_ClassLowerBound (c, start); i < c->count; i++)
+		{
+			ed = EDICT_NUM(c->ents[i]);
+			if (ed->free)
+				continue;
+			if (strcmp (PR_GetString (ed->v.classname), name))
+			{	// changed behind the index's back
+				ed_classstale = true;
+				goto retry;
+			}
+			best = ed;
+			break;
+		}
 	}
 
-	for (i = 1; i < progs->numfielddefs; i++)
+	c = &ed_classvolatile;
+	for (i = ED_ClassLowerBound (c, start); i < c->count; i++)
 	{
-		d = &pr_fielddefs[i];
-		name = PR_GetString(d->s_name);
-		j = strlen (name);
-		if (j > 1 && name[j - 2] == '_')
-			continue;	// skip _x, _y, _z vars
+		ed = EDICT_NUM(c->ents[i]);
+		if (best && ed > best)
+			break;
+		if (!ed->free && !strcmp (PR_GetString (ed->v.classname), name))
+			return ed;
+	}
+	return best ? best : sv.edicts;
+}
 
-		v = (int *)((char *)&ed->v + d->ofs*4);
+//===========================================================================
 
-	// if the value is still all 0, skip the field
-		type = d->type & ~DEF_SAVEGLOBAL;
+/*
+===============================================================================
 
-		if (type >= NUM_TYPE_SIZES)
-			continue;
+PROGS DEFINITION INDICES
 
-		for (j = 0; j < type_size[type]; j++)
-		{
-			if (v[j])
-				break;
-		}
-		if (j == type_size[type])
-			continue;
+Name and offset lookups used to linearly scan the progs definitions, which
+made parsing the entity lump quadratic on large maps.  The tables below are
+built once in PR_LoadProgs and live on the hunk along with progs.dat.
 
-		fprintf (f, "\"%s\" ", name);
-		fprintf (f, "\"%s\"\n", PR_UglyValueString(d->type, (eval_t *)v));
-	}
+Name indices are open addressed tables of (index + 1), 0 meaning empty,
+with a 50% load factor (same layout as the localization table).  Duplicate
+names are all inserted; since probing is linear and nothing is ever removed,
+a lookup always finds the first definition, just like the old linear scan.
+===============================================================================
+*/
 
-	//johnfitz -- save entity alpha manually when progs.dat doesn't know about alpha
-	if (!pr_alpha_supported && ed->alpha != ENTALPHA_DEFAULT)
-		fprintf (f, "\"alpha\" \"%f\"\n", ENTALPHA_TOSAVE(ed->alpha));
-	//johnfitz
+static	unsigned	*pr_fieldindices;
+static	int		pr_numfieldindices;
+static	unsigned	*pr_globalindices;
+static	int		pr_numglobalindices;
+static	unsigned	*pr_functionindices;
+static	int		pr_numfunctionindices;
 
-	fprintf (f, "}\n");
-}
+static	ddef_t		**pr_fieldatofs;	// [progs->entityfields]
+static	ddef_t		**pr_globalatofs;	// [progs->numglobals]
 
-void ED_PrintNum (int ent)
+/*
+============
+PR_AllocIndex
+============
+*/
+static unsigned *PR_AllocIndex (int count, int *numindices)
 {
-	ED_Print (EDICT_NUM(ent));
+	*numindices = q_max(count * 2, 1);
+	return (unsigned *) Hunk_AllocName (*numindices * sizeof(unsigned), "progidx");
 }
 
 /*
-=============
-ED_PrintEdicts
-
-For debugging, prints all the entities in the current server
-=============
+============
+PR_IndexInsert
+============
 */
-void ED_PrintEdicts (void)
+static void PR_IndexInsert (unsigned *indices, int numindices, const char *name, int idx)
 {
-	int		i;
+	unsigned	pos, end;
 
-	if (!sv.active)
-		return;
+	pos = COM_HashString(name) % numindices;
+	end = pos;
+	do
+	{
+		if (!indices[pos])
+		{
+			indices[pos] = idx + 1;
+			return;
+		}
+		if (++pos == (unsigned)numindices)
+			pos = 0;
+	} while (pos != end);
 
-	Con_Printf ("%i entities\n", sv.num_edicts);
-	for (i = 0; i < sv.num_edicts; i++)
-		ED_PrintNum (i);
+	Sys_Error ("PR_IndexInsert: table full");
 }
 
 /*
-=============
-ED_PrintEdict_f
+============
+PR_IndexFind
 
-For debugging, prints a single edicy
-=============
+Returns the slot of the first entry whose name matches, or -1
+============
 */
-static void ED_PrintEdict_f (void)
+static int PR_IndexFind (const unsigned *indices, int numindices, const char *name,
+			 const void *base, int stride, int nameofs)
 {
-	int		i;
+	unsigned	pos, end, idx;
+	int		s_name;
 
-	if (!sv.active)
-		return;
+	if (!indices)
+		return -1;
 
-	i = Q_atoi (Cmd_Argv(1));
-	if (i < 0 || i >= sv.num_edicts)
+	pos = COM_HashString(name) % numindices;
+	end = pos;
+	do
 	{
-		Con_Printf("Bad edict number\n");
-		return;
-	}
-	ED_PrintNum (i);
+		idx = indices[pos];
+		if (!idx)
+			return -1;
+		s_name = *(const int *)((const byte *)base + (idx - 1) * stride + nameofs);
+		if (!strcmp(PR_GetString(s_name), name))
+			return idx - 1;
+		if (++pos == (unsigned)numindices)
+			pos = 0;
+	} while (pos != end);
+
+	return -1;
 }
 
 /*
-=============
-ED_Count
+============
+PR_BuildIndices
 
-For debugging
-=============
+Called from PR_LoadProgs once all lumps have been byte swapped
+============
 */
-static void ED_Count (void)
+static void PR_BuildIndices (void)
 {
-	edict_t	*ent;
-	int	i, active, models, solid, step;
+	int		i;
 
-	if (!sv.active)
-		return;
+	pr_fieldindices = PR_AllocIndex (progs->numfielddefs, &pr_numfieldindices);
+	pr_globalindices = PR_AllocIndex (progs->numglobaldefs, &pr_numglobalindices);
+	pr_functionindices = PR_AllocIndex (progs->numfunctions, &pr_numfunctionindices);
 
-	active = models = solid = step = 0;
-	for (i = 0; i < sv.num_edicts; i++)
+	pr_fieldatofs = (ddef_t **) Hunk_AllocName (q_max(progs->entityfields, 1) * sizeof(ddef_t *), "progidx");
+	pr_globalatofs = (ddef_t **) Hunk_AllocName (q_max(progs->numglobals, 1) * sizeof(ddef_t *), "progidx");
+
+	for (i = 0; i < progs->numfielddefs; i++)
 	{
-		ent = EDICT_NUM(i);
-		if (ent->free)
-			continue;
-		active++;
-		if (ent->v.solid)
-			solid++;
-		if (ent->v.model)
-			models++;
-		if (ent->v.movetype == MOVETYPE_STEP)
-			step++;
+		PR_IndexInsert (pr_fieldindices, pr_numfieldindices, PR_GetString(pr_fielddefs[i].s_name), i);
+		if (pr_fielddefs[i].ofs < progs->entityfields && !pr_fieldatofs[pr_fielddefs[i].ofs])
+			pr_fieldatofs[pr_fielddefs[i].ofs] = &pr_fielddefs[i];
 	}
 
-	Con_Printf ("num_edicts:%3i\n", sv.num_edicts);
-	Con_Printf ("active    :%3i\n", active);
-	Con_Printf ("view      :%3i\n", models);
-	Con_Printf ("touch     :%3i\n", solid);
-	Con_Printf ("step      :%3i\n", step);
-}
+	for (i = 0; i < progs->numglobaldefs; i++)
+	{
+		PR_IndexInsert (pr_globalindices, pr_numglobalindices, PR_GetString(pr_globaldefs[i].s_name), i);
+		if (pr_globaldefs[i].ofs < progs->numglobals && !pr_globalatofs[pr_globaldefs[i].ofs])
+			pr_globalatofs[pr_globaldefs[i].ofs] = &pr_globaldefs[i];
+	}
 
+	for (i = 0; i < progs->numfunctions; i++)
+		PR_IndexInsert (pr_functionindices, pr_numfunctionindices, PR_GetString(pr_functions[i].s_name), i);
+}
 
 /*
-==============================================================================
-
-ARCHIVING GLOBALS
-
-FIXME: need to tag constants, doesn't really work
-==============================================================================
+============
+ED_GlobalAtOfs
+============
 */
+static ddef_t *ED_GlobalAtOfs (int ofs)
+{
+	if (ofs < 0 || ofs >= progs->numglobals)
+		return NULL;
+	return pr_globalatofs[ofs];
+}
 
 /*
-=============
-ED_WriteGlobals
-=============
+============
+ED_FieldAtOfs
+============
 */
-void ED_WriteGlobals (FILE *f)
+static ddef_t *ED_FieldAtOfs (int ofs)
 {
-	ddef_t		*def;
-	int			i;
-	const char		*name;
+	if (ofs < 0 || ofs >= progs->entityfields)
+		return NULL;
+	return pr_fieldatofs[ofs];
+}
+
+/*
+============
+ED_FindField
+============
+*/
+ddef_t *ED_FindField (const char *name)
+{
+	int		i;
+
+	i = PR_IndexFind (pr_fieldindices, pr_numfieldindices, name,
+			  pr_fielddefs, sizeof(ddef_t), offsetof(ddef_t, s_name));
+	return (i < 0) ? NULL : &pr_fielddefs[i];
+}
+
+/*
+============
+ED_GlobalDefs / ED_FieldDefs
+
+The def tables, progs->numglobaldefs and progs->numfielddefs long.
+============
+*/
+ddef_t *ED_GlobalDefs (void)
+{
+	return pr_globaldefs;
+}
+
+ddef_t *ED_FieldDefs (void)
+{
+	return pr_fielddefs;
+}
+
+
+/*
+============
+ED_FindGlobal
+============
+*/
+ddef_t *ED_FindGlobal (const char *name)
+{
+	int		i;
+
+	i = PR_IndexFind (pr_globalindices, pr_numglobalindices, name,
+			  pr_globaldefs, sizeof(ddef_t), offsetof(ddef_t, s_name));
+	return (i < 0) ? NULL : &pr_globaldefs[i];
+}
+
+
+/*
+============
+ED_FindFunction
+============
+*/
+static dfunction_t *ED_FindFunction (const char *fn_name)
+{
+	int		i;
+
+	i = PR_IndexFind (pr_functionindices, pr_numfunctionindices, fn_name,
+			  pr_functions, sizeof(dfunction_t), offsetof(dfunction_t, s_name));
+	return (i < 0) ? NULL : &pr_functions[i];
+}
+
+/*
+============
+GetEdictFieldValue
+============
+*/
+eval_t *GetEdictFieldValue(edict_t *ed, const char *field)
+{
+	ddef_t			*def;
+
+	def = ED_FindField (field);
+	if (!def)
+		return NULL;
+
+	return (eval_t *)((char *)&ed->v + def->ofs*4);
+}
+
+
+/*
+============
+PR_ValueString
+(etype_t type, eval_t *val)
+
+Returns a string describing *data in a type specific manner
+=============
+*/
+static const char *PR_ValueString (int type, eval_t *val)
+{
+	static char	line[512];
+	ddef_t		*def;
+	dfunction_t	*f;
+
+	type &= ~DEF_SAVEGLOBAL;
+
+	switch (type)
+	{
+	case ev_string:
+		q_snprintf (line, sizeof(line), "%s", PR_GetString(val->string));
+		break;
+	case ev_entity:
+		q_snprintf (line, sizeof(line), "entity %i", NUM_FOR_EDICT(PROG_TO_EDICT(val->edict)) );
+		break;
+	case ev_function:
+		f = pr_functions + val->function;
+		q_snprintf (line, sizeof(line), "%s()", PR_GetString(f->s_name));
+		break;
+	case ev_field:
+		def = ED_FieldAtOfs ( val->_int );
+		q_snprintf (line, sizeof(line), ".%s", PR_GetString(def->s_name));
+		break;
+	case ev_void:
+		q_snprintf (line, sizeof(line), "void");
+		break;
+	case ev_float:
+		q_snprintf (line, sizeof(line), "%5.1f", val->_float);
+		break;
+	case ev_vector:
+		q_snprintf (line, sizeof(line), "'%5.1f %5.1f %5.1f'", val->vector[0], val->vector[1], val->vector[2]);
+		break;
+	case ev_pointer:
+		q_snprintf (line, sizeof(line), "pointer");
+		break;
+	default:
+		q_snprintf (line, sizeof(line), "bad type %i", type);
+		break;
+	}
+
+	return line;
+}
+
+/*
+============
+PR_UglyValueString
+(etype_t type, eval_t *val)
+
+Returns a string describing *data in a type specific manner
+Easier to parse than PR_ValueString
+=============
+*/
+static const char *PR_UglyValueString (int type, eval_t *val)
+{
+	static char	line[1024];
+	ddef_t		*def;
+	dfunction_t	*f;
+
+	type &= ~DEF_SAVEGLOBAL;
+
+	switch (type)
+	{
+	case ev_string:
+		q_snprintf (line, sizeof(line), "%s", PR_GetString(val->string));
+		break;
+	case ev_entity:
+		q_snprintf (line, sizeof(line), "%i", NUM_FOR_EDICT(PROG_TO_EDICT(val->edict)));
+		break;
+	case ev_function:
+		f = pr_functions + val->function;
+		q_snprintf (line, sizeof(line), "%s", PR_GetString(f->s_name));
+		break;
+	case ev_field:
+		def = ED_FieldAtOfs ( val->_int );
+		q_snprintf (line, sizeof(line), "%s", PR_GetString(def->s_name));
+		break;
+	case ev_void:
+		q_snprintf (line, sizeof(line), "void");
+		break;
+	case ev_float:
+		q_snprintf (line, sizeof(line), "%f", val->_float);
+		break;
+	case ev_vector:
+		q_snprintf (line, sizeof(line), "%f %f %f", val->vector[0], val->vector[1], val->vector[2]);
+		break;
+	default:
+		q_snprintf (line, sizeof(line), "bad type %i", type);
+		break;
+	}
+
+	return line;
+}
+
+/*
+============
+PR_GlobalString
+
+Returns a string with a description and the contents of a global,
+padded to 20 field width
+============
+*/
+const char *PR_GlobalString (int ofs)
+{
+	static char	line[512];
+	const char	*s;
+	int		i;
+	ddef_t		*def;
+	void		*val;
+
+	val = (void *)&pr_globals[ofs];
+	def = ED_GlobalAtOfs(ofs);
+	if (!def)
+		q_snprintf (line, sizeof(line), "%i(?)", ofs);
+	else
+	{
+		s = PR_ValueString (def->type, (eval_t *)val);
+		q_snprintf (line, sizeof(line), "%i(%s)%s", ofs, PR_GetString(def->s_name), s);
+	}
+
+	i = strlen(line);
+	for ( ; i < 20; i++)
+		strcat (line, " ");
+	strcat (line, " ");
+
+	return line;
+}
+
+const char *PR_GlobalStringNoContents (int ofs)
+{
+	static char	line[512];
+	int		i;
+	ddef_t		*def;
+
+	def = ED_GlobalAtOfs(ofs);
+	if (!def)
+		q_snprintf (line, sizeof(line), "%i(?)", ofs);
+	else
+		q_snprintf (line, sizeof(line), "%i(%s)", ofs, PR_GetString(def->s_name));
+
+	i = strlen(line);
+	for ( ; i < 20; i++)
+		strcat (line, " ");
+	strcat (line, " ");
+
+	return line;
+}
+
+
+/*
+=============
+ED_Print
+
+For debugging
+=============
+*/
+void ED_Print (edict_t *ed)
+{
+	ddef_t	*d;
+	int		*v;
+	int		i, j, l;
+	const char	*name;
+	int		type;
+
+	if (ed->free)
+	{
+		Con_Printf ("FREE\n");
+		return;
+	}
+
+	Con_SafePrintf("\nEDICT %i:\n", NUM_FOR_EDICT(ed)); //johnfitz -- was Con_Printf
+	for (i = 1; i < progs->numfielddefs; i++)
+	{
+		d = &pr_fielddefs[i];
+		name = PR_GetString(d->s_name);
+		l = strlen (name);
+		if (l > 1 && name[l - 2] == '_')
+			continue;	// skip _x, _y, _z vars
+
+		v = (int *)((char *)&ed->v + d->ofs*4);
+
+	// if the value is still all 0, skip the field
+		type = d->type & ~DEF_SAVEGLOBAL;
+
+		if (type >= NUM_TYPE_SIZES)
+			continue;
+
+		for (j = 0; j < type_size[type]; j++)
+		{
+			if (v[j])
+				break;
+		}
+		if (j == type_size[type])
+			continue;
+
+		Con_SafePrintf ("%s", name); //johnfitz -- was Con_Printf
+		while (l++ < 15)
+			Con_SafePrintf (" "); //johnfitz -- was Con_Printf
+
+		Con_SafePrintf ("%s\n", PR_ValueString(d->type, (eval_t *)v)); //johnfitz -- was Con_Printf
+	}
+}
+
+/*
+=============
+ED_Write
+
+For savegames
+=============
+*/
+void ED_Write (FILE *f, edict_t *ed)
+{
+	ddef_t	*d;
+	int		*v;
+	int		i, j;
+	const char	*name;
+	int		type;
+
+	fprintf (f, "{\n");
+
+	if (ed->free)
+	{
+		fprintf (f, "}\n");
+		return;
+	}
+
+	for (i = 1; i < progs->numfielddefs; i++)
+	{
+		d = &pr_fielddefs[i];
+		name = PR_GetString(d->s_name);
+		j = strlen (name);
+		if (j > 1 && name[j - 2] == '_')
+			continue;	// skip _x, _y, _z vars
+
+		v = (int *)((char *)&ed->v + d->ofs*4);
+
+	// if the value is still all 0, skip the field
+		type = d->type & ~DEF_SAVEGLOBAL;
+
+		if (type >= NUM_TYPE_SIZES)
+			continue;
+
+		for (j = 0; j < type_size[type]; j++)
+		{
+			if (v[j])
+				break;
+		}
+		if (j == type_size[type])
+			continue;
+
+		fprintf (f, "\"%s\" ", name);
+		fprintf (f, "\"%s\"\n", PR_UglyValueString(d->type, (eval_t *)v));
+	}
+
+	//johnfitz -- save entity alpha manually when progs.dat doesn't know about alpha
+	if (!pr_alpha_supported && ed->alpha != ENTALPHA_DEFAULT)
+		fprintf (f, "\"alpha\" \"%f\"\n", ENTALPHA_TOSAVE(ed->alpha));
+	//johnfitz
+
+	fprintf (f, "}\n");
+}
+
+void ED_PrintNum (int ent)
+{
+	ED_Print (EDICT_NUM(ent));
+}
+
+/*
+=============
+ED_PrintEdicts
+
+For debugging, prints all the entities in the current server
+=============
+*/
+void ED_PrintEdicts (void)
+{
+	int		i;
+
+	if (!sv.active)
+		return;
+
+	Con_Printf ("%i entities\n", sv.num_edicts);
+	for (i = 0; i < sv.num_edicts; i++)
+		ED_PrintNum (i);
+}
+
+/*
+=============
+ED_PrintEdict_f
+
+For debugging, prints a single edicy
+=============
+*/
+static void ED_PrintEdict_f (void)
+{
+	int		i;
+
+	if (!sv.active)
+		return;
+
+	i = Q_atoi (Cmd_Argv(1));
+	if (i < 0 || i >= sv.num_edicts)
+	{
+		Con_Printf("Bad edict number\n");
+		return;
+	}
+	ED_PrintNum (i);
+}
+
+/*
+=============
+ED_Count
+
+For debugging
+=============
+*/
+static void ED_Count (void)
+{
+	edict_t	*ent;
+	int	i, active, models, solid, step;
+
+	if (!sv.active)
+		return;
+
+	active = models = solid = step = 0;
+	for (i = 0; i < sv.num_edicts; i++)
+	{
+		ent = EDICT_NUM(i);
+		if (ent->free)
+			continue;
+		active++;
+		if (ent->v.solid)
+			solid++;
+		if (ent->v.model)
+			models++;
+		if (ent->v.movetype == MOVETYPE_STEP)
+			step++;
+	}
+
+	Con_Printf ("num_edicts:%3i\n", sv.num_edicts);
+	Con_Printf ("active    :%3i\n", active);
+	Con_Printf ("view      :%3i\n", models);
+	Con_Printf ("touch     :%3i\n", solid);
+	Con_Printf ("step      :%3i\n", step);
+}
+
+
+/*
+==============================================================================
+
+ARCHIVING GLOBALS
+
+FIXME: need to tag constants, doesn't really work
+==============================================================================
+*/
+
+/*
+=============
+ED_WriteGlobals
+=============
+*/
+void ED_WriteGlobals (FILE *f)
+{
+	ddef_t		*def;
+	int			i;
+	const char		*name;
 	int			type;
 
-	fprintf (f, "{\n");
+	fprintf (f, "{\n");
+	for (i = 0; i < progs->numglobaldefs; i++)
+	{
+		def = &pr_globaldefs[i];
+		type = def->type;
+		if ( !(def->type & DEF_SAVEGLOBAL) )
+			continue;
+		type &= ~DEF_SAVEGLOBAL;
+
+		if (type != ev_string && type != ev_float && type != ev_entity)
+			continue;
+
+		name = PR_GetString(def->s_name);
+		fprintf (f, "\"%s\" ", name);
+		fprintf (f, "\"%s\"\n", PR_UglyValueString(type, (eval_t *)&pr_globals[def->ofs]));
+	}
+	fprintf (f, "}\n");
+}
+
+/*
+=============
+ED_ParseGlobals
+=============
+*/
+const char *ED_ParseGlobals (const char *data)
+{
+	char	keyname[64];
+	ddef_t	*key;
+
+	while (1)
+	{
+	// parse key
+		data = COM_Parse (data);
+		if (com_token[0] == '}')
+			break;
+		if (!data)
+			Host_Error ("ED_ParseEntity: EOF without closing brace");
+
+		q_strlcpy (keyname, com_token, sizeof(keyname));
+
+	// parse value
+		data = COM_Parse (data);
+		if (!data)
+			Host_Error ("ED_ParseEntity: EOF without closing brace");
+
+		if (com_token[0] == '}')
+			Host_Error ("ED_ParseEntity: closing brace without data");
+
+		key = ED_FindGlobal (keyname);
+		if (!key)
+		{
+			Con_Printf ("'%s' is not a global\n", keyname);
+			continue;
+		}
+
+		if (!ED_ParseEpair ((void *)pr_globals, key, com_token))
+			Host_Error ("ED_ParseGlobals: parse error");
+	}
+	return data;
+}
+
+//============================================================================
+
+
+/*
+=============
+ED_NewString
+=============
+*/
+static string_t ED_NewString (const char *string)
+{
+	char	*new_p;
+	int		i, l;
+	string_t	num;
+
+	l = strlen(string) + 1;
+	num = PR_AllocString (l, &new_p);
+
+	for (i = 0; i < l; i++)
+	{
+		if (string[i] == '\\' && i < l-1)
+		{
+			i++;
+			if (string[i] == 'n')
+				*new_p++ = '\n';
+			else
+				*new_p++ = '\\';
+		}
+		else
+			*new_p++ = string[i];
+	}
+
+	return num;
+}
+
+
+/*
+=============
+ED_ParseEval
+
+Can parse either fields or globals
+returns false if error
+=============
+*/
+static qboolean ED_ParseEpair (void *base, ddef_t *key, const char *s)
+{
+	int		i;
+	char	string[128];
+	ddef_t	*def;
+	char	*v, *w;
+	char	*end;
+	void	*d;
+	dfunction_t	*func;
+
+	d = (void *)((int *)base + key->ofs);
+
+	switch (key->type & ~DEF_SAVEGLOBAL)
+	{
+	case ev_string:
+		*(string_t *)d = ED_NewString(s);
+		break;
+
+	case ev_float:
+		*(float *)d = atof (s);
+		break;
+
+	case ev_vector:
+		q_strlcpy (string, s, sizeof(string));
+		end = (char *)string + strlen(string);
+		v = string;
+		w = string;
+
+		for (i = 0; i < 3 && (w <= end); i++) // ericw -- added (w <= end) check
+		{
+		// set v to the next space (or 0 byte), and change that char to a 0 byte
+			while (*v && *v != ' ')
+				v++;
+			*v = 0;
+			((float *)d)[i] = atof (w);
+			w = v = v+1;
+		}
+		// ericw -- fill remaining elements to 0 in case we hit the end of string
+		// before reading 3 floats.
+		if (i < 3)
+		{
+			Con_DWarning ("Avoided reading garbage for \"%s\" \"%s\"\n", PR_GetString(key->s_name), s);
+			for (; i < 3; i++)
+				((float *)d)[i] = 0.0f;
+		}
+		break;
+
+	case ev_entity:
+		*(int *)d = EDICT_TO_PROG(EDICT_NUM(atoi (s)));
+		break;
+
+	case ev_field:
+		def = ED_FindField (s);
+		if (!def)
+		{
+			//johnfitz -- HACK -- suppress error becuase fog/sky fields might not be mentioned in defs.qc
+			if (strncmp(s, "sky", 3) && strcmp(s, "fog"))
+				Con_DPrintf ("Can't find field %s\n", s);
+			return false;
+		}
+		*(int *)d = G_INT(def->ofs);
+		break;
+
+	case ev_function:
+		func = ED_FindFunction (s);
+		if (!func)
+		{
+			Con_Printf ("Can't find function %s\n", s);
+			return false;
+		}
+		*(func_t *)d = func - pr_functions;
+		break;
+
+	default:
+		break;
+	}
+	return true;
+}
+
+/*
+====================
+ED_ParseEdict
+
+Parses an edict out of the given string, returning the new position
+ed should be a properly initialized empty edict.
+Used for initial level load and for savegames.
+====================
+*/
+const char *ED_ParseEdict (const char *data, edict_t *ent)
+{
+	ddef_t		*key;
+	char		keyname[256];
+	qboolean	anglehack, init;
+	int		n;
+
+	init = false;
+
+	// clear it
+	if (ent != sv.edicts)	// hack
+		memset (&ent->v, 0, progs->entityfields * 4);
+
+	// go through all the dictionary pairs
+	while (1)
+	{
+		// parse key
+		data = COM_Parse (data);
+		if (com_token[0] == '}')
+			break;
+		if (!data)
+			Host_Error ("ED_ParseEntity: EOF without closing brace");
+
+		// anglehack is to allow QuakeEd to write single scalar angles
+		// and allow them to be turned into vectors. (FIXME...)
+		if (!strcmp(com_token, "angle"))
+		{
+			strcpy (com_token, "angles");
+			anglehack = true;
+		}
+		else
+			anglehack = false;
+
+		// FIXME: change light to _light to get rid of this hack
+		if (!strcmp(com_token, "light"))
+			strcpy (com_token, "light_lev");	// hack for single light def
+
+		q_strlcpy (keyname, com_token, sizeof(keyname));
+
+		// another hack to fix keynames with trailing spaces
+		n = strlen(keyname);
+		while (n && keyname[n-1] == ' ')
+		{
+			keyname[n-1] = 0;
+			n--;
+		}
+
+		// parse value
+		// HACK: we allow truncation when reading the wad field,
+		// otherwise maps using lots of wads with absolute paths
+		// could cause a parse error
+		data = COM_ParseEx (data, !strcmp (keyname, "wad") ? CPE_ALLOWTRUNC : CPE_NOTRUNC);
+		if (!data)
+			Host_Error ("ED_ParseEntity: EOF without closing brace");
+
+		if (com_token[0] == '}')
+			Host_Error ("ED_ParseEntity: closing brace without data");
+
+		init = true;
+
+		// keynames with a leading underscore are used for utility comments,
+		// and are immediately discarded by quake
+		if (keyname[0] == '_')
+			continue;
+
+		//johnfitz -- hack to support .alpha even when progs.dat doesn't know about it
+		if (!strcmp(keyname, "alpha"))
+			ent->alpha = ENTALPHA_ENCODE(Q_atof(com_token));
+		//johnfitz
+
+		key = ED_FindField (keyname);
+		if (!key)
+		{
+			//johnfitz -- HACK -- suppress error becuase fog/sky/alpha fields might not be mentioned in defs.qc
+			if (strncmp(keyname, "sky", 3) && strcmp(keyname, "fog") && strcmp(keyname, "alpha"))
+				Con_DPrintf ("\"%s\" is not a field\n", keyname); //johnfitz -- was Con_Printf
+			continue;
+		}
+
+		if (anglehack)
+		{
+			char	temp[32];
+			strcpy (temp, com_token);
+			sprintf (com_token, "0 %s 0", temp);
+		}
+
+		if (!ED_ParseEpair ((void *)&ent->v, key, com_token))
+			Host_Error ("ED_ParseEdict: parse error");
+	}
+
+	if (!init)
+		ent->free = true;
+
+	ED_UpdateClassIndex (ent);
+
+	return data;
+}
+
+
+/*
+===============================================================================
+
+BINARY SAVEGAMES
+
+The binary format stores the saved globals and each edict's entvars as
+raw words.  Strings, entity references, function and field values are
+replaced with progs independent ones: an index into the string table, an
+edict number, a function name index and the saved field offset.  Field,
+global and function names are written with it.  If the progs changed, each
+saved field is matched by name and type and copied to its new offset.
+Otherwise the whole entvars block is one memcpy plus the typed fixups.
+===============================================================================
+*/
+
+void SaveBuf_Write (savebuf_t *b, const void *data, int len)
+{
+	if (b->cursize + len > b->maxsize)
+	{
+		b->maxsize = q_max(b->maxsize * 2, b->cursize + len + 65536);
+		b->data = (byte *) realloc (b->data, b->maxsize);
+		if (!b->data)
+			Sys_Error ("SaveBuf_Write: realloc() failed on %d bytes", b->maxsize);
+	}
+	memcpy (b->data + b->cursize, data, len);
+	b->cursize += len;
+}
+
+void SaveBuf_WriteLong (savebuf_t *b, int c)
+{
+	c = LittleLong (c);
+	SaveBuf_Write (b, &c, 4);
+}
+
+void SaveBuf_WriteFloat (savebuf_t *b, float f)
+{
+	f = LittleFloat (f);
+	SaveBuf_Write (b, &f, 4);
+}
+
+void SaveBuf_WriteString (savebuf_t *b, const char *s)
+{
+	SaveBuf_Write (b, s, strlen(s) + 1);
+}
+
+const byte *SaveBuf_Read (savebuf_t *b, int len)
+{
+	const byte	*p;
+
+	if (len < 0 || b->readcount + len > b->cursize)
+		Host_Error ("Savegame is truncated");
+	p = b->data + b->readcount;
+	b->readcount += len;
+	return p;
+}
+
+int SaveBuf_ReadLong (savebuf_t *b)
+{
+	int	c;
+
+	memcpy (&c, SaveBuf_Read (b, 4), 4);
+	return LittleLong (c);
+}
+
+float SaveBuf_ReadFloat (savebuf_t *b)
+{
+	float	f;
+
+	memcpy (&f, SaveBuf_Read (b, 4), 4);
+	return LittleFloat (f);
+}
+
+const char *SaveBuf_ReadString (savebuf_t *b)
+{
+	const char	*s = (const char *) b->data + b->readcount;
+	const byte	*end;
+
+	end = (const byte *) memchr (s, 0, b->cursize - b->readcount);
+	if (!end)
+		Host_Error ("Savegame is truncated");
+	b->readcount = end + 1 - b->data;
+	return s;
+}
+
+void SaveBuf_Free (savebuf_t *b)
+{
+	free (b->data);
+	memset (b, 0, sizeof(*b));
+}
+
+typedef struct
+{
+	int		type;
+	int		src, dst;	// word offsets in the saved and the current layout
+	int		count;
+} savecopy_t;
+
+typedef struct
+{
+	savecopy_t	*copies;
+	savecopy_t	*typed;
+	int		*funcmap;
+	int		*globalmap;	// current ofs, type per saved global
+	const char	**strings;
+	int		numstrings;
+	int		*fieldmap;	// saved ofs, current ofs pairs
+} savescratch_t;
+
+static savescratch_t	ed_savescratch;
+
+static void ED_FreeSaveScratch (void)
+{
+	savescratch_t	*s = &ed_savescratch;
+
+	free (s->copies);
+	free (s->typed);
+	free (s->funcmap);
+	free (s->globalmap);
+	free ((void *) s->strings);
+	free (s->fieldmap);
+	memset (s, 0, sizeof(*s));
+}
+
+static void *ED_SaveAlloc (size_t size)
+{
+	void	*p = calloc (1, size ? size : 1);
+
+	if (!p)
+		Sys_Error ("ED_SaveAlloc: out of memory");
+	return p;
+}
+
+// same selection as ED_Write
+static qboolean ED_SavedField (ddef_t *d)
+{
+	const char	*name = PR_GetString (d->s_name);
+	int		j = strlen (name);
+	int		type = d->type & ~DEF_SAVEGLOBAL;
+
+	if (j > 1 && name[j - 2] == '_')
+		return false;	// _x, _y, _z vars
+	return type == ev_string || type == ev_float || type == ev_vector ||
+		type == ev_entity || type == ev_field || type == ev_function;
+}
+
+static qboolean ED_SavedGlobal (ddef_t *d)
+{
+	int	type = d->type & ~DEF_SAVEGLOBAL;
+
+	if (!(d->type & DEF_SAVEGLOBAL))
+		return false;
+	return type == ev_string || type == ev_float || type == ev_entity;
+}
+
+/*
+-------------------------------------------------------------------------------
+Snapshots
+
+A snapshot is a copy of the edict block and the globals taken between
+frames, with every string slot already pointing into the snapshot's own
+string table, because engine strings can change or be freed once the
+game runs on.  Writing a snapshot out touches nothing but the snapshot and
+the read-only progs data, so it may run on another thread as long as the
+progs stay loaded.
+-------------------------------------------------------------------------------
+*/
+
+struct savesnapshot_s
+{
+	int		numedicts;
+	int		edictsize;
+	byte		*edicts;	// copy of sv.edicts
+	int		*globals;	// copy of pr_globals
+	int		*fixups;	// word offsets of string and entity fields
+	int		*fixuptypes;
+	int		numfixups;
+
+	char		*text;		// string table, '\0' separated
+	int		textsize, textmax;
+	int		numstrings;
+	int		*hashkeys;	// string_t values
+	int		*hashvalues;	// string table index + 1, 0 = empty
+	int		hashsize;	// power of two
+};
+
+static int ED_SnapshotString (savesnapshot_t *snap, string_t num)
+{
+	const char	*s;
+	int		i, h, len, *oldkeys, *oldvalues, oldsize;
+
+	if (!num)
+		return 0;
+
+	if (snap->numstrings * 2 >= snap->hashsize)
+	{
+		oldkeys = snap->hashkeys;
+		oldvalues = snap->hashvalues;
+		oldsize = snap->hashsize;
+		snap->hashsize = oldsize ? oldsize * 2 : 1024;
+		snap->hashkeys = (int *) ED_SaveAlloc (snap->hashsize * sizeof(int));
+		snap->hashvalues = (int *) ED_SaveAlloc (snap->hashsize * sizeof(int));
+		for (i = 0; i < oldsize; i++)
+		{
+			if (!oldvalues[i])
+				continue;
+			h = ((unsigned int)oldkeys[i] * 0x9E3779B1u) & (snap->hashsize - 1);
+			while (snap->hashvalues[h])
+				h = (h + 1) & (snap->hashsize - 1);
+			snap->hashkeys[h] = oldkeys[i];
+			snap->hashvalues[h] = oldvalues[i];
+		}
+		free (oldkeys);
+		free (oldvalues);
+	}
+
+	h = ((unsigned int)num * 0x9E3779B1u) & (snap->hashsize - 1);
+	while (snap->hashvalues[h])
+	{
+		if (snap->hashkeys[h] == num)
+			return snap->hashvalues[h];
+		h = (h + 1) & (snap->hashsize - 1);
+	}
+
+	s = PR_GetString (num);
+	len = strlen (s) + 1;
+	if (snap->textsize + len > snap->textmax)
+	{
+		snap->textmax = q_max(snap->textmax * 2, snap->textsize + len + 16384);
+		snap->text = (char *) realloc (snap->text, snap->textmax);
+		if (!snap->text)
+			Sys_Error ("ED_SnapshotString: out of memory");
+	}
+	memcpy (snap->text + snap->textsize, s, len);
+	snap->textsize += len;
+
+	snap->hashkeys[h] = num;
+	snap->hashvalues[h] = ++snap->numstrings;
+	return snap->numstrings;
+}
+
+/*
+=============
+ED_CreateSnapshot
+
+Call between frames.  Copies the live edicts and globals; the only other
+work is resolving the string slots.
+=============
+*/
+savesnapshot_t *ED_CreateSnapshot (void)
+{
+	savesnapshot_t	*snap;
+	ddef_t		*d;
+	edict_t		*ed;
+	int		i, j, type, *v;
+
+	snap = (savesnapshot_t *) ED_SaveAlloc (sizeof(savesnapshot_t));
+	snap->numedicts = sv.num_edicts;
+	snap->edictsize = pr_edict_size;
+	snap->edicts = (byte *) ED_SaveAlloc ((size_t)sv.num_edicts * pr_edict_size);
+	memcpy (snap->edicts, sv.edicts, (size_t)sv.num_edicts * pr_edict_size);
+	snap->globals = (int *) ED_SaveAlloc (progs->numglobals * sizeof(int));
+	memcpy (snap->globals, pr_globals, progs->numglobals * sizeof(int));
+
 	for (i = 0; i < progs->numglobaldefs; i++)
 	{
-		def = &pr_globaldefs[i];
-		type = def->type;
-		if ( !(def->type & DEF_SAVEGLOBAL) )
+		d = &pr_globaldefs[i];
+		if (ED_SavedGlobal (d) && (d->type & ~DEF_SAVEGLOBAL) == ev_string)
+			snap->globals[d->ofs] = ED_SnapshotString (snap, snap->globals[d->ofs]);
+	}
+
+	snap->fixups = (int *) ED_SaveAlloc (progs->numfielddefs * sizeof(int));
+	snap->fixuptypes = (int *) ED_SaveAlloc (progs->numfielddefs * sizeof(int));
+	for (i = 0; i < progs->numfielddefs; i++)
+	{
+		d = &pr_fielddefs[i];
+		type = d->type & ~DEF_SAVEGLOBAL;
+		if (ED_SavedField (d) && (type == ev_string || type == ev_entity) &&
+			d->ofs < progs->entityfields)
+		{
+			snap->fixups[snap->numfixups] = d->ofs;
+			snap->fixuptypes[snap->numfixups] = type;
+			snap->numfixups++;
+		}
+	}
+
+	for (i = 0; i < snap->numedicts; i++)
+	{
+		ed = (edict_t *)(snap->edicts + i * snap->edictsize);
+		if (ed->free)
 			continue;
-		type &= ~DEF_SAVEGLOBAL;
+		v = (int *)&ed->v;
+		for (j = 0; j < snap->numfixups; j++)
+		{
+			if (snap->fixuptypes[j] == ev_string)
+				v[snap->fixups[j]] = ED_SnapshotString (snap, v[snap->fixups[j]]);
+		}
+	}
 
-		if (type != ev_string && type != ev_float && type != ev_entity)
-			continue;
+	return snap;
+}
 
-		name = PR_GetString(def->s_name);
-		fprintf (f, "\"%s\" ", name);
-		fprintf (f, "\"%s\"\n", PR_UglyValueString(type, (eval_t *)&pr_globals[def->ofs]));
+void ED_FreeSnapshot (savesnapshot_t *snap)
+{
+	if (!snap)
+		return;
+	free (snap->edicts);
+	free (snap->globals);
+	free (snap->fixups);
+	free (snap->fixuptypes);
+	free (snap->text);
+	free (snap->hashkeys);
+	free (snap->hashvalues);
+	free (snap);
+}
+
+static void ED_WriteDefs (savebuf_t *b, ddef_t *defs, int numdefs, qboolean (*saved) (ddef_t *d))
+{
+	int	i, count;
+
+	for (i = count = 0; i < numdefs; i++)
+	{
+		if (saved (&defs[i]))
+			count++;
+	}
+	SaveBuf_WriteLong (b, count);
+	for (i = 0; i < numdefs; i++)
+	{
+		if (!saved (&defs[i]))
+			continue;
+		SaveBuf_WriteLong (b, defs[i].type & ~DEF_SAVEGLOBAL);
+		SaveBuf_WriteLong (b, defs[i].ofs);
+		SaveBuf_WriteString (b, PR_GetString (defs[i].s_name));
 	}
-	fprintf (f, "}\n");
 }
 
 /*
 =============
-ED_ParseGlobals
+ED_WriteSnapshot
+
+Appends the snapshot's globals and edicts to b.  Safe off the main thread.
 =============
 */
-const char *ED_ParseGlobals (const char *data)
+void ED_WriteSnapshot (savesnapshot_t *snap, savebuf_t *b)
 {
-	char	keyname[64];
-	ddef_t	*key;
-
-	while (1)
-	{
-	// parse key
-		data = COM_Parse (data);
-		if (com_token[0] == '}')
-			break;
-		if (!data)
-			Host_Error ("ED_ParseEntity: EOF without closing brace");
+	ddef_t		*d;
+	edict_t		*ed;
+	int		*words;
+	int		i, j, type;
+	byte		flags[2];
+
+	SaveBuf_WriteLong (b, pr_crc);
+	SaveBuf_WriteLong (b, progs->entityfields);
+	SaveBuf_WriteLong (b, progs->numfunctions);
+	for (i = 0; i < progs->numfunctions; i++)
+		SaveBuf_WriteString (b, PR_GetString (pr_functions[i].s_name));
+	ED_WriteDefs (b, pr_fielddefs, progs->numfielddefs, ED_SavedField);
+	ED_WriteDefs (b, pr_globaldefs, progs->numglobaldefs, ED_SavedGlobal);
 
-		q_strlcpy (keyname, com_token, sizeof(keyname));
+	SaveBuf_WriteLong (b, snap->numstrings);
+	SaveBuf_Write (b, snap->text, snap->textsize);
 
-	// parse value
-		data = COM_Parse (data);
-		if (!data)
-			Host_Error ("ED_ParseEntity: EOF without closing brace");
+// globals
+	for (i = 0; i < progs->numglobaldefs; i++)
+	{
+		d = &pr_globaldefs[i];
+		if (!ED_SavedGlobal (d))
+			continue;
+		j = snap->globals[d->ofs];
+		if ((d->type & ~DEF_SAVEGLOBAL) == ev_entity)
+			j /= snap->edictsize;
+		SaveBuf_WriteLong (b, j);
+	}
 
-		if (com_token[0] == '}')
-			Host_Error ("ED_ParseEntity: closing brace without data");
+// edicts
+	words = (int *) ED_SaveAlloc (progs->entityfields * sizeof(int));
+	SaveBuf_WriteLong (b, snap->numedicts);
+	for (i = 0; i < snap->numedicts; i++)
+	{
+		ed = (edict_t *)(snap->edicts + i * snap->edictsize);
+		flags[0] = ed->free;
+		flags[1] = ed->alpha;
+		SaveBuf_Write (b, flags, 2);
+		if (ed->free)
+			continue;
 
-		key = ED_FindGlobal (keyname);
-		if (!key)
+		memcpy (words, &ed->v, progs->entityfields * sizeof(int));
+		for (j = 0; j < snap->numfixups; j++)
 		{
-			Con_Printf ("'%s' is not a global\n", keyname);
-			continue;
+			type = snap->fixuptypes[j];
+			if (type == ev_entity)
+				words[snap->fixups[j]] /= snap->edictsize;
 		}
-
-		if (!ED_ParseEpair ((void *)pr_globals, key, com_token))
-			Host_Error ("ED_ParseGlobals: parse error");
+		if (host_bigendian)
+		{
+			for (j = 0; j < progs->entityfields; j++)
+				words[j] = LittleLong (words[j]);
+		}
+		SaveBuf_Write (b, words, progs->entityfields * sizeof(int));
 	}
-	return data;
+	free (words);
 }
 
-//============================================================================
-
-
 /*
 =============
-ED_NewString
+ED_WriteBinary
+
+Appends the globals and all edicts to b.
 =============
 */
-static string_t ED_NewString (const char *string)
+void ED_WriteBinary (savebuf_t *b)
 {
-	char	*new_p;
-	int		i, l;
-	string_t	num;
+	savesnapshot_t	*snap;
 
-	l = strlen(string) + 1;
-	num = PR_AllocString (l, &new_p);
+	snap = ED_CreateSnapshot ();
+	ED_WriteSnapshot (snap, b);
+	ED_FreeSnapshot (snap);
+}
 
-	for (i = 0; i < l; i++)
+static int ED_LoadValue (int type, int v, int numfunctions, int numfieldmap)
+{
+	savescratch_t	*s = &ed_savescratch;
+	char		*p;
+	int		i, len;
+
+	switch (type)
 	{
-		if (string[i] == '\\' && i < l-1)
+	case ev_string:
+		if (!v)
+			return 0;
+		if (v < 0 || v > s->numstrings)
+			Host_Error ("Savegame has a bad string index %d", v);
+		len = strlen (s->strings[v - 1]) + 1;
+		i = PR_AllocString (len, &p);
+		memcpy (p, s->strings[v - 1], len);
+		return i;
+	case ev_entity:
+		if (v < 0 || v >= sv.max_edicts)
+			Host_Error ("Savegame has a bad edict number %d", v);
+		return EDICT_TO_PROG(EDICT_NUM(v));
+	case ev_function:
+		return (v >= 0 && v < numfunctions) ? s->funcmap[v] : 0;
+	case ev_field:
+		if (!s->fieldmap)
+			return v;
+		for (i = 0; i < numfieldmap; i++)
 		{
-			i++;
-			if (string[i] == 'n')
-				*new_p++ = '\n';
-			else
-				*new_p++ = '\\';
+			if (s->fieldmap[i * 2] == v)
+				return s->fieldmap[i * 2 + 1];
 		}
-		else
-			*new_p++ = string[i];
+		return 0;
+	default:
+		return v;
 	}
-
-	return num;
 }
 
+static int ED_CompareCopies (const void *a, const void *b)
+{
+	return ((const savecopy_t *) a)->src - ((const savecopy_t *) b)->src;
+}
 
 /*
 =============
-ED_ParseEval
+ED_ReadBinary
 
-Can parse either fields or globals
-returns false if error
+Loads the globals and edicts written by ED_WriteBinary into the freshly
+spawned server and links them.  Returns the number of edicts read.
 =============
 */
-static qboolean ED_ParseEpair (void *base, ddef_t *key, const char *s)
+int ED_ReadBinary (savebuf_t *b)
 {
-	int		i;
-	char	string[128];
-	ddef_t	*def;
-	char	*v, *w;
-	char	*end;
-	void	*d;
-	dfunction_t	*func;
+	savescratch_t	*s = &ed_savescratch;
+	savecopy_t	*c, *plain, *typed;
+	ddef_t		*d;
+	edict_t		*ent;
+	const char	*name;
+	const int	*raw;
+	int		crc, entityfields, numfunctions, numfields, numglobals;
+	int		numplain, numtyped, numfieldmap, size;
+	int		i, j, k, entnum, numedicts, type, ofs;
+	qboolean	sameprogs;
+	const byte	*flags;
+	dfunction_t	*f;
 
-	d = (void *)((int *)base + key->ofs);
+	ED_FreeSaveScratch ();
 
-	switch (key->type & ~DEF_SAVEGLOBAL)
+	crc = SaveBuf_ReadLong (b);
+	entityfields = SaveBuf_ReadLong (b);
+	numfunctions = SaveBuf_ReadLong (b);
+	if (entityfields < 0 || numfunctions < 0 || numfunctions > b->cursize)
+		Host_Error ("Savegame has a bad progs header");
+	sameprogs = (crc == pr_crc && entityfields == progs->entityfields && numfunctions == progs->numfunctions);
+	if (!sameprogs)
+		Con_Printf ("Savegame was written by different progs, remapping fields\n");
+
+	s->funcmap = (int *) ED_SaveAlloc (numfunctions * sizeof(int));
+	for (i = 0; i < numfunctions; i++)
 	{
-	case ev_string:
-		*(string_t *)d = ED_NewString(s);
-		break;
+		name = SaveBuf_ReadString (b);
+		if (sameprogs)
+			s->funcmap[i] = i;
+		else if ((f = ED_FindFunction (name)) != NULL)
+			s->funcmap[i] = f - pr_functions;
+	}
 
-	case ev_float:
-		*(float *)d = atof (s);
-		break;
+// fields: plain words become copy runs, typed ones are fixed up one by one
+	numfields = SaveBuf_ReadLong (b);
+	if (numfields < 0 || numfields > b->cursize)
+		Host_Error ("Savegame has a bad field table");
+	s->copies = (savecopy_t *) ED_SaveAlloc ((numfields + 1) * sizeof(savecopy_t));
+	s->typed = (savecopy_t *) ED_SaveAlloc ((numfields + 1) * sizeof(savecopy_t));
+	if (!sameprogs)
+		s->fieldmap = (int *) ED_SaveAlloc (numfields * 2 * sizeof(int));
+	numplain = numfieldmap = 0;
+	for (i = 0; i < numfields; i++)
+	{
+		type = SaveBuf_ReadLong (b);
+		ofs = SaveBuf_ReadLong (b);
+		name = SaveBuf_ReadString (b);
+		d = ED_FindField (name);
+		if (!d || (d->type & ~DEF_SAVEGLOBAL) != type || type < 0 || type >= NUM_TYPE_SIZES)
+			continue;
+		size = type_size[type];
+		if (ofs < 0 || ofs + size > entityfields || d->ofs + size > progs->entityfields)
+			continue;
+		if (s->fieldmap)
+		{
+			s->fieldmap[numfieldmap * 2] = ofs;
+			s->fieldmap[numfieldmap * 2 + 1] = d->ofs;
+			numfieldmap++;
+		}
+		c = &s->copies[numplain++];
+		c->type = type;
+		c->src = ofs;
+		c->dst = d->ofs;
+		c->count = size;
+	}
 
-	case ev_vector:
-		q_strlcpy (string, s, sizeof(string));
-		end = (char *)string + strlen(string);
-		v = string;
-		w = string;
+	qsort (s->copies, numplain, sizeof(savecopy_t), ED_CompareCopies);
+	typed = s->typed;
+	numtyped = 0;
+	for (i = j = 0; i < numplain; i++)
+	{
+		c = &s->copies[i];
+		if (c->type == ev_string || c->type == ev_entity ||
+			(!sameprogs && (c->type == ev_function || c->type == ev_field)))
+		{
+			typed[numtyped++] = *c;
+			if (!sameprogs)
+				continue;
+			// with the same progs it can ride along in the copy runs and
+			// be fixed up over them, so only the unsaved fields split runs
+		}
+		plain = j ? &s->copies[j - 1] : NULL;
+		if (plain && plain->src + plain->count == c->src && plain->dst + plain->count == c->dst)
+			plain->count += c->count;
+		else
+			s->copies[j++] = *c;
+	}
+	numplain = j;
+
+// globals
+	numglobals = SaveBuf_ReadLong (b);
+	if (numglobals < 0 || numglobals > b->cursize)
+		Host_Error ("Savegame has a bad global table");
+	s->globalmap = (int *) ED_SaveAlloc (numglobals * 2 * sizeof(int));
+	for (i = 0; i < numglobals; i++)
+	{
+		type = SaveBuf_ReadLong (b);
+		SaveBuf_ReadLong (b);
+		name = SaveBuf_ReadString (b);
+		d = ED_FindGlobal (name);
+		s->globalmap[i * 2] = (d && (d->type & ~DEF_SAVEGLOBAL) == type) ? d->ofs : -1;
+		s->globalmap[i * 2 + 1] = type;
+	}
 
-		for (i = 0; i < 3 && (w <= end); i++) // ericw -- added (w <= end) check
+// strings
+	s->numstrings = SaveBuf_ReadLong (b);
+	if (s->numstrings < 0 || s->numstrings > b->cursize)
+		Host_Error ("Savegame has a bad string table");
+	s->strings = (const char **) ED_SaveAlloc (s->numstrings * sizeof(char *));
+	for (i = 0; i < s->numstrings; i++)
+		s->strings[i] = SaveBuf_ReadString (b);
+
+	for (i = 0; i < numglobals; i++)
+	{
+		j = SaveBuf_ReadLong (b);
+		if (s->globalmap[i * 2] >= 0)
+			G_INT(s->globalmap[i * 2]) = ED_LoadValue (s->globalmap[i * 2 + 1], j, numfunctions, numfieldmap);
+	}
+
+// edicts
+	numedicts = SaveBuf_ReadLong (b);
+	for (entnum = 0; entnum < numedicts; entnum++)
+	{
+		ent = EDICT_NUM(entnum);
+		if (entnum < sv.num_edicts)
 		{
-		// set v to the next space (or 0 byte), and change that char to a 0 byte
-			while (*v && *v != ' ')
-				v++;
-			*v = 0;
-			((float *)d)[i] = atof (w);
-			w = v = v+1;
+			ent->free = false;
+			memset (&ent->v, 0, progs->entityfields * 4);
 		}
-		// ericw -- fill remaining elements to 0 in case we hit the end of string
-		// before reading 3 floats.
-		if (i < 3)
+		else
 		{
-			Con_DWarning ("Avoided reading garbage for \"%s\" \"%s\"\n", PR_GetString(key->s_name), s);
-			for (; i < 3; i++)
-				((float *)d)[i] = 0.0f;
+			memset (ent, 0, pr_edict_size);
+			ent->baseline.scale = ENTSCALE_DEFAULT;
 		}
-		break;
 
-	case ev_entity:
-		*(int *)d = EDICT_TO_PROG(EDICT_NUM(atoi (s)));
-		break;
+		flags = SaveBuf_Read (b, 2);
+		ent->alpha = flags[1];
+		if (flags[0])
+			ent->free = true;
+		else
+		{
+			raw = (const int *) SaveBuf_Read (b, entityfields * 4);
+			for (i = 0; i < numplain; i++)
+			{
+				c = &s->copies[i];
+				if (!host_bigendian)
+					memcpy ((int *)&ent->v + c->dst, raw + c->src, c->count * 4);
+				else
+				{
+					for (k = 0; k < c->count; k++)
+						((int *)&ent->v)[c->dst + k] = LittleLong (raw[c->src + k]);
+				}
+			}
+			for (i = 0; i < numtyped; i++)
+			{
+				c = &typed[i];
+				memcpy (&j, raw + c->src, 4);
+				((int *)&ent->v)[c->dst] = ED_LoadValue (c->type, LittleLong (j), numfunctions, numfieldmap);
+			}
+		}
 
-	case ev_field:
-		def = ED_FindField (s);
-		if (!def)
+		ED_UpdateClassIndex (ent);
+		if (!ent->free)
+			SV_LinkEdict (ent, false);
+	}
+
+	ED_FreeSaveScratch ();
+	return numedicts;
+}
+
+/*
+===============================================================================
+
+ENTITY LUMP CACHE
+
+Tokenizing the entity lump and looking up every key and spawn function is
+most of the work of spawning a big map, and the same lump comes back on a
+restart, a changelevel to a visited map or a coop respawn.  The tokenized
+lump is kept across maps, keyed by the CRC and length of the lump text,
+with the key munging of ED_ParseEdict already applied.  Field lookups, the
+values of every non-string, non-entity field and the spawn function of
+each entity are resolved against the progs once and reused until a
+different progs.dat is loaded.
+===============================================================================
+*/
+
+#define	ENTLUMP_CACHE	4
+
+#define	ENTPAIR_ALPHA		1	// key is "alpha"
+#define	ENTPAIR_QUIET		2	// unknown key not worth a warning
+#define	ENTPAIR_PARSED		4	// value is in words[]
+
+typedef struct
+{
+	int		key, value;	// offsets into text
+	int		flags;
+	int		field;		// index into pr_fielddefs, -1 = not a field
+	int		words[3];	// resolved float, vector, field or function value
+} entpair_t;
+
+typedef struct
+{
+	int		firstpair, numpairs;
+	qboolean	init;		// had any key at all, including _comments
+	int		spawnfunc;	// function index, -1 = none
+} entlumpent_t;
+
+typedef struct
+{
+	unsigned short	crc;
+	int		length;
+	char		*lump;		// copy of the source text, to rule out collisions
+	int		lastused;
+
+	char		*text;
+	int		textsize, textmax;
+	entlumpent_t	*ents;
+	int		numents, maxents;
+	entpair_t	*pairs;
+	int		numpairs, maxpairs;
+
+	// the progs it was resolved against
+	qboolean	resolved;
+	unsigned short	progscrc;
+	int		progssize, numfunctions, entityfields;
+} entlump_t;
+
+static	entlump_t	ed_entlumps[ENTLUMP_CACHE];
+static	entlump_t	ed_entlumpbuild;	// being tokenized, freed if that fails
+static	int		ed_entlumpclock;
+
+static void ED_FreeEntityLump (entlump_t *lump)
+{
+	free (lump->lump);
+	free (lump->text);
+	free (lump->ents);
+	free (lump->pairs);
+	memset (lump, 0, sizeof(*lump));
+}
+
+static int ED_EntityLumpText (entlump_t *lump, const char *s)
+{
+	int	len = strlen (s) + 1;
+	int	ofs = lump->textsize;
+
+	if (lump->textsize + len > lump->textmax)
+	{
+		lump->textmax = q_max(lump->textmax * 2, lump->textsize + len + 16384);
+		lump->text = (char *) realloc (lump->text, lump->textmax);
+		if (!lump->text)
+			Sys_Error ("ED_EntityLumpText: out of memory");
+	}
+	memcpy (lump->text + ofs, s, len);
+	lump->textsize += len;
+	return ofs;
+}
+
+/*
+================
+ED_TokenizeEntityLump
+
+Same parse as ED_LoadFromFile and ED_ParseEdict, minus the edicts
+================
+*/
+static void ED_TokenizeEntityLump (entlump_t *lump, const char *data)
+{
+	entlumpent_t	*e;
+	entpair_t	*p;
+	char		keyname[256];
+	qboolean	anglehack;
+	int		n;
+
+	while (1)
+	{
+		// parse the opening brace
+		data = COM_Parse (data);
+		if (!data)
+			break;
+		if (com_token[0] != '{')
+			Host_Error ("ED_LoadFromFile: found %s when expecting {",com_token);
+
+		if (lump->numents == lump->maxents)
 		{
-			//johnfitz -- HACK -- suppress error becuase fog/sky fields might not be mentioned in defs.qc
-			if (strncmp(s, "sky", 3) && strcmp(s, "fog"))
-				Con_DPrintf ("Can't find field %s\n", s);
-			return false;
+			lump->maxents = q_max(lump->maxents * 2, 256);
+			lump->ents = (entlumpent_t *) realloc (lump->ents, lump->maxents * sizeof(entlumpent_t));
+			if (!lump->ents)
+				Sys_Error ("ED_TokenizeEntityLump: out of memory");
 		}
-		*(int *)d = G_INT(def->ofs);
-		break;
+		e = &lump->ents[lump->numents++];
+		e->firstpair = lump->numpairs;
+		e->numpairs = 0;
+		e->init = false;
+		e->spawnfunc = -1;
 
-	case ev_function:
-		func = ED_FindFunction (s);
-		if (!func)
+		while (1)
+		{
+			// parse key
+			data = COM_Parse (data);
+			if (com_token[0] == '}')
+				break;
+			if (!data)
+				Host_Error ("ED_ParseEntity: EOF without closing brace");
+
+			anglehack = !strcmp (com_token, "angle");
+			if (anglehack)
+				strcpy (com_token, "angles");
+
+			// FIXME: change light to _light to get rid of this hack
+			if (!strcmp(com_token, "light"))
+				strcpy (com_token, "light_lev");	// hack for single light def
+
+			q_strlcpy (keyname, com_token, sizeof(keyname));
+
+			// another hack to fix keynames with trailing spaces
+			n = strlen(keyname);
+			while (n && keyname[n-1] == ' ')
+			{
+				keyname[n-1] = 0;
+				n--;
+			}
+
+			// parse value
+			data = COM_ParseEx (data, !strcmp (keyname, "wad") ? CPE_ALLOWTRUNC : CPE_NOTRUNC);
+			if (!data)
+				Host_Error ("ED_ParseEntity: EOF without closing brace");
+
+			if (com_token[0] == '}')
+				Host_Error ("ED_ParseEntity: closing brace without data");
+
+			e->init = true;
+
+			// keynames with a leading underscore are used for utility comments,
+			// and are immediately discarded by quake
+			if (keyname[0] == '_')
+				continue;
+
+			if (lump->numpairs == lump->maxpairs)
+			{
+				lump->maxpairs = q_max(lump->maxpairs * 2, 1024);
+				lump->pairs = (entpair_t *) realloc (lump->pairs, lump->maxpairs * sizeof(entpair_t));
+				if (!lump->pairs)
+					Sys_Error ("ED_TokenizeEntityLump: out of memory");
+			}
+			p = &lump->pairs[lump->numpairs++];
+			e->numpairs++;
+			memset (p, 0, sizeof(*p));
+			p->field = -1;
+			p->key = ED_EntityLumpText (lump, keyname);
+			if (anglehack)
+			{
+				char	temp[32];
+				q_strlcpy (temp, com_token, sizeof(temp));
+				q_snprintf (com_token, sizeof(com_token), "0 %s 0", temp);
+			}
+			p->value = ED_EntityLumpText (lump, com_token);
+
+			if (!strcmp(keyname, "alpha"))
+				p->flags |= ENTPAIR_ALPHA;
+			//johnfitz -- HACK -- suppress error becuase fog/sky/alpha fields might not be mentioned in defs.qc
+			if (!strncmp(keyname, "sky", 3) || !strcmp(keyname, "fog") || !strcmp(keyname, "alpha"))
+				p->flags |= ENTPAIR_QUIET;
+		}
+	}
+}
+
+/*
+================
+ED_ResolveEntityLump
+
+Binds keys to fields and classnames to spawn functions for the current progs
+================
+*/
+static void ED_ResolveEntityLump (entlump_t *lump)
+{
+	entlumpent_t	*e;
+	entpair_t	*p;
+	ddef_t		*key, def;
+	dfunction_t	*func;
+	const char	*classname;
+	int		i, j, type;
+
+	for (i = 0; i < lump->numpairs; i++)
+	{
+		p = &lump->pairs[i];
+		p->flags &= ~ENTPAIR_PARSED;
+		key = ED_FindField (lump->text + p->key);
+		p->field = key ? key - pr_fielddefs : -1;
+		if (!key)
+			continue;
+
+		type = key->type & ~DEF_SAVEGLOBAL;
+		if (type == ev_float || type == ev_vector || type == ev_field || type == ev_function)
 		{
-			Con_Printf ("Can't find function %s\n", s);
-			return false;
+			def = *key;
+			def.ofs = 0;
+			if (!ED_ParseEpair ((void *)p->words, &def, lump->text + p->value))
+				Host_Error ("ED_ParseEdict: parse error");
+			p->flags |= ENTPAIR_PARSED;
 		}
-		*(func_t *)d = func - pr_functions;
-		break;
+	}
 
-	default:
-		break;
+	for (i = 0; i < lump->numents; i++)
+	{
+		e = &lump->ents[i];
+		classname = NULL;
+		for (j = 0; j < e->numpairs; j++)
+		{
+			p = &lump->pairs[e->firstpair + j];
+			if (!strcmp (lump->text + p->key, "classname"))
+				classname = lump->text + p->value;
+		}
+		func = classname ? ED_FindFunction (classname) : NULL;
+		e->spawnfunc = func ? func - pr_functions : -1;
 	}
-	return true;
+
+	lump->resolved = true;
+	lump->progscrc = pr_crc;
+	lump->progssize = pr_progssize;
+	lump->numfunctions = progs->numfunctions;
+	lump->entityfields = progs->entityfields;
 }
 
 /*
-====================
-ED_ParseEdict
+================
+ED_EntityLumpResolved
 
-Parses an edict out of the given string, returning the new position
-ed should be a properly initialized empty edict.
-Used for initial level load and for savegames.
-====================
+True when the lump was resolved against the progs that are loaded now.
+The same progs.dat comes back on every map spawn; field and function
+indices only change with a different one.
+================
 */
-const char *ED_ParseEdict (const char *data, edict_t *ent)
+static qboolean ED_EntityLumpResolved (const entlump_t *lump)
 {
-	ddef_t		*key;
-	char		keyname[256];
-	qboolean	anglehack, init;
-	int		n;
+	return lump->resolved && lump->progscrc == pr_crc && lump->progssize == pr_progssize
+		&& lump->numfunctions == progs->numfunctions && lump->entityfields == progs->entityfields;
+}
 
-	init = false;
+/*
+================
+ED_CachedEntityLump
 
-	// clear it
-	if (ent != sv.edicts)	// hack
-		memset (&ent->v, 0, progs->entityfields * 4);
+Finds or builds the cache entry for an entity lump
+================
+*/
+static entlump_t *ED_CachedEntityLump (const char *data)
+{
+	entlump_t	*lump, *oldest;
+	unsigned short	crc;
+	int		i, length;
 
-	// go through all the dictionary pairs
-	while (1)
+	length = strlen (data);
+	crc = CRC_Block ((const byte *)data, length);
+
+	oldest = &ed_entlumps[0];
+	for (i = 0; i < ENTLUMP_CACHE; i++)
 	{
-		// parse key
-		data = COM_Parse (data);
-		if (com_token[0] == '}')
+		lump = &ed_entlumps[i];
+		if (lump->lump && lump->crc == crc && lump->length == length && !memcmp (lump->lump, data, length))
 			break;
-		if (!data)
-			Host_Error ("ED_ParseEntity: EOF without closing brace");
-
-		// anglehack is to allow QuakeEd to write single scalar angles
-		// and allow them to be turned into vectors. (FIXME...)
-		if (!strcmp(com_token, "angle"))
-		{
-			strcpy (com_token, "angles");
-			anglehack = true;
-		}
-		else
-			anglehack = false;
-
-		// FIXME: change light to _light to get rid of this hack
-		if (!strcmp(com_token, "light"))
-			strcpy (com_token, "light_lev");	// hack for single light def
+		if (lump->lastused < oldest->lastused)
+			oldest = lump;
+	}
 
-		q_strlcpy (keyname, com_token, sizeof(keyname));
+	if (i == ENTLUMP_CACHE)
+	{
+		ED_FreeEntityLump (&ed_entlumpbuild);
+		ED_TokenizeEntityLump (&ed_entlumpbuild, data);
+		ed_entlumpbuild.lump = (char *) malloc (length + 1);
+		if (!ed_entlumpbuild.lump)
+			Sys_Error ("ED_CachedEntityLump: out of memory");
+		memcpy (ed_entlumpbuild.lump, data, length + 1);
+		ed_entlumpbuild.crc = crc;
+		ed_entlumpbuild.length = length;
+
+		lump = oldest;
+		ED_FreeEntityLump (lump);
+		*lump = ed_entlumpbuild;
+		memset (&ed_entlumpbuild, 0, sizeof(ed_entlumpbuild));
+	}
+	else
+		Con_DPrintf ("Reusing tokenized entity lump\n");
 
-		// another hack to fix keynames with trailing spaces
-		n = strlen(keyname);
-		while (n && keyname[n-1] == ' ')
-		{
-			keyname[n-1] = 0;
-			n--;
-		}
+	if (!ED_EntityLumpResolved (lump))
+		ED_ResolveEntityLump (lump);
+	lump->lastused = ++ed_entlumpclock;
+	return lump;
+}
 
-		// parse value
-		// HACK: we allow truncation when reading the wad field,
-		// otherwise maps using lots of wads with absolute paths
-		// could cause a parse error
-		data = COM_ParseEx (data, !strcmp (keyname, "wad") ? CPE_ALLOWTRUNC : CPE_NOTRUNC);
-		if (!data)
-			Host_Error ("ED_ParseEntity: EOF without closing brace");
+/*
+================
+ED_SpawnCachedEdict
 
-		if (com_token[0] == '}')
-			Host_Error ("ED_ParseEntity: closing brace without data");
+ED_ParseEdict on a cached entity
+================
+*/
+static void ED_SpawnCachedEdict (entlump_t *lump, entlumpent_t *e, edict_t *ent)
+{
+	entpair_t	*p;
+	ddef_t		*key;
+	int		i;
 
-		init = true;
+	// clear it
+	if (ent != sv.edicts)	// hack
+		memset (&ent->v, 0, progs->entityfields * 4);
 
-		// keynames with a leading underscore are used for utility comments,
-		// and are immediately discarded by quake
-		if (keyname[0] == '_')
-			continue;
+	for (i = 0; i < e->numpairs; i++)
+	{
+		p = &lump->pairs[e->firstpair + i];
 
 		//johnfitz -- hack to support .alpha even when progs.dat doesn't know about it
-		if (!strcmp(keyname, "alpha"))
-			ent->alpha = ENTALPHA_ENCODE(Q_atof(com_token));
+		if (p->flags & ENTPAIR_ALPHA)
+			ent->alpha = ENTALPHA_ENCODE(Q_atof(lump->text + p->value));
 		//johnfitz
 
-		key = ED_FindField (keyname);
-		if (!key)
+		if (p->field < 0)
 		{
-			//johnfitz -- HACK -- suppress error becuase fog/sky/alpha fields might not be mentioned in defs.qc
-			if (strncmp(keyname, "sky", 3) && strcmp(keyname, "fog") && strcmp(keyname, "alpha"))
-				Con_DPrintf ("\"%s\" is not a field\n", keyname); //johnfitz -- was Con_Printf
+			if (!(p->flags & ENTPAIR_QUIET))
+				Con_DPrintf ("\"%s\" is not a field\n", lump->text + p->key); //johnfitz -- was Con_Printf
 			continue;
 		}
 
-		if (anglehack)
-		{
-			char	temp[32];
-			strcpy (temp, com_token);
-			sprintf (com_token, "0 %s 0", temp);
-		}
-
-		if (!ED_ParseEpair ((void *)&ent->v, key, com_token))
+		key = &pr_fielddefs[p->field];
+		if (p->flags & ENTPAIR_PARSED)
+			memcpy ((int *)&ent->v + key->ofs, p->words, type_size[key->type & ~DEF_SAVEGLOBAL] * 4);
+		else if (!ED_ParseEpair ((void *)&ent->v, key, lump->text + p->value))
 			Host_Error ("ED_ParseEdict: parse error");
 	}
 
-	if (!init)
+	if (!e->init)
 		ent->free = true;
 
-	return data;
+	ED_UpdateClassIndex (ent);
 }
 
-
 /*
 ================
 ED_LoadFromFile
@@ -988,24 +2736,24 @@ void ED_LoadFromFile (const char *data)
 	dfunction_t	*func;
 	edict_t		*ent = NULL;
 	int		inhibit = 0;
+	entlump_t	*lump;
+	entlumpent_t	*e;
+	int		i;
 
 	pr_global_struct->time = sv.time;
 
+	lump = ED_CachedEntityLump (data);
+
 	// parse ents
-	while (1)
+	for (i = 0; i < lump->numents; i++)
 	{
-		// parse the opening brace
-		data = COM_Parse (data);
-		if (!data)
-			break;
-		if (com_token[0] != '{')
-			Host_Error ("ED_LoadFromFile: found %s when expecting {",com_token);
+		e = &lump->ents[i];
 
 		if (!ent)
 			ent = EDICT_NUM(0);
 		else
 			ent = ED_Alloc ();
-		data = ED_ParseEdict (data, ent);
+		ED_SpawnCachedEdict (lump, e, ent);
 
 		// remove things from different skill levels or deathmatch
 		if (deathmatch.value)
@@ -1046,7 +2794,7 @@ void ED_LoadFromFile (const char *data)
 		}
 
 	// look for the spawn function
-		func = ED_FindFunction ( PR_GetString(ent->v.classname) );
+		func = (e->spawnfunc >= 0) ? &pr_functions[e->spawnfunc] : NULL;
 
 		if (!func)
 		{
@@ -1165,16 +2913,13 @@ void PR_LoadProgs (void)
 {
 	int			i;
 
-	// flush the non-C variable lookup cache
-	for (i = 0; i < GEFV_CACHESIZE; i++)
-		gefvCache[i].field[0] = 0;
-
 	CRC_Init (&pr_crc);
 
 	progs = (dprograms_t *)COM_LoadHunkFile ("progs.dat", NULL);
 	if (!progs)
 		Host_Error ("PR_LoadProgs: couldn't load progs.dat");
 	Con_DPrintf ("Programs occupy %iK.\n", com_filesize/1024);
+	pr_progssize = com_filesize;
 
 	for (i = 0; i < com_filesize; i++)
 		CRC_ProcessByte (&pr_crc, ((byte *)progs)[i]);
@@ -1194,12 +2939,8 @@ void PR_LoadProgs (void)
 		Host_Error ("progs.dat strings go past end of file\n");
 
 	// initialize the strings
-	pr_numknownstrings = 0;
-	pr_maxknownstrings = 0;
+	PR_ClearStrings ();
 	pr_stringssize = progs->numstrings;
-	if (pr_knownstrings)
-		Z_Free ((void *)pr_knownstrings);
-	pr_knownstrings = NULL;
 	PR_SetEngineString("");
 
 	pr_globaldefs = (ddef_t *)((byte *)progs + progs->ofs_globaldefs);
@@ -1261,7 +3002,10 @@ void PR_LoadProgs (void)
 	pr_edict_size += sizeof(void *) - 1;
 	pr_edict_size &= ~(sizeof(void *) - 1);
 
+	PR_BuildIndices ();
+	ED_ClearClassIndex ();
 	PR_PatchRereleaseBuiltins ();
+	PR_BindBuiltins ();
 	pr_effects_mask = PR_FindSupportedEffects ();
 }
 
@@ -1277,6 +3021,7 @@ void PR_Init (void)
 	Cmd_AddCommand ("edicts", ED_PrintEdicts);
 	Cmd_AddCommand ("edictcount", ED_Count);
 	Cmd_AddCommand ("profile", PR_Profile_f);
+	Cmd_AddCommand ("pr_vecbench", PR_VectorBench_f);
 	Cvar_RegisterVariable (&nomonsters);
 	Cvar_RegisterVariable (&gamecfg);
 	Cvar_RegisterVariable (&scratch1);
@@ -1305,7 +3050,8 @@ int NUM_FOR_EDICT(edict_t *e)
 	b = (byte *)e - (byte *)sv.edicts;
 	b = b / pr_edict_size;
 
-	if (b < 0 || b >= sv.num_edicts)
+	// trimmed edicts past sv.num_edicts can still be referenced by progs
+	if (b < 0 || b >= sv.max_edicts)
 		Host_Error ("NUM_FOR_EDICT: bad pointer");
 	return b;
 }
@@ -1313,13 +3059,237 @@ int NUM_FOR_EDICT(edict_t *e)
 //===========================================================================
 
 
+/*
+===============================================================================
+
+ENGINE STRINGS
+
+Negative string_t values index pr_knownstrings.  Slots are found by pointer
+through a chained hash (pr_knownstringhash holds slot+1 bucket heads, the
+chain continues through pr_knownstringlinks[].next), and released slots are
+kept on a free list threaded through the same link field, so registering or
+freeing a string is O(1) no matter how many are live.
+
+Strings created with PR_AllocString come from a dedicated string arena
+instead of the hunk: chunks are carved out of malloc'd blocks, freed chunks
+go back on a per-size free list for reuse, and the whole arena is dropped
+when the next progs is loaded, which SV_SpawnServer does on every map.
+Nothing is freed when a field or global holding one is overwritten: a
+string_t is copied by value, so another copy may still name it.  Between
+spawns the arena therefore holds the map's entity strings, a loaded
+save's strings and every strzone that was not strunzoned.
+===============================================================================
+*/
+
 #define	PR_STRING_ALLOCSLOTS	256
 
+typedef struct
+{
+	int		next;		// hash chain (live slot) or free list (released slot), slot+1
+	qboolean	allocated;	// points into the string arena
+} knownstringlink_t;
+
+static	knownstringlink_t	*pr_knownstringlinks;
+static	int		*pr_knownstringhash;
+static	int		pr_knownstringhashsize;	// power of two
+static	int		pr_freeknownstrings;	// free slot list head, slot+1
+
+#define	STRARENA_BLOCKSIZE	(64 * 1024)
+#define	STRARENA_GRANULE	16
+#define	STRARENA_CLASSES	64	// exact-size free lists up to 1024 bytes
+
+typedef struct strarenablock_s
+{
+	struct strarenablock_s	*next;
+	int		size, used;
+} strarenablock_t;
+
+typedef struct strarenachunk_s
+{
+	int		size;		// usable bytes, multiple of STRARENA_GRANULE
+	int		pad;
+	union
+	{
+		struct strarenachunk_s	*nextfree;
+		char	data[8];
+	} u;
+} strarenachunk_t;
+
+#define	STRARENA_HEADER		((int)offsetof(strarenachunk_t, u))
+
+static	strarenablock_t	*strarena_blocks;
+static	strarenachunk_t	*strarena_free[STRARENA_CLASSES];
+static	strarenachunk_t	*strarena_largefree;
+
+static void *PR_StringArenaAlloc (int size)
+{
+	strarenachunk_t	*chunk, **link;
+	strarenablock_t	*block;
+	int		need;
+
+	need = (size + STRARENA_GRANULE - 1) & ~(STRARENA_GRANULE - 1);
+	if (need <= 0)
+		need = STRARENA_GRANULE;
+
+	chunk = NULL;
+	if (need <= STRARENA_GRANULE * STRARENA_CLASSES)
+	{
+		link = &strarena_free[need / STRARENA_GRANULE - 1];
+		if (*link)
+		{
+			chunk = *link;
+			*link = chunk->u.nextfree;
+		}
+	}
+	else
+	{
+		for (link = &strarena_largefree; *link; link = &(*link)->u.nextfree)
+		{
+			if ((*link)->size >= need)
+			{
+				chunk = *link;
+				*link = chunk->u.nextfree;
+				break;
+			}
+		}
+	}
+
+	if (!chunk)
+	{
+		block = strarena_blocks;
+		if (!block || block->size - block->used < STRARENA_HEADER + need)
+		{
+			int blocksize = q_max(STRARENA_BLOCKSIZE, (int)sizeof(strarenablock_t) + STRARENA_HEADER + need);
+			block = (strarenablock_t *) malloc (blocksize);
+			if (!block)
+				Sys_Error ("PR_StringArenaAlloc: failed on allocation of %i bytes", blocksize);
+			block->next = strarena_blocks;
+			block->size = blocksize;
+			block->used = (sizeof(strarenablock_t) + 7) & ~7;
+			strarena_blocks = block;
+		}
+		chunk = (strarenachunk_t *)((byte *)block + block->used);
+		chunk->size = need;
+		block->used += STRARENA_HEADER + need;
+	}
+
+	memset (chunk->u.data, 0, chunk->size);
+	return chunk->u.data;
+}
+
+static void PR_StringArenaFree (void *ptr)
+{
+	strarenachunk_t	*chunk = (strarenachunk_t *)((byte *)ptr - STRARENA_HEADER);
+
+	if (chunk->size <= STRARENA_GRANULE * STRARENA_CLASSES)
+	{
+		chunk->u.nextfree = strarena_free[chunk->size / STRARENA_GRANULE - 1];
+		strarena_free[chunk->size / STRARENA_GRANULE - 1] = chunk;
+	}
+	else
+	{
+		chunk->u.nextfree = strarena_largefree;
+		strarena_largefree = chunk;
+	}
+}
+
+static void PR_StringArenaClear (void)
+{
+	strarenablock_t	*block, *next;
+
+	for (block = strarena_blocks; block; block = next)
+	{
+		next = block->next;
+		free (block);
+	}
+	strarena_blocks = NULL;
+	strarena_largefree = NULL;
+	memset (strarena_free, 0, sizeof(strarena_free));
+}
+
+static int PR_KnownStringHash (const char *s)
+{
+	uintptr_t	p = (uintptr_t)s;
+
+	p ^= p >> 16;
+	return (int)(((unsigned int)p * 0x9E3779B1u) >> 7) & (pr_knownstringhashsize - 1);
+}
+
+static void PR_LinkKnownString (int i)
+{
+	int	h = PR_KnownStringHash (pr_knownstrings[i]);
+
+	pr_knownstringlinks[i].next = pr_knownstringhash[h];
+	pr_knownstringhash[h] = i + 1;
+}
+
+static void PR_UnlinkKnownString (int i)
+{
+	int	*link = &pr_knownstringhash[PR_KnownStringHash (pr_knownstrings[i])];
+
+	while (*link)
+	{
+		if (*link == i + 1)
+		{
+			*link = pr_knownstringlinks[i].next;
+			return;
+		}
+		link = &pr_knownstringlinks[*link - 1].next;
+	}
+}
+
 static void PR_AllocStringSlots (void)
 {
-	pr_maxknownstrings += PR_STRING_ALLOCSLOTS;
+	int	i;
+
+	pr_maxknownstrings = pr_maxknownstrings ? pr_maxknownstrings * 2 : PR_STRING_ALLOCSLOTS;
 	Con_DPrintf2("PR_AllocStringSlots: realloc'ing for %d slots\n", pr_maxknownstrings);
-	pr_knownstrings = (const char **) Z_Realloc ((void *)pr_knownstrings, pr_maxknownstrings * sizeof(char *));
+	pr_knownstrings = (const char **) realloc ((void *)pr_knownstrings, pr_maxknownstrings * sizeof(char *));
+	pr_knownstringlinks = (knownstringlink_t *) realloc (pr_knownstringlinks, pr_maxknownstrings * sizeof(knownstringlink_t));
+	pr_knownstringhashsize = pr_maxknownstrings;
+	free (pr_knownstringhash);
+	pr_knownstringhash = (int *) calloc (pr_knownstringhashsize, sizeof(int));
+	if (!pr_knownstrings || !pr_knownstringlinks || !pr_knownstringhash)
+		Sys_Error ("PR_AllocStringSlots: out of memory for %d slots", pr_maxknownstrings);
+
+	// rehash the live slots; released slots stay on the free list
+	for (i = 0; i < pr_numknownstrings; i++)
+	{
+		if (pr_knownstrings[i])
+			PR_LinkKnownString (i);
+	}
+}
+
+static int PR_NewStringSlot (void)
+{
+	int	i;
+
+	if (pr_freeknownstrings)
+	{
+		i = pr_freeknownstrings - 1;
+		pr_freeknownstrings = pr_knownstringlinks[i].next;
+		return i;
+	}
+	if (pr_numknownstrings >= pr_maxknownstrings)
+		PR_AllocStringSlots();
+	return pr_numknownstrings++;
+}
+
+/*
+============
+PR_ClearStrings
+
+Drops every engine string and the string arena; called before a new progs
+is loaded.
+============
+*/
+static void PR_ClearStrings (void)
+{
+	PR_StringArenaClear ();
+	pr_numknownstrings = 0;
+	pr_freeknownstrings = 0;
+	if (pr_knownstringhash)
+		memset (pr_knownstringhash, 0, pr_knownstringhashsize * sizeof(int));
 }
 
 const char *PR_GetString (int num)
@@ -1342,6 +3312,24 @@ const char *PR_GetString (int num)
 	}
 }
 
+/*
+============
+PR_LookupString
+
+Like PR_GetString, but returns NULL for a bad offset instead of raising
+an error, for callers that walk typed defs whose slots may hold stale
+values (overlapped locals and the like).
+============
+*/
+const char *PR_LookupString (int num)
+{
+	if (num >= 0 && num < pr_stringssize)
+		return pr_strings + num;
+	if (num < 0 && num >= -pr_numknownstrings)
+		return pr_knownstrings[-1 - num];
+	return NULL;
+}
+
 int PR_SetEngineString (const char *s)
 {
 	int		i;
@@ -1355,27 +3343,20 @@ int PR_SetEngineString (const char *s)
 	if (s >= pr_strings && s <= pr_strings + pr_stringssize - 2)
 		return (int)(s - pr_strings);
 #endif
-	for (i = 0; i < pr_numknownstrings; i++)
+	if (pr_knownstringhash)
 	{
-		if (pr_knownstrings[i] == s)
-			return -1 - i;
+		for (i = pr_knownstringhash[PR_KnownStringHash (s)]; i; i = pr_knownstringlinks[i - 1].next)
+		{
+			if (pr_knownstrings[i - 1] == s)
+				return -i;
+		}
 	}
 	// new unknown engine string
 	//Con_DPrintf ("PR_SetEngineString: new engine string %p\n", s);
-#if 0
-	for (i = 0; i < pr_numknownstrings; i++)
-	{
-		if (!pr_knownstrings[i])
-			break;
-	}
-#endif
-//	if (i >= pr_numknownstrings)
-//	{
-		if (i >= pr_maxknownstrings)
-			PR_AllocStringSlots();
-		pr_numknownstrings++;
-//	}
+	i = PR_NewStringSlot ();
 	pr_knownstrings[i] = s;
+	pr_knownstringlinks[i].allocated = false;
+	PR_LinkKnownString (i);
 	return -1 - i;
 }
 
@@ -1385,20 +3366,54 @@ int PR_AllocString (int size, char **ptr)
 
 	if (!size)
 		return 0;
-	for (i = 0; i < pr_numknownstrings; i++)
-	{
-		if (!pr_knownstrings[i])
-			break;
-	}
-//	if (i >= pr_numknownstrings)
-//	{
-		if (i >= pr_maxknownstrings)
-			PR_AllocStringSlots();
-		pr_numknownstrings++;
-//	}
-	pr_knownstrings[i] = (char *)Hunk_AllocName(size, "string");
+	i = PR_NewStringSlot ();
+	pr_knownstrings[i] = (char *) PR_StringArenaAlloc (size);
+	pr_knownstringlinks[i].allocated = true;
+	PR_LinkKnownString (i);
 	if (ptr)
 		*ptr = (char *) pr_knownstrings[i];
 	return -1 - i;
 }
 
+// true for a string from PR_AllocString; its text stays put until freed
+static qboolean PR_AllocatedString (int num)
+{
+	return num < 0 && num >= -pr_numknownstrings && pr_knownstringlinks[-1 - num].allocated;
+}
+
+/*
+============
+PR_FreeString
+
+Releases a string from PR_AllocString, giving its slot and memory back.
+Progs strings and engine strings are left alone: engine string slots are
+shared through the pointer hash, so every string_t holding one would
+end up naming whatever reused it.
+============
+*/
+void PR_FreeString (int num)
+{
+	int		i;
+
+	if (num >= 0)
+		return;
+	i = -1 - num;
+	if (i >= pr_numknownstrings || !pr_knownstrings[i])
+	{
+		Con_DWarning ("PR_FreeString: invalid string %d\n", num);
+		return;
+	}
+	if (!pr_knownstringlinks[i].allocated)
+	{
+		Con_DWarning ("PR_FreeString: string %d was not allocated\n", num);
+		return;
+	}
+	PR_UnlinkKnownString (i);
+	ed_classstale = true;	// an edict may still name this slot
+	PR_StringArenaFree ((void *) pr_knownstrings[i]);
+	pr_knownstrings[i] = NULL;
+	pr_knownstringlinks[i].allocated = false;
+	pr_knownstringlinks[i].next = pr_freeknownstrings;
+	pr_freeknownstrings = i + 1;
+}
+
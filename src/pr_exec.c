@@ -247,6 +247,133 @@ void PR_Profile_f (void)
 }
 
 
+/*
+============
+PR_VectorBench_f
+
+pr_vecbench [passes]
+Times the SIMD vector helpers used by the vector opcodes and math builtins
+against the plain C expressions, and checks that both produce the same bits.
+============
+*/
+#define VECBENCH_COUNT	1024
+
+void PR_VectorBench_f (void)
+{
+	static vec3_t	a[VECBENCH_COUNT], b[VECBENCH_COUNT];
+	static vec3_t	c1[VECBENCH_COUNT], c2[VECBENCH_COUNT];
+	static vec3_t	f1[VECBENCH_COUNT], r1[VECBENCH_COUNT], u1[VECBENCH_COUNT];
+	static vec3_t	f2[VECBENCH_COUNT], r2[VECBENCH_COUNT], u2[VECBENCH_COUNT];
+	static float	d1[VECBENCH_COUNT], d2[VECBENCH_COUNT];
+	double		t0, t1, t2, len;
+	int		i, j, passes, mismatch;
+
+	passes = (Cmd_Argc() > 1) ? Q_atoi(Cmd_Argv(1)) : 1000;
+	if (passes < 1)
+		passes = 1;
+
+	for (i = 0; i < VECBENCH_COUNT; i++)
+	{
+		for (j = 0; j < 3; j++)
+		{
+			a[i][j] = (rand() & 0xffff) * (1.0f / 64.0f) - 512.0f;
+			b[i][j] = (rand() & 0xffff) * (1.0f / 64.0f) - 512.0f;
+		}
+	}
+
+	// add + scale + dot, the common QuakeC "org + dir * speed" pattern
+	t0 = Sys_DoubleTime ();
+	for (j = 0; j < passes; j++)
+	{
+		for (i = 0; i < VECBENCH_COUNT; i++)
+		{
+			c1[i][0] = a[i][0] + b[i][0] * d1[i];
+			c1[i][1] = a[i][1] + b[i][1] * d1[i];
+			c1[i][2] = a[i][2] + b[i][2] * d1[i];
+			d1[i] = (a[i][0] * c1[i][0] + a[i][1] * c1[i][1] + a[i][2] * c1[i][2]) * (1.0f / 65536.0f);
+		}
+	}
+	t1 = Sys_DoubleTime ();
+	for (j = 0; j < passes; j++)
+	{
+		for (i = 0; i < VECBENCH_COUNT; i++)
+		{
+			SIMD_VectorScale (b[i], d2[i], c2[i]);
+			SIMD_VectorAdd (a[i], c2[i], c2[i]);
+			d2[i] = SIMD_DotProduct (a[i], c2[i]) * (1.0f / 65536.0f);
+		}
+	}
+	t2 = Sys_DoubleTime ();
+
+	mismatch = 0;
+	for (i = 0; i < VECBENCH_COUNT; i++)
+	{
+		if (memcmp (c1[i], c2[i], sizeof(vec3_t)) || memcmp (&d1[i], &d2[i], sizeof(float)))
+			mismatch++;
+	}
+	Con_Printf ("vector ops:   scalar %7.2f ms, simd %7.2f ms, %i mismatches\n",
+			(t1 - t0) * 1000.0, (t2 - t1) * 1000.0, mismatch);
+
+	// normalize / vlen
+	t0 = Sys_DoubleTime ();
+	for (j = 0; j < passes; j++)
+	{
+		for (i = 0; i < VECBENCH_COUNT; i++)
+		{
+			len = (double)a[i][0] * a[i][0] + (double)a[i][1] * a[i][1] + (double)a[i][2] * a[i][2];
+			len = 1 / sqrt (len + j);
+			c1[i][0] = a[i][0] * len;
+			c1[i][1] = a[i][1] * len;
+			c1[i][2] = a[i][2] * len;
+		}
+	}
+	t1 = Sys_DoubleTime ();
+	for (j = 0; j < passes; j++)
+	{
+		for (i = 0; i < VECBENCH_COUNT; i++)
+		{
+			len = 1 / sqrt (SIMD_LengthSquaredD (a[i]) + j);
+			SIMD_VectorScaleD (a[i], len, c2[i]);
+		}
+	}
+	t2 = Sys_DoubleTime ();
+
+	mismatch = 0;
+	for (i = 0; i < VECBENCH_COUNT; i++)
+	{
+		if (memcmp (c1[i], c2[i], sizeof(vec3_t)))
+			mismatch++;
+	}
+	Con_Printf ("normalize:    scalar %7.2f ms, simd %7.2f ms, %i mismatches\n",
+			(t1 - t0) * 1000.0, (t2 - t1) * 1000.0, mismatch);
+
+	// makevectors
+	t0 = Sys_DoubleTime ();
+	for (j = 0; j < passes; j++)
+	{
+		for (i = 0; i < VECBENCH_COUNT; i++)
+			AngleVectorsScalar (a[i], f1[i], r1[i], u1[i]);
+	}
+	t1 = Sys_DoubleTime ();
+	for (j = 0; j < passes; j++)
+	{
+		for (i = 0; i < VECBENCH_COUNT; i++)
+			AngleVectors (a[i], f2[i], r2[i], u2[i]);
+	}
+	t2 = Sys_DoubleTime ();
+
+	mismatch = 0;
+	for (i = 0; i < VECBENCH_COUNT; i++)
+	{
+		if (memcmp (f1[i], f2[i], sizeof(vec3_t)) || memcmp (r1[i], r2[i], sizeof(vec3_t)) ||
+		    memcmp (u1[i], u2[i], sizeof(vec3_t)))
+			mismatch++;
+	}
+	Con_Printf ("makevectors:  scalar %7.2f ms, simd %7.2f ms, %i mismatches\n",
+			(t1 - t0) * 1000.0, (t2 - t1) * 1000.0, mismatch);
+}
+
+
 /*
 ============
 PR_RunError
@@ -403,37 +530,27 @@ void PR_ExecuteProgram (func_t fnum)
 		OPC->_float = OPA->_float + OPB->_float;
 		break;
 	case OP_ADD_V:
-		OPC->vector[0] = OPA->vector[0] + OPB->vector[0];
-		OPC->vector[1] = OPA->vector[1] + OPB->vector[1];
-		OPC->vector[2] = OPA->vector[2] + OPB->vector[2];
+		SIMD_VectorAdd (OPA->vector, OPB->vector, OPC->vector);
 		break;
 
 	case OP_SUB_F:
 		OPC->_float = OPA->_float - OPB->_float;
 		break;
 	case OP_SUB_V:
-		OPC->vector[0] = OPA->vector[0] - OPB->vector[0];
-		OPC->vector[1] = OPA->vector[1] - OPB->vector[1];
-		OPC->vector[2] = OPA->vector[2] - OPB->vector[2];
+		SIMD_VectorSubtract (OPA->vector, OPB->vector, OPC->vector);
 		break;
 
 	case OP_MUL_F:
 		OPC->_float = OPA->_float * OPB->_float;
 		break;
 	case OP_MUL_V:
-		OPC->_float = OPA->vector[0] * OPB->vector[0] +
-			      OPA->vector[1] * OPB->vector[1] +
-			      OPA->vector[2] * OPB->vector[2];
+		OPC->_float = SIMD_DotProduct (OPA->vector, OPB->vector);
 		break;
 	case OP_MUL_FV:
-		OPC->vector[0] = OPA->_float * OPB->vector[0];
-		OPC->vector[1] = OPA->_float * OPB->vector[1];
-		OPC->vector[2] = OPA->_float * OPB->vector[2];
+		SIMD_VectorScale (OPB->vector, OPA->_float, OPC->vector);
 		break;
 	case OP_MUL_VF:
-		OPC->vector[0] = OPB->_float * OPA->vector[0];
-		OPC->vector[1] = OPB->_float * OPA->vector[1];
-		OPC->vector[2] = OPB->_float * OPA->vector[2];
+		SIMD_VectorScale (OPA->vector, OPB->_float, OPC->vector);
 		break;
 
 	case OP_DIV_F:
@@ -535,16 +652,27 @@ void PR_ExecuteProgram (func_t fnum)
 	case OP_STOREP_F:
 	case OP_STOREP_ENT:
 	case OP_STOREP_FLD:	// integers
-	case OP_STOREP_S:
 	case OP_STOREP_FNC:	// pointers
 		ptr = (eval_t *)((byte *)sv.edicts + OPB->_int);
 		ptr->_int = OPA->_int;
+		if (ed_hot.count)
+			ED_HotDirtyOfs (OPB->_int);
+		break;
+	case OP_STOREP_S:
+		ptr = (eval_t *)((byte *)sv.edicts + OPB->_int);
+		ptr->_int = OPA->_int;
+		// keep the classname index behind find() current
+		if (OPB->_int % pr_edict_size == (int)offsetof(edict_t, v.classname))
+			ED_UpdateClassIndex ((edict_t *)((byte *)ptr - offsetof(edict_t, v.classname)));
 		break;
 	case OP_STOREP_V:
 		ptr = (eval_t *)((byte *)sv.edicts + OPB->_int);
 		ptr->vector[0] = OPA->vector[0];
 		ptr->vector[1] = OPA->vector[1];
 		ptr->vector[2] = OPA->vector[2];
+		// a moved edict owes its water check even when it sleeps
+		if (ed_hot.count && OPB->_int % pr_edict_size == (int)offsetof(edict_t, v.origin))
+			ED_HotDirtyOfs (OPB->_int);
 		break;
 
 	case OP_ADDRESS:
@@ -614,11 +742,12 @@ void PR_ExecuteProgram (func_t fnum)
 			PR_RunError("NULL function");
 		newf = &pr_functions[OPA->function];
 		if (newf->first_statement < 0)
-		{ // Built-in function
-			int i = -newf->first_statement;
-			if (i >= pr_numbuiltins)
-				PR_RunError("Bad builtin call number %d", i);
-			pr_builtins[i]();
+		{ // Built-in function, resolved by PR_BindBuiltins
+			prcall_t *call = &pr_funccalls[OPA->function];
+			if (call->thunk)
+				call->thunk (call->func);
+			else
+				call->func ();
 			break;
 		}
 		// Normal function
@@ -647,6 +776,7 @@ void PR_ExecuteProgram (func_t fnum)
 		ed->v.nextthink = pr_global_struct->time + 0.1;
 		ed->v.frame = OPA->_float;
 		ed->v.think = OPB->function;
+		ED_HotDirty (ed);
 		break;
 
 	default:
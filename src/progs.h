@@ -40,7 +40,8 @@ typedef union eval_s
 typedef struct edict_s
 {
 	qboolean	free;
-	link_t		area;			/* linked to a division node or leaf */
+	struct areanode_s	*areanode;	/* area node it is linked in, NULL if none */
+	int		areaslot;		/* its entry in that node's list */
 
 	int		num_leafs;
 	int		leafnums[MAX_ENT_LEAFS];
@@ -53,13 +54,13 @@ typedef struct edict_s
 	float		oldthinktime;
 
 	float		freetime;		/* sv.time when the object was freed */
+	int		freeprev, freenext;	/* free queue links, edict numbers (0 = none) */
+	int		classindex;		/* classname index list + 1 (0 = none, -1 = volatile) */
 	entvars_t	v;			/* C exported fields from progs */
 
 	/* other fields from progs come immediately after */
 } edict_t;
 
-#define	EDICT_FROM_AREA(l)	STRUCT_FROM_LINK(l,edict_t,area)
-
 //============================================================================
 
 extern	dprograms_t	*progs;
@@ -77,13 +78,65 @@ void PR_ExecuteProgram (func_t fnum);
 void PR_LoadProgs (void);
 
 const char *PR_GetString (int num);
+const char *PR_LookupString (int num);
 int PR_SetEngineString (const char *s);
 int PR_AllocString (int bufferlength, char **ptr);
+void PR_FreeString (int num);
 
 void PR_Profile_f (void);
+void PR_VectorBench_f (void);
 
 edict_t *ED_Alloc (void);
 void ED_Free (edict_t *ed);
+void ED_TrimFreeEdicts (void);
+void ED_RebuildFreeList (void);
+void ED_UpdateClassIndex (edict_t *ed);
+edict_t *ED_FindClassname (int start, const char *name);
+
+/* optional mirror of the fields the per-frame edict loops filter on,
+   indexed by edict number; only entries with valid set can be trusted */
+typedef struct
+{
+	float		time;
+	int		num;
+} thinkentry_t;
+
+typedef struct
+{
+	int		count;		/* 0 when the mirror is off */
+	byte		*valid;
+	byte		*free;
+	byte		*movetype;	/* 255 for out of range values */
+	int		*flags;
+	float		*nextthink;
+	float		*modelindex;
+
+	/* think scheduler */
+	unsigned int	*awake;		/* bitset: visit every frame */
+	unsigned int	*due;		/* bitset: think due this frame */
+	float		*queued;	/* nextthink of the live heap entry, 0 = none */
+	thinkentry_t	*heap;		/* min-heap on time */
+	int		heapsize, heapmax;
+} edicthot_t;
+
+extern	edicthot_t	ed_hot;
+
+void ED_HotInit (qboolean enable);
+qboolean ED_HotSleepable (int movetype, int flags);
+void ED_HotRefresh (edict_t *ed, int num);
+void ED_HotDirty (edict_t *ed);
+void ED_HotWakeDue (double time);
+int ED_HotNextActive (int num, int end);
+
+/* progs stores through an edict field pointer invalidate that edict */
+#define ED_HotDirtyOfs(ofs)	do { unsigned int hotnum_ = (unsigned int)(ofs) / (unsigned int)pr_edict_size; \
+				if (hotnum_ < (unsigned int)ed_hot.count) { ed_hot.valid[hotnum_] = false; \
+				ed_hot.awake[hotnum_ >> 5] |= 1u << (hotnum_ & 31); } } while (0)
+
+ddef_t *ED_FindField (const char *name);
+ddef_t *ED_FindGlobal (const char *name);
+ddef_t *ED_GlobalDefs (void);
+ddef_t *ED_FieldDefs (void);
 
 void ED_Print (edict_t *ed);
 void ED_Write (FILE *f, edict_t *ed);
@@ -94,6 +147,32 @@ const char *ED_ParseGlobals (const char *data);
 
 void ED_LoadFromFile (const char *data);
 
+/* binary savegames */
+typedef struct
+{
+	byte		*data;
+	int		cursize, maxsize;
+	int		readcount;
+} savebuf_t;
+
+void SaveBuf_Write (savebuf_t *b, const void *data, int len);
+void SaveBuf_WriteLong (savebuf_t *b, int c);
+void SaveBuf_WriteFloat (savebuf_t *b, float f);
+void SaveBuf_WriteString (savebuf_t *b, const char *s);
+const byte *SaveBuf_Read (savebuf_t *b, int len);
+int SaveBuf_ReadLong (savebuf_t *b);
+float SaveBuf_ReadFloat (savebuf_t *b);
+const char *SaveBuf_ReadString (savebuf_t *b);
+void SaveBuf_Free (savebuf_t *b);
+
+typedef struct savesnapshot_s savesnapshot_t;
+
+savesnapshot_t *ED_CreateSnapshot (void);
+void ED_WriteSnapshot (savesnapshot_t *snap, savebuf_t *b);
+void ED_FreeSnapshot (savesnapshot_t *snap);
+void ED_WriteBinary (savebuf_t *b);
+int ED_ReadBinary (savebuf_t *b);
+
 /*
 #define EDICT_NUM(n)		((edict_t *)(sv.edicts+ (n)*pr_edict_size))
 #define NUM_FOR_EDICT(e)	(((byte *)(e) - sv.edicts) / pr_edict_size)
@@ -125,6 +204,17 @@ typedef void (*builtin_t) (void);
 extern const builtin_t *pr_builtins;
 extern const int pr_numbuiltins;
 
+/* per progs function; typed builtins go through a thunk that decodes
+ * the parms for func, raw ones are called directly */
+typedef void (*prthunk_t) (builtin_t func);
+typedef struct {
+	prthunk_t	thunk;
+	builtin_t	func;
+} prcall_t;
+
+extern prcall_t *pr_funccalls;
+void PR_BindBuiltins (void);
+
 /* for 2021 re-release */
 typedef struct {
 	const char *name;
@@ -623,6 +623,7 @@ static PyObject *PyQ__sv_edict_richcmp(PyQ__sv_edict *a, PyQ__sv_edict *b, int o
             return -1; \
         } \
         edict->v.field = (float) d; \
+        ED_HotDirty(edict); \
         return 0; \
     }
 
@@ -648,6 +649,7 @@ static PyObject *PyQ__sv_edict_richcmp(PyQ__sv_edict *a, PyQ__sv_edict *b, int o
             return -1; \
         } \
         edict->v.field = (float) n; \
+        ED_HotDirty(edict); \
         return 0; \
     }
 
@@ -834,7 +836,24 @@ PyQ__sv_edict_VECTOR_SETTER(velocity)
 PyQ__sv_edict_VECTOR_SETTER(angles)
 PyQ__sv_edict_VECTOR_SETTER(avelocity)
 PyQ__sv_edict_VECTOR_SETTER(punchangle)
-PyQ__sv_edict_STRING_SETTER(classname)
+static int PyQ__sv_edict_setclassname(PyQ__sv_edict *self, PyObject *value, void *closure)
+{
+    edict_t *edict;
+    PyObject *bytes;
+    edict = PyQ__sv_edict_get(self);
+    if (!edict) {
+        return -1;
+    }
+    bytes = PyUnicode_AsUTF8String(value);
+    if (!bytes) {
+        return -1;
+    }
+    Q_strcpy(PyQ_string_storage[self->index].v.classname, PyBytes_AsString(bytes));
+    edict->v.classname = PR_SetEngineString(PyQ_string_storage[self->index].v.classname);
+    ED_UpdateClassIndex(edict);
+    Py_DECREF(bytes);
+    return 0;
+}
 PyQ__sv_edict_NUMBER_SETTER(frame)
 PyQ__sv_edict_NUMBER_SETTER(skin)
 PyQ__sv_edict_BITSET_SETTER(effects)
@@ -1105,6 +1124,7 @@ static PyObject *PyQ__sv_setmodel(PyObject *self, PyObject *args)
 
     edict->v.model = PR_SetEngineString(*cache);
     edict->v.modelindex = index;
+    ED_HotDirty(edict);
 
     Py_RETURN_NONE;
 }
@@ -170,6 +170,7 @@ extern	vec3_t		listener_up;
 
 extern	cvar_t		sndspeed;
 extern	cvar_t		snd_mixspeed;
+extern	cvar_t		snd_mixjobs;
 extern	cvar_t		snd_filterquality;
 extern	cvar_t		sfxvolume;
 extern	cvar_t		loadas8bit;
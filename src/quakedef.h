@@ -218,6 +218,7 @@ typedef struct
 
 #include "cmd.h"
 #include "crc.h"
+#include "jobs.h"
 
 #include "progs.h"
 #include "server.h"
@@ -316,6 +317,8 @@ void Host_Frame (float time);
 void Host_Quit_f (void);
 void Host_ClientCommands (const char *fmt, ...) FUNC_PRINTF(1,2);
 void Host_ShutdownServer (qboolean crash);
+void Host_AutosaveFrame (void);
+void Host_WaitAutosave (void);
 void Host_WriteConfiguration (void);
 void Host_Resetdemos (void);
 
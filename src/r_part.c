@@ -33,6 +33,7 @@ static int	ramp2[8] = {0x6f, 0x6e, 0x6d, 0x6c, 0x6b, 0x6a, 0x68, 0x66};
 static int	ramp3[8] = {0x6d, 0x6b, 6, 5, 4, 3};
 
 static particle_t	*active_particles, *free_particles, *particles;
+static particle_t	**moving_particles;	// the live ones, for CL_RunParticles
 
 static int	r_numparticles;
 
@@ -41,6 +42,7 @@ static float texturescalefactor; //johnfitz -- compensate for apparent size of d
 
 cvar_t	r_particles = {"r_particles","1", CVAR_ARCHIVE}; //johnfitz
 cvar_t	r_quadparticles = {"r_quadparticles","1", CVAR_ARCHIVE}; //johnfitz
+cvar_t	r_particlejobs = {"r_particlejobs","0", CVAR_ARCHIVE};
 
 /*
 ===============
@@ -165,10 +167,13 @@ void R_InitParticles (void)
 
 	particles = (particle_t *)
 			Hunk_AllocName (r_numparticles * sizeof(particle_t), "particles");
+	moving_particles = (particle_t **)
+			Hunk_AllocName (r_numparticles * sizeof(particle_t *), "particles");
 
 	Cvar_RegisterVariable (&r_particles); //johnfitz
 	Cvar_SetCallback (&r_particles, R_SetParticleTexture_f);
 	Cvar_RegisterVariable (&r_quadparticles); //johnfitz
+	Cvar_RegisterVariable (&r_particlejobs);
 
 	R_InitParticleTextures (); //johnfitz
 }
@@ -712,52 +717,35 @@ void R_RocketTrail (vec3_t start, vec3_t end, int type)
 	}
 }
 
+static struct
+{
+	float	time1, time2, time3, dvel, frametime, grav;
+} particlemove;
+
 /*
 ===============
-CL_RunParticles -- johnfitz -- all the particle behavior, separated from R_DrawParticles
+CL_MoveParticles
+
+Runs on the job pool with r_particlejobs 1; every particle only touches
+itself, so the order does not matter.
 ===============
 */
-void CL_RunParticles (void)
+static void CL_MoveParticles (jobctx_t *ctx, void *data, int first, int last)
 {
-	particle_t		*p, *kill;
-	int				i;
+	particle_t		*p;
+	int				i, j;
 	float			time1, time2, time3, dvel, frametime, grav;
-	extern	cvar_t	sv_gravity;
-
-	frametime = cl.time - cl.oldtime;
-	time3 = frametime * 15;
-	time2 = frametime * 10;
-	time1 = frametime * 5;
-	grav = frametime * sv_gravity.value * 0.05;
-	dvel = 4*frametime;
 
-	for ( ;; )
-	{
-		kill = active_particles;
-		if (kill && kill->die < cl.time)
-		{
-			active_particles = kill->next;
-			kill->next = free_particles;
-			free_particles = kill;
-			continue;
-		}
-		break;
-	}
+	frametime = particlemove.frametime;
+	time3 = particlemove.time3;
+	time2 = particlemove.time2;
+	time1 = particlemove.time1;
+	grav = particlemove.grav;
+	dvel = particlemove.dvel;
 
-	for (p=active_particles ; p ; p=p->next)
+	for (j = first ; j < last ; j++)
 	{
-		for ( ;; )
-		{
-			kill = p->next;
-			if (kill && kill->die < cl.time)
-			{
-				p->next = kill->next;
-				kill->next = free_particles;
-				free_particles = kill;
-				continue;
-			}
-			break;
-		}
+		p = moving_particles[j];
 
 		p->org[0] += p->vel[0]*frametime;
 		p->org[1] += p->vel[1]*frametime;
@@ -818,6 +806,66 @@ void CL_RunParticles (void)
 	}
 }
 
+/*
+===============
+CL_RunParticles -- johnfitz -- all the particle behavior, separated from R_DrawParticles
+===============
+*/
+void CL_RunParticles (void)
+{
+	particle_t		*p, *kill;
+	int				count;
+	float			frametime;
+	extern	cvar_t	sv_gravity;
+
+	frametime = cl.time - cl.oldtime;
+	particlemove.frametime = frametime;
+	particlemove.time3 = frametime * 15;
+	particlemove.time2 = frametime * 10;
+	particlemove.time1 = frametime * 5;
+	particlemove.grav = frametime * sv_gravity.value * 0.05;
+	particlemove.dvel = 4*frametime;
+
+	for ( ;; )
+	{
+		kill = active_particles;
+		if (kill && kill->die < cl.time)
+		{
+			active_particles = kill->next;
+			kill->next = free_particles;
+			free_particles = kill;
+			continue;
+		}
+		break;
+	}
+
+// the dead are culled before anything moves, so a particle moved to
+// die = -1 is only freed next frame, as before
+	count = 0;
+	for (p=active_particles ; p ; p=p->next)
+	{
+		for ( ;; )
+		{
+			kill = p->next;
+			if (kill && kill->die < cl.time)
+			{
+				p->next = kill->next;
+				kill->next = free_particles;
+				free_particles = kill;
+				continue;
+			}
+			break;
+		}
+
+		moving_particles[count++] = p;
+	}
+
+	if (r_particlejobs.value)
+		Jobs_Run ("particles", CL_MoveParticles, NULL, count, 512, 0);
+	else
+		CL_MoveParticles (NULL, NULL, 0, count);
+}
+
 /*
 ===============
 R_DrawParticles -- johnfitz -- moved all non-drawing code to CL_RunParticles
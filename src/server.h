@@ -61,6 +61,7 @@ typedef struct
 	const char	*lightstyles[MAX_LIGHTSTYLES];
 	int			num_edicts;
 	int			max_edicts;
+	int			free_head, free_tail;	// queue of free edicts, oldest first
 	edict_t		*edicts;			// can NOT be array indexed, because
 									// edict_t is variable sized, but can
 									// be used to reference the world ent
@@ -230,17 +231,52 @@ void SV_ClientPrintf (const char *fmt, ...) FUNC_PRINTF(1,2);
 void SV_BroadcastPrintf (const char *fmt, ...) FUNC_PRINTF(1,2);
 
 void SV_Physics (void);
+void SV_HotFieldBench_f (void);
+void SV_PhysStats_f (void);
 
 qboolean SV_CheckBottom (edict_t *ent);
 qboolean SV_movestep (edict_t *ent, vec3_t move, qboolean relink);
 
 void SV_WriteClientdataToMessage (edict_t *ent, sizebuf_t *msg);
 
+struct mleaf_s;
+void SV_ClearPVSCache (void);
+byte *SV_LeafPVS (struct mleaf_s *leaf);
+byte *SV_ClientFatPVS (edict_t *clent);
+
 void SV_MoveToGoal (void);
+void SV_WalkPathToGoal (void);
+
+// walkpathtogoal results
+#define	PATH_ERROR			0	// no path, the QC falls back to movetogoal
+#define	PATH_IN_PROGRESS	1
+#define	PATH_COMPLETE		2
 
+void SV_NavClear (void);
+void SV_NavSpawn (void);
+int SV_NavWaypoint (edict_t *ent, const vec3_t goal, float dist, vec3_t point);
+void SV_NavDropPath (edict_t *ent);
+void SV_NavStats_f (void);
+
+void SV_ConnectClient (int clientnum);
 void SV_CheckForNewClients (void);
 void SV_RunClients (void);
 void SV_SaveSpawnparms (void);
 void SV_SpawnServer (const char *server);
 
+/* lockstep state hashing and replay, see sv_lockstep.c */
+void SV_LockstepInit (void);
+int SV_Rand (void);
+void SV_LockstepStop (void);
+void SV_LockstepBeginSpawn (void);
+void SV_LockstepSpawned (void);
+void SV_LockstepBeginFrame (void);
+qboolean SV_LockstepPhysics (qboolean run);
+void SV_LockstepEndFrame (void);
+void SV_LockstepRecordConnect (int clientnum);
+void SV_LockstepRecordDrop (void);
+void SV_LockstepRecordCommand (const char *s);
+void SV_LockstepRecordMove (const vec3_t angles, const usercmd_t *move, int bits, int impulse);
+qboolean SV_LockstepReadClient (void);
+
 #endif	/* QUAKE_SERVER_H */
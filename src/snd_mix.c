@@ -330,13 +330,93 @@ CHANNEL MIXING
 ===============================================================================
 */
 
-static void SND_PaintChannelFrom8 (channel_t *ch, sfxcache_t *sc, int endtime, int paintbufferstart);
-static void SND_PaintChannelFrom16 (channel_t *ch, sfxcache_t *sc, int endtime, int paintbufferstart);
+static void SND_PaintChannelFrom8 (channel_t *ch, sfxcache_t *sc, int endtime, portable_samplepair_t *out);
+static void SND_PaintChannelFrom16 (channel_t *ch, sfxcache_t *sc, int endtime, portable_samplepair_t *out);
+
+/*
+===============
+SND_PaintChannel
+
+Paints ch from paintedtime up to end into out, which starts at paintedtime
+===============
+*/
+static void SND_PaintChannel (channel_t *ch, sfxcache_t *sc, int end, portable_samplepair_t *out)
+{
+	int		ltime, count;
+
+	ltime = paintedtime;
+
+	while (ltime < end)
+	{	// paint up to end
+		if (ch->end < end)
+			count = ch->end - ltime;
+		else
+			count = end - ltime;
+
+		if (count > 0)
+		{
+			if (sc->width == 1)
+				SND_PaintChannelFrom8(ch, sc, count, out + ltime - paintedtime);
+			else
+				SND_PaintChannelFrom16(ch, sc, count, out + ltime - paintedtime);
+
+			ltime += count;
+		}
+
+	// if at end of loop, restart
+		if (ltime >= ch->end)
+		{
+			if (sc->loopstart >= 0)
+			{
+				ch->pos = sc->loopstart;
+				ch->end = ltime + sc->length - ch->pos;
+			}
+			else
+			{	// channel just stopped
+				ch->sfx = NULL;
+				break;
+			}
+		}
+	}
+}
+
+/*
+With snd_mixjobs 1 the channels of each paintbuffer chunk are painted on
+the job pool, every worker into a buffer of its own, and the buffers are
+added up afterwards.  The samples are integers, so the sum is the same
+as painting one channel after another.  Sounds are still loaded here.
+*/
+typedef struct
+{
+	channel_t	*ch;
+	sfxcache_t	*sc;
+} mixchannel_t;
+
+static mixchannel_t	mixchannels[MAX_CHANNELS];
+static portable_samplepair_t	*mixbuffers[MAX_JOBWORKERS];
+static int	mixend;
+
+static void SND_MixChannels (jobctx_t *ctx, void *data, int first, int last)
+{
+	portable_samplepair_t	*out;
+	int		i, size;
+
+	out = mixbuffers[ctx->worker];
+	if (!out)
+	{
+		size = (mixend - paintedtime) * sizeof(portable_samplepair_t);
+		out = mixbuffers[ctx->worker] = (portable_samplepair_t *) Jobs_Alloc (ctx, size);
+		memset (out, 0, size);
+	}
+
+	for (i = first; i < last; i++)
+		SND_PaintChannel (mixchannels[i].ch, mixchannels[i].sc, mixend, out);
+}
 
 void S_PaintChannels (int endtime)
 {
-	int		i;
-	int		end, ltime, count;
+	int		i, j;
+	int		end, count;
 	channel_t	*ch;
 	sfxcache_t	*sc;
 
@@ -354,6 +434,7 @@ void S_PaintChannels (int endtime)
 
 	// paint in the channels.
 		ch = snd_channels;
+		count = 0;
 		for (i = 0; i < total_channels; i++, ch++)
 		{
 			if (!ch->sfx)
@@ -364,40 +445,29 @@ void S_PaintChannels (int endtime)
 			if (!sc)
 				continue;
 
-			ltime = paintedtime;
-
-			while (ltime < end)
-			{	// paint up to end
-				if (ch->end < end)
-					count = ch->end - ltime;
-				else
-					count = end - ltime;
-
-				if (count > 0)
-				{
-					// the last param to SND_PaintChannelFrom is the index
-					// to start painting to in the paintbuffer, usually 0.
-					if (sc->width == 1)
-						SND_PaintChannelFrom8(ch, sc, count, ltime - paintedtime);
-					else
-						SND_PaintChannelFrom16(ch, sc, count, ltime - paintedtime);
-
-					ltime += count;
-				}
+			if (!snd_mixjobs.value)
+			{
+				SND_PaintChannel (ch, sc, end, paintbuffer);
+				continue;
+			}
+			mixchannels[count].ch = ch;
+			mixchannels[count].sc = sc;
+			count++;
+		}
 
-			// if at end of loop, restart
-				if (ltime >= ch->end)
+		if (count)
+		{
+			memset (mixbuffers, 0, sizeof(mixbuffers));
+			mixend = end;
+			Jobs_Run ("mix", SND_MixChannels, NULL, count, 8, (end - paintedtime) * sizeof(portable_samplepair_t));
+			for (j = 0; j < MAX_JOBWORKERS; j++)
+			{
+				if (!mixbuffers[j])
+					continue;
+				for (i = 0; i < end - paintedtime; i++)
 				{
-					if (sc->loopstart >= 0)
-					{
-						ch->pos = sc->loopstart;
-						ch->end = ltime + sc->length - ch->pos;
-					}
-					else
-					{	// channel just stopped
-						ch->sfx = NULL;
-						break;
-					}
+					paintbuffer[i].left += mixbuffers[j][i].left;
+					paintbuffer[i].right += mixbuffers[j][i].right;
 				}
 			}
 		}
@@ -469,7 +539,7 @@ void SND_InitScaletable (void)
 }
 
 
-static void SND_PaintChannelFrom8 (channel_t *ch, sfxcache_t *sc, int count, int paintbufferstart)
+static void SND_PaintChannelFrom8 (channel_t *ch, sfxcache_t *sc, int count, portable_samplepair_t *out)
 {
 	int	data;
 	int		*lscale, *rscale;
@@ -488,14 +558,14 @@ static void SND_PaintChannelFrom8 (channel_t *ch, sfxcache_t *sc, int count, int
 	for (i = 0; i < count; i++)
 	{
 		data = sfx[i];
-		paintbuffer[paintbufferstart + i].left += lscale[data];
-		paintbuffer[paintbufferstart + i].right += rscale[data];
+		out[i].left += lscale[data];
+		out[i].right += rscale[data];
 	}
 
 	ch->pos += count;
 }
 
-static void SND_PaintChannelFrom16 (channel_t *ch, sfxcache_t *sc, int count, int paintbufferstart)
+static void SND_PaintChannelFrom16 (channel_t *ch, sfxcache_t *sc, int count, portable_samplepair_t *out)
 {
 	int	data;
 	int	left, right;
@@ -518,8 +588,8 @@ static void SND_PaintChannelFrom16 (channel_t *ch, sfxcache_t *sc, int count, in
 	//	right = (data * rightvol) >> 8;
 		left = data * leftvol;
 		right = data * rightvol;
-		paintbuffer[paintbufferstart + i].left += left;
-		paintbuffer[paintbufferstart + i].right += right;
+		out[i].left += left;
+		out[i].right += right;
 	}
 
 	ch->pos += count;
@@ -0,0 +1,890 @@
+/*
+Copyright (C) 1996-2001 Id Software, Inc.
+Copyright (C) 2002-2009 John Fitzgibbons and others
+Copyright (C) 2010-2014 QuakeSpasm developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// sv_lockstep.c -- simulation state hashing, input recording and replay
+
+#include "quakedef.h"
+
+/*
+A lockstep file is plain text, one record per line.  The header pins down
+everything the simulation depends on besides client input:
+
+	lockstep <version>
+	map <name>
+	maxclients <n>
+	cvars <skill> <deathmatch> <coop> <teamplay>
+	seed <n>
+	progs <crc>
+	fields [<name> ...]
+
+Then for every server frame, the client input in the order the server
+consumed it, followed by a frame record holding the state hash taken
+after the frame has run:
+
+	connect <client>
+	drop <client>
+	cmd <client> <string command>
+	move <client> <pitch> <yaw> <roll> <forward> <side> <up> <buttons> <impulse>
+	frame <n> <frametime> <physics> <hash>
+
+A replay runs on a dedicated server: recorded clients are brought in as
+connectionless slots fed from the file, the recorded frame times and
+physics decisions are forced, and each frame hash is compared against
+the recording.
+*/
+
+#define LOCKSTEP_VERSION	2
+#define LOCKSTEP_MAXLINE	2048
+
+#define FNV64_BASIS		0xcbf29ce484222325ULL
+#define FNV64_PRIME		0x100000001b3ULL
+
+typedef enum
+{
+	LS_OFF,
+	LS_RECORD,
+	LS_REPLAY
+} lsmode_t;
+
+typedef struct
+{
+	int		ofs;
+	int		type;
+} hashdef_t;
+
+cvar_t	sv_statehash_fields = {"sv_statehash_fields", "", CVAR_NONE};
+
+static lsmode_t		ls_mode;		// run in progress
+static lsmode_t		ls_pending;		// run starting with the next map
+static char			ls_path[MAX_OSPATH];
+static char			ls_fields[LOCKSTEP_MAXLINE];
+static unsigned int	ls_seed;
+static unsigned int	ls_rand;
+static int			ls_frame;
+static int			ls_mismatches;
+static qboolean		ls_quit;
+
+static FILE			*ls_file;		// recording
+static char			*ls_data;		// replay, the whole file
+static const char	*ls_cursor;
+static int			ls_progscrc;
+
+// replay: the frame record the current server frame is heading for
+static double		ls_frametime;
+static int			ls_physics;
+static uint64_t		ls_expected;
+
+static hashdef_t	*ls_globaldefs;
+static int			ls_numglobaldefs;
+static hashdef_t	*ls_fielddefs;
+static int			ls_numfielddefs;
+
+/*
+===============================================================================
+
+STATE HASH
+
+===============================================================================
+*/
+
+/*
+=============
+SV_HashableDef
+
+Vector components are covered by their vector def, pointers and voids
+carry nothing worth comparing.
+=============
+*/
+static qboolean SV_HashableDef (ddef_t *d, qboolean components)
+{
+	const char	*name;
+	size_t		l;
+
+	switch (d->type & ~DEF_SAVEGLOBAL)
+	{
+	case ev_string:
+	case ev_float:
+	case ev_vector:
+	case ev_entity:
+	case ev_field:
+	case ev_function:
+		break;
+	default:
+		return false;
+	}
+
+	if (components)
+		return true;
+	name = PR_GetString (d->s_name);
+	l = strlen (name);
+	return !(l > 1 && name[l - 2] == '_');
+}
+
+/*
+=============
+SV_BuildHashDefs
+
+Collects the globals and the entity fields that make up the state hash.
+An empty subset hashes every field.
+=============
+*/
+static void SV_BuildHashDefs (const char *subset)
+{
+	ddef_t	*globaldefs, *fielddefs, *d;
+	int		i;
+
+	globaldefs = ED_GlobalDefs ();
+	fielddefs = ED_FieldDefs ();
+
+	free (ls_globaldefs);
+	free (ls_fielddefs);
+	ls_globaldefs = (hashdef_t *) malloc (progs->numglobaldefs * sizeof(hashdef_t));
+	ls_fielddefs = (hashdef_t *) malloc (progs->numfielddefs * sizeof(hashdef_t));
+	if (!ls_globaldefs || !ls_fielddefs)
+		Sys_Error ("SV_BuildHashDefs: out of memory");
+	ls_numglobaldefs = 0;
+	ls_numfielddefs = 0;
+
+	for (i = 0; i < progs->numglobaldefs; i++)
+	{
+		d = &globaldefs[i];
+		if (!SV_HashableDef (d, false))
+			continue;
+		ls_globaldefs[ls_numglobaldefs].ofs = d->ofs;
+		ls_globaldefs[ls_numglobaldefs].type = d->type & ~DEF_SAVEGLOBAL;
+		ls_numglobaldefs++;
+	}
+
+	if (!*subset)
+	{
+		for (i = 1; i < progs->numfielddefs; i++)
+		{
+			d = &fielddefs[i];
+			if (!SV_HashableDef (d, false))
+				continue;
+			ls_fielddefs[ls_numfielddefs].ofs = d->ofs;
+			ls_fielddefs[ls_numfielddefs].type = d->type;
+			ls_numfielddefs++;
+		}
+		return;
+	}
+
+	while ((subset = COM_Parse (subset)) != NULL && com_token[0])
+	{
+		d = ED_FindField (com_token);
+		if (!d || !SV_HashableDef (d, true))
+		{
+			Con_Printf ("sv_statehash_fields: no field \"%s\"\n", com_token);
+			continue;
+		}
+		if (ls_numfielddefs == progs->numfielddefs)
+			break;
+		ls_fielddefs[ls_numfielddefs].ofs = d->ofs;
+		ls_fielddefs[ls_numfielddefs].type = d->type;
+		ls_numfielddefs++;
+	}
+}
+
+/*
+=============
+SV_HashDefs
+
+Strings are hashed by content since string_t values handed out by the
+engine depend on allocation order, and entities by edict number since
+their byte offsets change with the size of edict_t.  Everything else is
+hashed by its raw bits.
+=============
+*/
+static uint64_t SV_HashDefs (uint64_t h, const int *base, const hashdef_t *defs, int numdefs)
+{
+	const int	*v;
+	const char	*s;
+	int			i, j, n;
+
+	for (i = 0; i < numdefs; i++)
+	{
+		v = base + defs[i].ofs;
+		if (defs[i].type == ev_string && (s = PR_LookupString (*v)) != NULL)
+		{
+			do
+				h = (h ^ (byte)*s) * FNV64_PRIME;
+			while (*s++);
+			continue;
+		}
+		if (defs[i].type == ev_entity)
+		{
+			h = (h ^ (uint32_t)(*v / pr_edict_size)) * FNV64_PRIME;
+			continue;
+		}
+		n = (defs[i].type == ev_vector) ? 3 : 1;
+		for (j = 0; j < n; j++)
+			h = (h ^ (uint32_t)v[j]) * FNV64_PRIME;
+	}
+
+	return h;
+}
+
+/*
+=============
+SV_StateHash
+
+Hash of the QuakeC globals and every live edict.
+=============
+*/
+static uint64_t SV_StateHash (void)
+{
+	edict_t		*ed;
+	uint64_t	h;
+	int			i;
+
+	h = SV_HashDefs (FNV64_BASIS, (int *)pr_globals, ls_globaldefs, ls_numglobaldefs);
+	for (i = 0; i < sv.num_edicts; i++)
+	{
+		ed = EDICT_NUM(i);
+		if (ed->free)
+			continue;
+		h = (h ^ (uint32_t)i) * FNV64_PRIME;
+		h = SV_HashDefs (h, (int *)&ed->v, ls_fielddefs, ls_numfielddefs);
+	}
+
+	return h;
+}
+
+/*
+=============
+SV_Rand
+
+rand() for the server side of the game.  While a lockstep run is going
+this is a private generator seeded from the file, so nothing else that
+calls rand() (the client, the renderer) can disturb the simulation.
+=============
+*/
+int SV_Rand (void)
+{
+	if (ls_mode == LS_OFF)
+		return rand ();
+
+	ls_rand = ls_rand * 1103515245 + 12345;
+	return (ls_rand >> 16) & 0x7fff;
+}
+
+/*
+===============================================================================
+
+RECORD / REPLAY
+
+===============================================================================
+*/
+
+/*
+=============
+SV_LockstepPeek
+
+Copies the current replay line, without advancing past it.
+=============
+*/
+static qboolean SV_LockstepPeek (char *line, size_t size)
+{
+	const char	*end;
+	size_t		len;
+
+	while (*ls_cursor == '\n' || *ls_cursor == '\r')
+		ls_cursor++;
+	if (!*ls_cursor)
+	{
+		line[0] = 0;
+		return false;
+	}
+
+	end = strchr (ls_cursor, '\n');
+	if (!end)
+		end = ls_cursor + strlen (ls_cursor);
+	if (end > ls_cursor && end[-1] == '\r')
+		end--;
+	len = q_min ((size_t)(end - ls_cursor), size - 1);
+	memcpy (line, ls_cursor, len);
+	line[len] = 0;
+	return true;
+}
+
+static void SV_LockstepNext (void)
+{
+	const char	*end;
+
+	end = strchr (ls_cursor, '\n');
+	ls_cursor = end ? end + 1 : ls_cursor + strlen (ls_cursor);
+}
+
+/*
+=============
+SV_LockstepHeader
+
+Reads the header line starting with key, returns the rest of it.
+=============
+*/
+static qboolean SV_LockstepHeader (const char *key, char *value, size_t size)
+{
+	char	line[LOCKSTEP_MAXLINE];
+	size_t	len;
+
+	len = strlen (key);
+	if (!SV_LockstepPeek (line, sizeof(line)) || strncmp (line, key, len)
+		|| (line[len] && line[len] != ' '))
+		return false;
+	SV_LockstepNext ();
+	q_strlcpy (value, line[len] ? line + len + 1 : "", size);
+	return true;
+}
+
+/*
+=============
+SV_LockstepFindFrame
+
+Looks ahead for the frame record ending the current frame.
+=============
+*/
+static qboolean SV_LockstepFindFrame (void)
+{
+	const char		*start;
+	char			line[LOCKSTEP_MAXLINE];
+	unsigned int	hi, lo;
+	int				frame;
+	qboolean		found;
+
+	start = ls_cursor;
+	found = false;
+	while (SV_LockstepPeek (line, sizeof(line)))
+	{
+		if (sscanf (line, "frame %d %lf %d %8x%8x", &frame, &ls_frametime, &ls_physics, &hi, &lo) == 5)
+		{
+			ls_expected = ((uint64_t)hi << 32) | lo;
+			found = true;
+			break;
+		}
+		SV_LockstepNext ();
+	}
+	ls_cursor = start;
+
+	return found;
+}
+
+/*
+=============
+SV_LockstepStop
+
+Ends the run in progress.  Replay clients are dropped without running
+ClientDisconnect, the comparison is over by then.
+=============
+*/
+void SV_LockstepStop (void)
+{
+	client_t	*save;
+	int			i;
+
+	switch (ls_mode)
+	{
+	case LS_RECORD:
+		if (ls_file)
+		{
+			fclose (ls_file);
+			ls_file = NULL;
+			Con_Printf ("Recorded %d frames to %s.\n", ls_frame, ls_path);
+		}
+		break;
+
+	case LS_REPLAY:
+		if (ls_mismatches)
+			Con_Printf ("Lockstep replay: %d of %d frames mismatched.\n", ls_mismatches, ls_frame);
+		else
+			Con_Printf ("Lockstep replay: %d frames matched.\n", ls_frame);
+		free (ls_data);
+		ls_data = NULL;
+
+		save = host_client;
+		for (i = 0, host_client = svs.clients; i < svs.maxclients; i++, host_client++)
+		{
+			if (host_client->active && !host_client->netconnection)
+				SV_DropClient (true);
+		}
+		host_client = save;
+
+		if (ls_quit)
+			Cbuf_AddText ("quit\n");
+		break;
+
+	default:
+		break;
+	}
+
+	ls_mode = LS_OFF;
+}
+
+/*
+=============
+SV_LockstepBeginSpawn
+
+Called as a new map starts; a pending run takes over from here so that
+entity spawning already draws from the run's random seed.
+=============
+*/
+void SV_LockstepBeginSpawn (void)
+{
+	SV_LockstepStop ();		// a level change ends the run
+
+	if (ls_pending == LS_OFF)
+		return;
+	ls_mode = ls_pending;
+	ls_pending = LS_OFF;
+	ls_rand = ls_seed;
+}
+
+/*
+=============
+SV_LockstepSpawned
+
+Called once the map is fully spawned, before any client is read.
+=============
+*/
+void SV_LockstepSpawned (void)
+{
+	if (ls_mode == LS_OFF)
+		return;
+
+	SV_BuildHashDefs (ls_fields);
+	ls_frame = 0;
+	ls_mismatches = 0;
+
+	if (ls_mode == LS_REPLAY)
+	{
+		if (ls_progscrc != pr_crc)
+		{
+			Con_Printf ("Lockstep replay: progs crc %d, recording used %d\n", pr_crc, ls_progscrc);
+			SV_LockstepStop ();
+			return;
+		}
+		Con_Printf ("Replaying %s\n", ls_path);
+		return;
+	}
+
+	ls_file = fopen (ls_path, "w");
+	if (!ls_file)
+	{
+		Con_Printf ("ERROR: couldn't open %s.\n", ls_path);
+		ls_mode = LS_OFF;
+		return;
+	}
+	fprintf (ls_file, "lockstep %d\n", LOCKSTEP_VERSION);
+	fprintf (ls_file, "map %s\n", sv.name);
+	fprintf (ls_file, "maxclients %d\n", svs.maxclients);
+	fprintf (ls_file, "cvars %s %s %s %s\n", skill.string, deathmatch.string, coop.string, teamplay.string);
+	fprintf (ls_file, "seed %u\n", ls_seed);
+	fprintf (ls_file, "progs %d\n", pr_crc);
+	fprintf (ls_file, "fields %s\n", ls_fields);
+	Con_Printf ("Recording lockstep to %s\n", ls_path);
+}
+
+/*
+=============
+SV_LockstepConnect
+
+Brings a recorded client in as a slot without a net connection.
+=============
+*/
+static void SV_LockstepConnect (int clientnum)
+{
+	if (clientnum < 0 || clientnum >= svs.maxclients || svs.clients[clientnum].active)
+	{
+		Con_Printf ("Lockstep replay: can't connect client %d at frame %d\n", clientnum, ls_frame);
+		SV_LockstepStop ();
+		return;
+	}
+
+	svs.clients[clientnum].netconnection = NULL;
+	SV_ConnectClient (clientnum);
+	net_activeconnections++;
+}
+
+/*
+=============
+SV_LockstepBeginFrame
+
+Replay: connects the clients that joined this frame and forces the
+recorded frame time.
+=============
+*/
+void SV_LockstepBeginFrame (void)
+{
+	char	line[LOCKSTEP_MAXLINE];
+	int		clientnum;
+
+	if (ls_mode != LS_REPLAY)
+		return;
+
+	while (SV_LockstepPeek (line, sizeof(line)) && sscanf (line, "connect %d", &clientnum) == 1)
+	{
+		SV_LockstepNext ();
+		SV_LockstepConnect (clientnum);
+		if (ls_mode != LS_REPLAY)
+			return;
+	}
+
+	if (!SV_LockstepFindFrame ())
+	{
+		SV_LockstepStop ();		// end of the recording
+		return;
+	}
+	host_frametime = ls_frametime;
+}
+
+/*
+=============
+SV_LockstepPhysics
+
+Whether SV_Physics runs this frame: recorded as decided, or forced
+from the recording.
+=============
+*/
+qboolean SV_LockstepPhysics (qboolean run)
+{
+	if (ls_mode == LS_REPLAY)
+		return ls_physics != 0;
+
+	ls_physics = run;
+	return run;
+}
+
+/*
+=============
+SV_LockstepEndFrame
+=============
+*/
+void SV_LockstepEndFrame (void)
+{
+	char		line[LOCKSTEP_MAXLINE];
+	uint64_t	hash;
+
+	if (ls_mode == LS_OFF)
+		return;
+
+	hash = SV_StateHash ();
+
+	if (ls_mode == LS_RECORD)
+	{
+		fprintf (ls_file, "frame %d %.17g %d %08x%08x\n", ls_frame, host_frametime, ls_physics,
+				(unsigned int)(hash >> 32), (unsigned int)hash);
+		ls_frame++;
+		return;
+	}
+
+	// everything the recording consumed this frame must be gone by now
+	if (!SV_LockstepPeek (line, sizeof(line)) || strncmp (line, "frame ", 6))
+	{
+		Con_Printf ("Lockstep replay: input left over at frame %d: %s\n", ls_frame, line);
+		SV_LockstepStop ();
+		return;
+	}
+	SV_LockstepNext ();
+
+	if (hash != ls_expected)
+	{
+		if (!ls_mismatches)
+			Con_Printf ("Lockstep replay: first mismatch at frame %d, state hash %08x%08x, expected %08x%08x\n",
+					ls_frame, (unsigned int)(hash >> 32), (unsigned int)hash,
+					(unsigned int)(ls_expected >> 32), (unsigned int)ls_expected);
+		ls_mismatches++;
+	}
+	ls_frame++;
+}
+
+/*
+=============
+SV_LockstepRecordConnect
+=============
+*/
+void SV_LockstepRecordConnect (int clientnum)
+{
+	if (ls_file)
+		fprintf (ls_file, "connect %d\n", clientnum);
+}
+
+/*
+=============
+SV_LockstepRecordDrop
+=============
+*/
+void SV_LockstepRecordDrop (void)
+{
+	if (ls_file)
+		fprintf (ls_file, "drop %d\n", (int)(host_client - svs.clients));
+}
+
+/*
+=============
+SV_LockstepRecordCommand
+
+Line breaks become spaces, they only ever separate commands.
+=============
+*/
+void SV_LockstepRecordCommand (const char *s)
+{
+	if (!ls_file)
+		return;
+
+	fprintf (ls_file, "cmd %d ", (int)(host_client - svs.clients));
+	for ( ; *s; s++)
+		fputc ((*s == '\n' || *s == '\r') ? ' ' : *s, ls_file);
+	fputc ('\n', ls_file);
+}
+
+/*
+=============
+SV_LockstepRecordMove
+=============
+*/
+void SV_LockstepRecordMove (const vec3_t angles, const usercmd_t *move, int bits, int impulse)
+{
+	if (!ls_file)
+		return;
+
+	fprintf (ls_file, "move %d %.9g %.9g %.9g %.9g %.9g %.9g %d %d\n", (int)(host_client - svs.clients),
+			angles[0], angles[1], angles[2], move->forwardmove, move->sidemove, move->upmove, bits, impulse);
+}
+
+/*
+=============
+SV_LockstepReadClient
+
+Stands in for SV_ReadClientMessage on replay clients, applying what
+the recorded client sent this frame exactly the way the network path
+would have.  Returns false if the client should be dropped.
+=============
+*/
+qboolean SV_LockstepReadClient (void)
+{
+	char		line[LOCKSTEP_MAXLINE];
+	char		word[16];
+	vec3_t		angles;
+	usercmd_t	move;
+	int			clientnum, c, n, bits, impulse;
+
+	if (ls_mode != LS_REPLAY)
+		return true;
+
+	clientnum = host_client - svs.clients;
+	while (SV_LockstepPeek (line, sizeof(line)))
+	{
+		if (sscanf (line, "%15s %d%n", word, &c, &n) != 2 || c != clientnum)
+			break;
+
+		if (!strcmp (word, "drop"))
+		{
+			SV_LockstepNext ();
+			return false;
+		}
+		else if (!strcmp (word, "cmd"))
+		{
+			SV_LockstepNext ();
+			Cmd_ExecuteString (line[n] ? line + n + 1 : "", src_client);
+			if (!host_client->active)
+				return false;	// a command caused an error
+		}
+		else if (!strcmp (word, "move"))
+		{
+			if (sscanf (line + n, "%f %f %f %f %f %f %d %d", &angles[0], &angles[1], &angles[2],
+					&move.forwardmove, &move.sidemove, &move.upmove, &bits, &impulse) != 8)
+				break;
+			SV_LockstepNext ();
+
+			VectorCopy (angles, host_client->edict->v.v_angle);
+			host_client->cmd.forwardmove = move.forwardmove;
+			host_client->cmd.sidemove = move.sidemove;
+			host_client->cmd.upmove = move.upmove;
+			host_client->edict->v.button0 = bits & 1;
+			host_client->edict->v.button2 = (bits & 2)>>1;
+			if (impulse)
+				host_client->edict->v.impulse = impulse;
+		}
+		else
+			break;
+	}
+
+	return true;
+}
+
+/*
+=============
+SV_LockstepRecord_f
+=============
+*/
+static void SV_LockstepRecord_f (void)
+{
+	char	map[MAX_QPATH];
+
+	if (Cmd_Argc () != 2 && Cmd_Argc () != 3)
+	{
+		Con_Printf ("statehash_record <file> [map] : record input and state hashes from a fresh map start\n");
+		return;
+	}
+	if (Cmd_Argc () == 3)
+		q_strlcpy (map, Cmd_Argv (2), sizeof(map));
+	else if (sv.active)
+		q_strlcpy (map, sv.name, sizeof(map));
+	else
+	{
+		Con_Printf ("No map running, name one to record on.\n");
+		return;
+	}
+	if (strstr (Cmd_Argv (1), ".."))
+	{
+		Con_Printf ("Relative pathnames are not allowed.\n");
+		return;
+	}
+
+	SV_LockstepStop ();
+	free (ls_data);
+	ls_data = NULL;
+
+	q_snprintf (ls_path, sizeof(ls_path), "%s/%s", com_gamedir, Cmd_Argv (1));
+	COM_AddExtension (ls_path, ".lockstep", sizeof(ls_path));
+	q_strlcpy (ls_fields, sv_statehash_fields.string, sizeof(ls_fields));
+	ls_seed = (unsigned int)(Sys_DoubleTime () * 1000.0) ^ (unsigned int)rand ();
+	ls_pending = LS_RECORD;
+
+	Cbuf_AddText (va ("map %s\n", map));
+}
+
+/*
+=============
+SV_LockstepCompare_f
+=============
+*/
+static void SV_LockstepCompare_f (void)
+{
+	char	value[LOCKSTEP_MAXLINE];
+	char	map[MAX_QPATH];
+	char	cvars[4][32];
+	int		version, maxclients;
+
+	if (Cmd_Argc () != 2 && Cmd_Argc () != 3)
+	{
+		Con_Printf ("statehash_compare <file> [quit] : replay a recording and compare state hashes\n");
+		return;
+	}
+	if (cls.state != ca_dedicated)
+	{
+		Con_Printf ("Lockstep replays need a dedicated server.\n");
+		return;
+	}
+	if (strstr (Cmd_Argv (1), ".."))
+	{
+		Con_Printf ("Relative pathnames are not allowed.\n");
+		return;
+	}
+
+	SV_LockstepStop ();
+	ls_pending = LS_OFF;
+	free (ls_data);
+
+	q_snprintf (ls_path, sizeof(ls_path), "%s/%s", com_gamedir, Cmd_Argv (1));
+	COM_AddExtension (ls_path, ".lockstep", sizeof(ls_path));
+	ls_data = (char *) COM_LoadMallocFile_TextMode_OSPath (ls_path, NULL);
+	if (!ls_data)
+	{
+		Con_Printf ("ERROR: couldn't open %s.\n", ls_path);
+		return;
+	}
+	ls_cursor = ls_data;
+
+	if (!SV_LockstepHeader ("lockstep", value, sizeof(value)) || sscanf (value, "%d", &version) != 1
+		|| version != LOCKSTEP_VERSION
+		|| !SV_LockstepHeader ("map", map, sizeof(map))
+		|| !SV_LockstepHeader ("maxclients", value, sizeof(value)) || sscanf (value, "%d", &maxclients) != 1
+		|| !SV_LockstepHeader ("cvars", value, sizeof(value))
+		|| sscanf (value, "%31s %31s %31s %31s", cvars[0], cvars[1], cvars[2], cvars[3]) != 4
+		|| !SV_LockstepHeader ("seed", value, sizeof(value)) || sscanf (value, "%u", &ls_seed) != 1
+		|| !SV_LockstepHeader ("progs", value, sizeof(value)) || sscanf (value, "%d", &ls_progscrc) != 1
+		|| !SV_LockstepHeader ("fields", ls_fields, sizeof(ls_fields)))
+	{
+		Con_Printf ("%s is not a lockstep recording.\n", ls_path);
+		free (ls_data);
+		ls_data = NULL;
+		return;
+	}
+
+	ls_quit = (Cmd_Argc () == 3 && !q_strcasecmp (Cmd_Argv (2), "quit"));
+	ls_pending = LS_REPLAY;
+
+	if (sv.active)
+		Cbuf_AddText ("disconnect\n");
+	Cbuf_AddText (va ("maxplayers %d\n", maxclients));
+	Cbuf_AddText (va ("skill %s\ndeathmatch %s\ncoop %s\nteamplay %s\n", cvars[0], cvars[1], cvars[2], cvars[3]));
+	Cbuf_AddText (va ("map %s\n", map));
+}
+
+/*
+=============
+SV_LockstepStop_f
+=============
+*/
+static void SV_LockstepStop_f (void)
+{
+	SV_LockstepStop ();
+	ls_pending = LS_OFF;
+	free (ls_data);
+	ls_data = NULL;
+}
+
+/*
+=============
+SV_StateHash_f
+=============
+*/
+static void SV_StateHash_f (void)
+{
+	uint64_t	hash;
+
+	if (!sv.active)
+	{
+		Con_Printf ("Not running a server.\n");
+		return;
+	}
+
+	if (ls_mode == LS_OFF)
+		SV_BuildHashDefs (sv_statehash_fields.string);
+	hash = SV_StateHash ();
+	Con_Printf ("state hash %08x%08x, %d globals, %d fields\n", (unsigned int)(hash >> 32), (unsigned int)hash,
+			ls_numglobaldefs, ls_numfielddefs);
+}
+
+/*
+=============
+SV_LockstepInit
+=============
+*/
+void SV_LockstepInit (void)
+{
+	Cvar_RegisterVariable (&sv_statehash_fields);
+
+	Cmd_AddCommand ("statehash", SV_StateHash_f);
+	Cmd_AddCommand ("statehash_record", SV_LockstepRecord_f);
+	Cmd_AddCommand ("statehash_compare", SV_LockstepCompare_f);
+	Cmd_AddCommand ("statehash_stop", SV_LockstepStop_f);
+}
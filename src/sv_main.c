@@ -30,8 +30,11 @@ static char	localmodels[MAX_MODELS][8];	// inline model names for precache
 
 int		sv_protocol = PROTOCOL_FITZQUAKE; //johnfitz
 
+cvar_t	sv_pvsjobs = {"sv_pvsjobs","0",CVAR_NONE};
+
 extern qboolean	pr_alpha_supported; //johnfitz
 extern int pr_effects_mask;
+extern cvar_t sv_hotfields;
 
 //============================================================================
 
@@ -87,6 +90,10 @@ void SV_Init (void)
 	extern	cvar_t	sv_idealpitchscale;
 	extern	cvar_t	sv_aim;
 	extern	cvar_t	sv_altnoclip; //johnfitz
+	extern	cvar_t	sv_tracecache;
+	extern	cvar_t	sv_physjobs;
+	extern	cvar_t	sv_navbudget;
+	extern	cvar_t	sv_dormant;
 
 	sv.edicts = NULL; // ericw -- sv.edicts switched to use malloc()
 
@@ -104,9 +111,23 @@ void SV_Init (void)
 	Cvar_RegisterVariable (&sv_aim);
 	Cvar_RegisterVariable (&sv_nostep);
 	Cvar_RegisterVariable (&sv_freezenonclients);
+	Cvar_RegisterVariable (&sv_hotfields);
 	Cvar_RegisterVariable (&sv_altnoclip); //johnfitz
+	Cvar_RegisterVariable (&sv_tracecache);
+	Cvar_RegisterVariable (&sv_physjobs);
+	Cvar_RegisterVariable (&sv_pvsjobs);
+	Cvar_RegisterVariable (&sv_navbudget);
+	Cvar_RegisterVariable (&sv_dormant);
 
 	Cmd_AddCommand ("sv_protocol", &SV_Protocol_f); //johnfitz
+	Cmd_AddCommand ("sv_hotbench", &SV_HotFieldBench_f);
+	Cmd_AddCommand ("sv_movebench", &SV_MoveBench_f);
+	Cmd_AddCommand ("sv_tracefuzz", &SV_TraceFuzz_f);
+	Cmd_AddCommand ("sv_tracestats", &SV_TraceStats_f);
+	Cmd_AddCommand ("sv_physstats", &SV_PhysStats_f);
+	Cmd_AddCommand ("sv_navstats", &SV_NavStats_f);
+
+	SV_LockstepInit ();
 
 	for (i=0 ; i<MAX_MODELS ; i++)
 		sprintf (localmodels[i], "*%i", i);
@@ -403,7 +424,7 @@ void SV_ConnectClient (int clientnum)
 
 	client = svs.clients + clientnum;
 
-	Con_DPrintf ("Client %s connected\n", NET_QSocketGetAddressString(client->netconnection));
+	Con_DPrintf ("Client %s connected\n", client->netconnection ? NET_QSocketGetAddressString(client->netconnection) : "(lockstep replay)");
 
 	edictnum = clientnum+1;
 
@@ -470,6 +491,7 @@ void SV_CheckForNewClients (void)
 
 		svs.clients[i].netconnection = ret;
 		SV_ConnectClient (i);
+		SV_LockstepRecordConnect (i);
 
 		net_activeconnections++;
 	}
@@ -510,6 +532,72 @@ static int	fatbytes;
 static byte	*fatpvs;
 static int	fatpvs_capacity;
 
+/*
+Decompressed PVS rows are cached per leaf (direct mapped on the leaf number)
+and each client's fat PVS is kept until the client's view origin moves, so
+PF_checkclient and the per-frame entity culling share the same rows instead
+of decompressing them again.  Both caches are dropped on map change.
+*/
+#define	PVSCACHE_SIZE	64
+
+static mleaf_t	*pvscache_leafs[PVSCACHE_SIZE];
+static byte	*pvscache_rows;
+static int	pvscache_rowbytes;
+
+typedef struct
+{
+	qboolean	valid;
+	vec3_t		org;
+} clientpvs_t;
+
+static clientpvs_t	clientpvs[MAX_SCOREBOARD];
+static byte	*clientpvs_rows;
+static int	clientpvs_rowbytes;
+
+/*
+=============
+SV_ClearPVSCache
+=============
+*/
+void SV_ClearPVSCache (void)
+{
+	memset (pvscache_leafs, 0, sizeof(pvscache_leafs));
+	memset (clientpvs, 0, sizeof(clientpvs));
+}
+
+/*
+=============
+SV_LeafPVS
+
+Mod_LeafPVS for sv.worldmodel, through the leaf cache.  The returned row
+stays valid until the leaf is evicted, so copy it if it must be kept.
+=============
+*/
+byte *SV_LeafPVS (mleaf_t *leaf)
+{
+	int		row, slot;
+	byte	*pvs;
+
+	row = (sv.worldmodel->numleafs+7)>>3;
+	if (row > pvscache_rowbytes)
+	{
+		pvscache_rowbytes = row;
+		pvscache_rows = (byte *) realloc (pvscache_rows, PVSCACHE_SIZE * pvscache_rowbytes);
+		if (!pvscache_rows)
+			Sys_Error ("SV_LeafPVS: realloc() failed on %d bytes", PVSCACHE_SIZE * pvscache_rowbytes);
+		memset (pvscache_leafs, 0, sizeof(pvscache_leafs));
+	}
+
+	slot = (leaf - sv.worldmodel->leafs) & (PVSCACHE_SIZE - 1);
+	pvs = pvscache_rows + slot * pvscache_rowbytes;
+	if (pvscache_leafs[slot] != leaf)
+	{
+		memcpy (pvs, Mod_LeafPVS (leaf, sv.worldmodel), row);
+		pvscache_leafs[slot] = leaf;
+	}
+	return pvs;
+}
+
 void SV_AddToFatPVS (vec3_t org, mnode_t *node, qmodel_t *worldmodel) //johnfitz -- added worldmodel as a parameter
 {
 	int		i;
@@ -524,7 +612,10 @@ void SV_AddToFatPVS (vec3_t org, mnode_t *node, qmodel_t *worldmodel) //johnfitz
 		{
 			if (node->contents != CONTENTS_SOLID)
 			{
-				pvs = Mod_LeafPVS ( (mleaf_t *)node, worldmodel); //johnfitz -- worldmodel as a parameter
+				if (sv.active && worldmodel == sv.worldmodel)
+					pvs = SV_LeafPVS ( (mleaf_t *)node);
+				else
+					pvs = Mod_LeafPVS ( (mleaf_t *)node, worldmodel); //johnfitz -- worldmodel as a parameter
 				for (i=0 ; i<fatbytes ; i++)
 					fatpvs[i] |= pvs[i];
 			}
@@ -569,6 +660,46 @@ byte *SV_FatPVS (vec3_t org, qmodel_t *worldmodel) //johnfitz -- added worldmode
 	return fatpvs;
 }
 
+/*
+=============
+SV_ClientFatPVS
+
+SV_FatPVS for a client's view origin, recomputed only when it has moved
+=============
+*/
+byte *SV_ClientFatPVS (edict_t *clent)
+{
+	clientpvs_t	*cache;
+	vec3_t	org;
+	int		num, row;
+	byte	*pvs;
+
+	VectorAdd (clent->v.origin, clent->v.view_ofs, org);
+	num = NUM_FOR_EDICT(clent) - 1;
+	if (num < 0 || num >= MAX_SCOREBOARD)
+		return SV_FatPVS (org, sv.worldmodel);
+
+	row = (sv.worldmodel->numleafs+7)>>3;
+	if (row > clientpvs_rowbytes)
+	{
+		clientpvs_rowbytes = row;
+		clientpvs_rows = (byte *) realloc (clientpvs_rows, MAX_SCOREBOARD * clientpvs_rowbytes);
+		if (!clientpvs_rows)
+			Sys_Error ("SV_ClientFatPVS: realloc() failed on %d bytes", MAX_SCOREBOARD * clientpvs_rowbytes);
+		memset (clientpvs, 0, sizeof(clientpvs));
+	}
+
+	cache = &clientpvs[num];
+	pvs = clientpvs_rows + num * clientpvs_rowbytes;
+	if (!cache->valid || !VectorCompare (cache->org, org))
+	{
+		memcpy (pvs, SV_FatPVS (org, sv.worldmodel), row);
+		VectorCopy (org, cache->org);
+		cache->valid = true;
+	}
+	return pvs;
+}
+
 /*
 =============
 SV_VisibleToClient -- johnfitz
@@ -579,11 +710,16 @@ PVS test encapsulated in a nice function
 qboolean SV_VisibleToClient (edict_t *client, edict_t *test, qmodel_t *worldmodel)
 {
 	byte	*pvs;
-	vec3_t	org;
 	int		i;
 
-	VectorAdd (client->v.origin, client->v.view_ofs, org);
-	pvs = SV_FatPVS (org, worldmodel);
+	if (worldmodel == sv.worldmodel)
+		pvs = SV_ClientFatPVS (client);
+	else
+	{
+		vec3_t	org;
+		VectorAdd (client->v.origin, client->v.view_ofs, org);
+		pvs = SV_FatPVS (org, worldmodel);
+	}
 
 	for (i=0 ; i < test->num_leafs ; i++)
 		if (pvs[test->leafnums[i] >> 3] & (1 << (test->leafnums[i]&7) ))
@@ -594,6 +730,33 @@ qboolean SV_VisibleToClient (edict_t *client, edict_t *test, qmodel_t *worldmode
 
 //=============================================================================
 
+static	byte	*sv_entvisible;		// SV_CullEntities results, by edict number
+static	int		sv_entvisiblesize;
+
+/*
+=============
+SV_CullEntities
+
+The PVS test of SV_WriteEntitiesToClient for a range of edicts, run on
+the job pool with sv_pvsjobs 1
+=============
+*/
+static void SV_CullEntities (jobctx_t *ctx, void *data, int first, int last)
+{
+	byte	*pvs = (byte *) data;
+	edict_t	*ent;
+	int		e, i;
+
+	for (e = first; e < last; e++)
+	{
+		ent = (edict_t *)((byte *)sv.edicts + e*pr_edict_size);
+		for (i=0 ; i < ent->num_leafs ; i++)
+			if (pvs[ent->leafnums[i] >> 3] & (1 << (ent->leafnums[i]&7) ))
+				break;
+		sv_entvisible[e] = (i < ent->num_leafs || ent->num_leafs == MAX_ENT_LEAFS);
+	}
+}
+
 /*
 =============
 SV_WriteEntitiesToClient
@@ -605,14 +768,26 @@ void SV_WriteEntitiesToClient (edict_t	*clent, sizebuf_t *msg)
 	int		e, i;
 	int		bits;
 	byte	*pvs;
-	vec3_t	org;
 	float	miss;
 	edict_t	*ent;
 	eval_t	*val;
+	qboolean	culled;
 
 // find the client's PVS
-	VectorAdd (clent->v.origin, clent->v.view_ofs, org);
-	pvs = SV_FatPVS (org, sv.worldmodel);
+	pvs = SV_ClientFatPVS (clent);
+
+	culled = sv_pvsjobs.value != 0;
+	if (culled)
+	{
+		if (sv_entvisiblesize < sv.num_edicts)
+		{
+			sv_entvisiblesize = sv.max_edicts;
+			sv_entvisible = (byte *) realloc (sv_entvisible, sv_entvisiblesize);
+			if (!sv_entvisible)
+				Sys_Error ("SV_WriteEntitiesToClient: realloc() failed on %d bytes", sv_entvisiblesize);
+		}
+		Jobs_Run ("pvs", SV_CullEntities, pvs, sv.num_edicts, 256, 0);
+	}
 
 // send over all entities (excpet the client) that touch the pvs
 	ent = NEXT_EDICT(sv.edicts);
@@ -621,6 +796,10 @@ void SV_WriteEntitiesToClient (edict_t	*clent, sizebuf_t *msg)
 
 		if (ent != clent)	// clent is ALLWAYS sent
 		{
+			// skip modelless ents through the mirror without touching them
+			if (ed_hot.count && ed_hot.valid[e] && !ed_hot.modelindex[e])
+				continue;
+
 			// ignore ents without visible models
 			if (!ent->v.modelindex || !PR_GetString(ent->v.model)[0])
 				continue;
@@ -630,18 +809,26 @@ void SV_WriteEntitiesToClient (edict_t	*clent, sizebuf_t *msg)
 				continue;
 
 			// ignore if not touching a PV leaf
-			for (i=0 ; i < ent->num_leafs ; i++)
-				if (pvs[ent->leafnums[i] >> 3] & (1 << (ent->leafnums[i]&7) ))
-					break;
+			if (culled)
+			{
+				if (!sv_entvisible[e])
+					continue;		// not visible
+			}
+			else
+			{
+				for (i=0 ; i < ent->num_leafs ; i++)
+					if (pvs[ent->leafnums[i] >> 3] & (1 << (ent->leafnums[i]&7) ))
+						break;
 			
-			// ericw -- added ent->num_leafs < MAX_ENT_LEAFS condition.
-			//
-			// if ent->num_leafs == MAX_ENT_LEAFS, the ent is visible from too many leafs
-			// for us to say whether it's in the PVS, so don't try to vis cull it.
-			// this commonly happens with rotators, because they often have huge bboxes
-			// spanning the entire map, or really tall lifts, etc.
-			if (i == ent->num_leafs && ent->num_leafs < MAX_ENT_LEAFS)
-				continue;		// not visible
+				// ericw -- added ent->num_leafs < MAX_ENT_LEAFS condition.
+				//
+				// if ent->num_leafs == MAX_ENT_LEAFS, the ent is visible from too many leafs
+				// for us to say whether it's in the PVS, so don't try to vis cull it.
+				// this commonly happens with rotators, because they often have huge bboxes
+				// spanning the entire map, or really tall lifts, etc.
+				if (i == ent->num_leafs && ent->num_leafs < MAX_ENT_LEAFS)
+					continue;		// not visible
+			}
 		}
 
 		// johnfitz -- max size for protocol 15 is 18 bytes, not 16 as originally
@@ -1018,7 +1205,7 @@ qboolean SV_SendClientDatagram (client_t *client)
 	msg.cursize = 0;
 
 	//johnfitz -- if client is nonlocal, use smaller max size so packets aren't fragmented
-	if (Q_strcmp(NET_QSocketGetAddressString(client->netconnection), "LOCAL") != 0)
+	if (client->netconnection && Q_strcmp(NET_QSocketGetAddressString(client->netconnection), "LOCAL") != 0)
 		msg.maxsize = DATAGRAM_MTU;
 	//johnfitz
 
@@ -1034,6 +1221,10 @@ qboolean SV_SendClientDatagram (client_t *client)
 	if (msg.cursize + sv.datagram.cursize < msg.maxsize)
 		SZ_Write (&msg, sv.datagram.data, sv.datagram.cursize);
 
+// lockstep replay clients have nowhere to send it
+	if (!client->netconnection)
+		return true;
+
 // send the datagram
 	if (NET_SendUnreliableMessage (client->netconnection, &msg) == -1)
 	{
@@ -1125,6 +1316,16 @@ void SV_SendClientMessages (void)
 		if (!host_client->active)
 			continue;
 
+		if (!host_client->netconnection)
+		{
+		// lockstep replay client, only the side effects of building
+		// the datagram matter
+			if (host_client->spawned)
+				SV_SendClientDatagram (host_client);
+			SZ_Clear (&host_client->message);
+			continue;
+		}
+
 		if (host_client->spawned)
 		{
 			if (!SV_SendClientDatagram (host_client))
@@ -1469,6 +1670,8 @@ void SV_SpawnServer (const char *server)
 	Con_DPrintf ("SpawnServer: %s\n",server);
 	svs.changelevel_issued = false;		// now safe to issue another
 
+	SV_LockstepBeginSpawn ();
+
 //
 // tell all connected clients that we are going to a new level
 //
@@ -1515,6 +1718,7 @@ void SV_SpawnServer (const char *server)
 	/* Host_ClearMemory() called above already cleared the whole sv structure */
 	sv.max_edicts = CLAMP (MIN_EDICTS,(int)max_edicts.value,MAX_EDICTS); //johnfitz -- max_edicts cvar
 	sv.edicts = (edict_t *) malloc (sv.max_edicts*pr_edict_size); // ericw -- sv.edicts switched to use malloc()
+	ED_HotInit (sv_hotfields.value != 0);
 
 	sv.datagram.maxsize = sizeof(sv.datagram_buf);
 	sv.datagram.cursize = 0;
@@ -1558,6 +1762,9 @@ void SV_SpawnServer (const char *server)
 // clear world interaction links
 //
 	SV_ClearWorld ();
+	SV_ClearPVSCache ();
+	SV_NavClear ();
+	SV_NavSpawn ();
 
 	sv.sound_precache[0] = dummy;
 	sv.model_precache[0] = dummy;
@@ -1621,6 +1828,8 @@ void SV_SpawnServer (const char *server)
 // [tuorqai] one more signal to Python
 	PyQ_PostServerSpawn ();
 
+	SV_LockstepSpawned ();
+
 	Con_DPrintf ("Server spawned.\n");
 }
 
@@ -183,6 +183,7 @@ qboolean SV_movestep (edict_t *ent, vec3_t move, qboolean relink)
 			if (relink)
 				SV_LinkEdict (ent, true);
 			ent->v.flags = (int)ent->v.flags & ~FL_ONGROUND;
+			ED_HotDirty (ent);
 		//	Con_Printf ("fall down\n");
 			return true;
 		}
@@ -210,6 +211,7 @@ qboolean SV_movestep (edict_t *ent, vec3_t move, qboolean relink)
 	{
 	//	Con_Printf ("back on ground\n");
 		ent->v.flags = (int)ent->v.flags & ~FL_PARTIALGROUND;
+		ED_HotDirty (ent);
 	}
 	ent->v.groundentity = EDICT_TO_PROG(trace.ent);
 
@@ -271,6 +273,7 @@ void SV_FixCheckBottom (edict_t *ent)
 {
 //	Con_Printf ("SV_FixCheckBottom\n");
 	ent->v.flags = (int)ent->v.flags | FL_PARTIALGROUND;
+	ED_HotDirty (ent);
 }
 
 
@@ -318,7 +321,7 @@ void SV_NewChaseDir (edict_t *actor, edict_t *enemy, float dist)
 	}
 
 // try other directions
-	if ( ((rand()&3) & 1) ||  abs((int)deltay)>abs((int)deltax)) // ericw -- explicit int cast to suppress clang suggestion to use fabsf
+	if ( ((SV_Rand()&3) & 1) ||  abs((int)deltay)>abs((int)deltax)) // ericw -- explicit int cast to suppress clang suggestion to use fabsf
 	{
 		tdir=d[1];
 		d[1]=d[2];
@@ -338,7 +341,7 @@ void SV_NewChaseDir (edict_t *actor, edict_t *enemy, float dist)
 	if (olddir!=DI_NODIR && SV_StepDirection(actor, olddir, dist))
 			return;
 
-	if (rand()&1) 	/*randomly determine direction of search*/
+	if (SV_Rand()&1) 	/*randomly determine direction of search*/
 	{
 		for (tdir=0 ; tdir<=315 ; tdir += 45)
 			if (tdir!=turnaround && SV_StepDirection(actor, tdir, dist) )
@@ -394,6 +397,8 @@ void SV_MoveToGoal (void)
 {
 	edict_t		*ent, *goal;
 	float		dist;
+	vec3_t		mins, maxs;
+	int			i;
 
 	ent = PROG_TO_EDICT(pr_global_struct->self);
 	goal = PROG_TO_EDICT(ent->v.goalentity);
@@ -409,11 +414,77 @@ void SV_MoveToGoal (void)
 	if ( PROG_TO_EDICT(ent->v.enemy) != sv.edicts &&  SV_CloseEnough (ent, goal, dist) )
 		return;
 
+// every step tried below stays in this box, bottom checks included
+	for (i=0 ; i<2 ; i++)
+	{
+		mins[i] = ent->v.origin[i] + ent->v.mins[i] - fabs(dist) - 2;
+		maxs[i] = ent->v.origin[i] + ent->v.maxs[i] + fabs(dist) + 2;
+	}
+	mins[2] = ent->v.origin[2] + ent->v.mins[2] - 3*STEPSIZE - 2;
+	maxs[2] = ent->v.origin[2] + ent->v.maxs[2] + STEPSIZE + 2;
+	SV_BeginMoveBatch (ent, mins, maxs);
+
 // bump around...
-	if ( (rand()&3)==1 ||
+	if ( (SV_Rand()&3)==1 ||
 	!SV_StepDirection (ent, ent->v.ideal_yaw, dist))
 	{
 		SV_NewChaseDir (ent, goal, dist);
 	}
+
+	SV_EndMoveBatch ();
 }
 
+
+/*
+======================
+SV_WalkPathToGoal
+
+float walkpathtogoal (float movedist, vector goal) from the 2021 rerelease.
+Takes one step along the navigation graph path to goal, see sv_nav.c.
+======================
+*/
+void SV_WalkPathToGoal (void)
+{
+	edict_t		*ent;
+	float		dist, yaw;
+	vec3_t		goal, point, delta;
+	dfunction_t	*oldf;
+	int			oldself, result;
+
+	ent = PROG_TO_EDICT(pr_global_struct->self);
+	dist = G_FLOAT(OFS_PARM0);
+	VectorCopy (G_VECTOR(OFS_PARM1), goal);
+
+// the graph is only for walkers
+	if ( ((int)ent->v.flags & (FL_ONGROUND|FL_FLY|FL_SWIM)) != FL_ONGROUND )
+	{
+		G_FLOAT(OFS_RETURN) = PATH_ERROR;
+		return;
+	}
+
+	result = SV_NavWaypoint (ent, goal, dist, point);
+	if (result == PATH_IN_PROGRESS)
+	{
+		VectorSubtract (point, ent->v.origin, delta);
+		delta[2] = 0;
+		yaw = atan2 (delta[1], delta[0]) * 180 / M_PI;
+		if (yaw < 0)
+			yaw += 360;
+
+	// save program state, because SV_StepDirection may call other progs
+		oldf = pr_xfunction;
+		oldself = pr_global_struct->self;
+
+		if (!SV_StepDirection (ent, yaw, q_min(dist, VectorLength (delta))))
+		{
+			SV_NavDropPath (ent);
+			result = PATH_ERROR;
+		}
+
+	// restore program state
+		pr_xfunction = oldf;
+		pr_global_struct->self = oldself;
+	}
+
+	G_FLOAT(OFS_RETURN) = result;
+}
@@ -0,0 +1,993 @@
+/*
+Copyright (C) 1996-2001 Id Software, Inc.
+Copyright (C) 2002-2009 John Fitzgibbons and others
+Copyright (C) 2010-2014 QuakeSpasm developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// sv_nav.c -- navigation graph and path finding for walkpathtogoal
+
+#include "quakedef.h"
+
+/*
+The graph is sampled from clipping hull 1 of the world on a NAV_GRID
+unit grid.  Every column is scanned from the top of the map down, and
+each floor a player sized box can stand on (not too steep, not in lava
+or slime) becomes a node at the origin such a box would have there.  A
+node links to the nearest floor in each of the eight neighbouring
+columns when a box can walk or step (STEPSIZE, like SV_movestep) across
+to it.
+
+When the progs call walkpathtogoal, the server loads maps/<name>.nav as
+the map spawns, or builds the graph and writes it there.  The file
+records the CRC and length of the bsp it was built from, and is rebuilt
+when they don't match.  A call the spawn check missed loads it then.
+
+Brush models (doors, plats, lifts) are not part of the graph; a monster
+that bumps into one drops its path, and walkpathtogoal returns
+PATH_ERROR so the QC falls back to movetogoal.
+*/
+
+cvar_t	sv_navbudget = {"sv_navbudget","4",CVAR_NONE};	// path searches a frame, 0 turns walkpathtogoal off
+
+#define	STEPSIZE		18
+
+#define	NAV_IDENT		(('V'<<24)+('A'<<16)+('N'<<8)+'Q')
+#define	NAV_VERSION		1
+
+#define	NAV_GRID		32
+#define	NAV_SCANSTEP	8		// how far a column scan moves through solid at a time
+#define	NAV_MAXFLOORS	16		// per column
+#define	NAV_MAXCOLUMNS	(1<<20)
+#define	NAV_DIRS		8
+
+#define	NAV_MAXEXPAND	16384	// nodes one search may expand
+#define	NAV_MAXPATH		64		// longer paths are searched again from where they stop
+#define	NAV_REPATH		0.5		// seconds before a path is searched again for a moved goal
+#define	NAV_RETRY		1.0		// seconds before an unreachable goal is tried again
+
+static const int nav_dirs[NAV_DIRS][2] =
+{
+	{1, 0}, {1, 1}, {0, 1}, {-1, 1}, {-1, 0}, {-1, -1}, {0, -1}, {1, -1}
+};
+
+typedef struct
+{
+	vec3_t	origin;				// of a hull 1 box standing on the floor
+	int		link[NAV_DIRS];		// node a step in each direction reaches, -1 for none
+} navnode_t;
+
+typedef struct
+{
+	int		ident;
+	int		version;
+	int		bspcrc, bsplength;	// of the bsp file the graph was built from
+	int		grid;
+	int		x0, y0;				// origin of column 0
+	int		columnsx, columnsy;
+	int		numnodes;
+// followed by columnsx * columnsy + 1 first node numbers, then the nodes
+} navheader_t;
+
+typedef struct
+{
+	float	f;
+	int		node;
+} navopen_t;
+
+typedef struct
+{
+	qboolean	loaded;			// tried, even if nothing came of it
+	int		x0, y0;
+	int		columnsx, columnsy;
+	int		*colfirst;			// first node of each column, top floor first
+	navnode_t	*nodes;
+	int		numnodes, numlinks;
+
+// search state
+	float	*cost;
+	int		*parent;
+	unsigned int	*opened, *closed;	// search number that last reached the node
+	unsigned int	search;
+	navopen_t	*open;
+	int		numopen;
+
+// only while building
+	float	*floors;			// NAV_MAXFLOORS for each column
+	int		*numfloors;
+} navgraph_t;
+
+typedef struct
+{
+	int		goalnode;
+	int		goalnearest;		// SV_NavNearest of goalorigin, -1 for none
+	vec3_t	goalorigin;
+	int		numpoints, point;
+	qboolean	complete;		// ends at goalnode rather than NAV_MAXPATH in
+	qboolean	failed;			// goalnode could not be reached
+	double	time;				// of the search
+	int		points[NAV_MAXPATH];
+} navpath_t;
+
+static	navgraph_t	nav;
+static	navpath_t	**nav_paths;	// by edict number
+static	int			nav_numpaths;
+static	double		nav_budgettime;
+static	int			nav_budgetleft;
+
+static	struct
+{
+	int		searches, found, expanded;
+	int		overbudget, steps;
+} navstats;
+
+/*
+===============
+SV_NavClear
+
+Called for every new map
+===============
+*/
+void SV_NavClear (void)
+{
+	int		i;
+
+	free (nav.colfirst);
+	free (nav.nodes);
+	free (nav.cost);
+	free (nav.parent);
+	free (nav.opened);
+	free (nav.closed);
+	free (nav.open);
+	memset (&nav, 0, sizeof(nav));
+
+	for (i = 0; i < nav_numpaths; i++)
+		free (nav_paths[i]);
+	free (nav_paths);
+	nav_paths = NULL;
+	nav_numpaths = 0;
+}
+
+/*
+===============================================================================
+
+BUILDING
+
+===============================================================================
+*/
+
+/*
+===============
+SV_NavTrace
+
+A box in hull 1 against the world alone
+===============
+*/
+static void SV_NavTrace (vec3_t start, vec3_t end, trace_t *trace)
+{
+	hull_t	*hull;
+
+	memset (trace, 0, sizeof(trace_t));
+	trace->fraction = 1;
+	trace->allsolid = true;
+	VectorCopy (end, trace->endpos);
+
+	hull = &sv.worldmodel->hulls[1];
+	SV_RecursiveHullCheck (hull, hull->firstclipnode, 0, 1, start, end, trace);
+}
+
+/*
+===============
+SV_NavScanColumns
+
+Job: finds the floors of columns first to last
+===============
+*/
+static void SV_NavScanColumns (jobctx_t *ctx, void *data, int first, int last)
+{
+	hull_t	*hull;
+	trace_t	trace;
+	vec3_t	top, down, feet;
+	float	*floors, bottom;
+	int		c, count, contents;
+
+	hull = &sv.worldmodel->hulls[1];
+	bottom = sv.worldmodel->mins[2];
+
+	for (c = first; c < last; c++)
+	{
+		floors = nav.floors + c * NAV_MAXFLOORS;
+		count = 0;
+
+		top[0] = nav.x0 + (c % nav.columnsx) * NAV_GRID;
+		top[1] = nav.y0 + (c / nav.columnsx) * NAV_GRID;
+		top[2] = sv.worldmodel->maxs[2];
+		while (count < NAV_MAXFLOORS && top[2] > bottom)
+		{
+		// find open space
+			if (SV_HullPointContents (hull, hull->firstclipnode, top) == CONTENTS_SOLID)
+			{
+				top[2] -= NAV_SCANSTEP;
+				continue;
+			}
+
+		// and drop onto whatever is under it
+			VectorCopy (top, down);
+			down[2] = bottom;
+			SV_NavTrace (top, down, &trace);
+			if (trace.fraction == 1)
+				break;		// fell out of the world
+
+			VectorCopy (trace.endpos, feet);
+			feet[2] += hull->clip_mins[2] + 1;
+			contents = SV_PointContents (feet);
+			if (trace.plane.normal[2] >= 0.7 && contents != CONTENTS_LAVA
+				&& contents != CONTENTS_SLIME && contents != CONTENTS_SKY)
+				floors[count++] = trace.endpos[2];
+
+			top[2] = trace.endpos[2] - NAV_SCANSTEP;
+		}
+		nav.numfloors[c] = count;
+	}
+}
+
+/*
+===============
+SV_NavCanStep
+
+Whether a box standing at from can walk or step onto to, a column away
+===============
+*/
+static qboolean SV_NavCanStep (const vec3_t from, const vec3_t to)
+{
+	vec3_t	start, end;
+	trace_t	trace;
+
+// step up and across, like SV_movestep
+	VectorCopy (from, start);
+	start[2] += STEPSIZE;
+	end[0] = to[0];
+	end[1] = to[1];
+	end[2] = start[2];
+	SV_NavTrace (start, end, &trace);
+	if (trace.startsolid)
+	{
+	// no room to step up, so walk
+		start[2] = end[2] = from[2];
+		SV_NavTrace (start, end, &trace);
+	}
+	if (trace.allsolid || trace.startsolid || trace.fraction < 1)
+		return false;
+
+// then down onto the floor there
+	VectorCopy (end, start);
+	end[2] = to[2] - 1;
+	SV_NavTrace (start, end, &trace);
+	if (trace.startsolid)
+		return false;
+	return fabs (trace.endpos[2] - to[2]) < 1;
+}
+
+/*
+===============
+SV_NavLinkNodes
+
+Job: fills in the links of nodes first to last
+===============
+*/
+static void SV_NavLinkNodes (jobctx_t *ctx, void *data, int first, int last)
+{
+	navnode_t	*node, *other;
+	float	dz, bestdz;
+	int		n, d, m, x, y, c, best;
+
+	for (n = first; n < last; n++)
+	{
+		node = &nav.nodes[n];
+		for (d = 0; d < NAV_DIRS; d++)
+		{
+			node->link[d] = -1;
+
+			x = Q_rint ((node->origin[0] - nav.x0) / NAV_GRID) + nav_dirs[d][0];
+			y = Q_rint ((node->origin[1] - nav.y0) / NAV_GRID) + nav_dirs[d][1];
+			if (x < 0 || x >= nav.columnsx || y < 0 || y >= nav.columnsy)
+				continue;
+			c = y * nav.columnsx + x;
+
+		// the floor closest in height, if it is in reach at all
+			best = -1;
+			bestdz = STEPSIZE + 1;
+			for (m = nav.colfirst[c]; m < nav.colfirst[c + 1]; m++)
+			{
+				dz = fabs (nav.nodes[m].origin[2] - node->origin[2]);
+				if (dz < bestdz)
+				{
+					best = m;
+					bestdz = dz;
+				}
+			}
+			if (best == -1)
+				continue;
+
+			other = &nav.nodes[best];
+			if (SV_NavCanStep (node->origin, other->origin))
+				node->link[d] = best;
+		}
+	}
+}
+
+/*
+===============
+SV_NavBuild
+
+===============
+*/
+static qboolean SV_NavBuild (void)
+{
+	int		c, i, n, numcolumns;
+	double	time1;
+
+	nav.x0 = (int) floor (sv.worldmodel->mins[0] / NAV_GRID) * NAV_GRID;
+	nav.y0 = (int) floor (sv.worldmodel->mins[1] / NAV_GRID) * NAV_GRID;
+	nav.columnsx = (int) ceil ((sv.worldmodel->maxs[0] - nav.x0) / NAV_GRID) + 1;
+	nav.columnsy = (int) ceil ((sv.worldmodel->maxs[1] - nav.y0) / NAV_GRID) + 1;
+	if (nav.columnsx <= 0 || nav.columnsy <= 0 || nav.columnsx > NAV_MAXCOLUMNS / nav.columnsy)
+	{
+		Con_Printf ("%s is too large for a navigation graph\n", sv.modelname);
+		return false;
+	}
+	numcolumns = nav.columnsx * nav.columnsy;
+
+	time1 = Sys_DoubleTime ();
+
+	nav.floors = (float *) malloc (numcolumns * NAV_MAXFLOORS * sizeof(float));
+	nav.numfloors = (int *) malloc (numcolumns * sizeof(int));
+	nav.colfirst = (int *) malloc ((numcolumns + 1) * sizeof(int));
+	if (!nav.floors || !nav.numfloors || !nav.colfirst)
+		Sys_Error ("SV_NavBuild: out of memory");
+
+	sv_speculating = true;	// no console output from the hull checks
+	Jobs_Run ("navcolumns", SV_NavScanColumns, NULL, numcolumns, 64, 0);
+	sv_speculating = false;
+
+	nav.numnodes = 0;
+	for (c = 0; c < numcolumns; c++)
+	{
+		nav.colfirst[c] = nav.numnodes;
+		nav.numnodes += nav.numfloors[c];
+	}
+	nav.colfirst[numcolumns] = nav.numnodes;
+
+	nav.nodes = (navnode_t *) malloc (q_max(nav.numnodes, 1) * sizeof(navnode_t));
+	if (!nav.nodes)
+		Sys_Error ("SV_NavBuild: out of memory");
+	for (c = 0, n = 0; c < numcolumns; c++)
+	{
+		for (i = 0; i < nav.numfloors[c]; i++, n++)
+		{
+			nav.nodes[n].origin[0] = nav.x0 + (c % nav.columnsx) * NAV_GRID;
+			nav.nodes[n].origin[1] = nav.y0 + (c / nav.columnsx) * NAV_GRID;
+			nav.nodes[n].origin[2] = nav.floors[c * NAV_MAXFLOORS + i];
+		}
+	}
+
+	free (nav.floors);
+	free (nav.numfloors);
+	nav.floors = NULL;
+	nav.numfloors = NULL;
+
+	sv_speculating = true;
+	Jobs_Run ("navlinks", SV_NavLinkNodes, NULL, nav.numnodes, 256, 0);
+	sv_speculating = false;
+
+	Con_Printf ("Built navigation graph for %s: %i nodes in %.2f seconds\n", sv.modelname, nav.numnodes, Sys_DoubleTime () - time1);
+	return true;
+}
+
+/*
+===============
+SV_NavWrite
+
+===============
+*/
+static void SV_NavWrite (const char *name, int bspcrc, int bsplength)
+{
+	navheader_t	*header;
+	navnode_t	*nodes;
+	byte	*buf;
+	int		*colfirst;
+	int		i, j, numcolumns, size;
+	char	path[MAX_OSPATH];
+
+	numcolumns = nav.columnsx * nav.columnsy;
+	size = sizeof(navheader_t) + (numcolumns + 1) * sizeof(int) + nav.numnodes * sizeof(navnode_t);
+	buf = (byte *) malloc (size);
+	if (!buf)
+		Sys_Error ("SV_NavWrite: out of memory");
+
+	header = (navheader_t *) buf;
+	header->ident = LittleLong (NAV_IDENT);
+	header->version = LittleLong (NAV_VERSION);
+	header->bspcrc = LittleLong (bspcrc);
+	header->bsplength = LittleLong (bsplength);
+	header->grid = LittleLong (NAV_GRID);
+	header->x0 = LittleLong (nav.x0);
+	header->y0 = LittleLong (nav.y0);
+	header->columnsx = LittleLong (nav.columnsx);
+	header->columnsy = LittleLong (nav.columnsy);
+	header->numnodes = LittleLong (nav.numnodes);
+
+	colfirst = (int *) (header + 1);
+	for (i = 0; i <= numcolumns; i++)
+		colfirst[i] = LittleLong (nav.colfirst[i]);
+
+	nodes = (navnode_t *) (colfirst + numcolumns + 1);
+	for (i = 0; i < nav.numnodes; i++)
+	{
+		for (j = 0; j < 3; j++)
+			nodes[i].origin[j] = LittleFloat (nav.nodes[i].origin[j]);
+		for (j = 0; j < NAV_DIRS; j++)
+			nodes[i].link[j] = LittleLong (nav.nodes[i].link[j]);
+	}
+
+	q_snprintf (path, sizeof(path), "%s/%s", com_gamedir, name);
+	COM_CreatePath (path);
+	COM_WriteFile (name, buf, size);
+	free (buf);
+}
+
+/*
+===============
+SV_NavRead
+
+False if the file is missing, damaged or from another version of the bsp
+===============
+*/
+static qboolean SV_NavRead (const char *name, int bspcrc, int bsplength)
+{
+	navheader_t	header;
+	navnode_t	*nodes;
+	byte	*buf;
+	int		*colfirst;
+	int		i, j, numcolumns, size;
+
+	buf = COM_LoadMallocFile (name, NULL);
+	if (!buf)
+		return false;
+	size = com_filesize;
+
+	if (size < (int) sizeof(header))
+		goto bad;
+	memcpy (&header, buf, sizeof(header));
+	for (i = 0; i < (int) (sizeof(header) / sizeof(int)); i++)
+		((int *) &header)[i] = LittleLong (((int *) &header)[i]);
+
+	if (header.ident != NAV_IDENT || header.version != NAV_VERSION || header.grid != NAV_GRID)
+		goto bad;
+	if (header.bspcrc != bspcrc || header.bsplength != bsplength)
+		goto bad;
+	if (header.columnsx <= 0 || header.columnsy <= 0 || header.columnsx > NAV_MAXCOLUMNS / header.columnsy)
+		goto bad;
+	numcolumns = header.columnsx * header.columnsy;
+	if (header.numnodes < 0 || header.numnodes > numcolumns * NAV_MAXFLOORS)
+		goto bad;
+	if (size != (int) (sizeof(header) + (numcolumns + 1) * sizeof(int) + header.numnodes * sizeof(navnode_t)))
+		goto bad;
+
+	nav.x0 = header.x0;
+	nav.y0 = header.y0;
+	nav.columnsx = header.columnsx;
+	nav.columnsy = header.columnsy;
+	nav.numnodes = header.numnodes;
+	nav.colfirst = (int *) malloc ((numcolumns + 1) * sizeof(int));
+	nav.nodes = (navnode_t *) malloc (q_max(nav.numnodes, 1) * sizeof(navnode_t));
+	if (!nav.colfirst || !nav.nodes)
+		Sys_Error ("SV_NavRead: out of memory");
+
+	colfirst = (int *) (buf + sizeof(header));
+	for (i = 0; i <= numcolumns; i++)
+	{
+		nav.colfirst[i] = LittleLong (colfirst[i]);
+		if (nav.colfirst[i] < (i ? nav.colfirst[i - 1] : 0) || nav.colfirst[i] > nav.numnodes)
+			goto bad;
+	}
+	if (nav.colfirst[numcolumns] != nav.numnodes)
+		goto bad;
+
+	nodes = (navnode_t *) (colfirst + numcolumns + 1);
+	for (i = 0; i < nav.numnodes; i++)
+	{
+		for (j = 0; j < 3; j++)
+			nav.nodes[i].origin[j] = LittleFloat (nodes[i].origin[j]);
+		for (j = 0; j < NAV_DIRS; j++)
+		{
+			nav.nodes[i].link[j] = LittleLong (nodes[i].link[j]);
+			if (nav.nodes[i].link[j] < -1 || nav.nodes[i].link[j] >= nav.numnodes)
+				goto bad;
+		}
+	}
+
+	free (buf);
+	Con_DPrintf ("Loaded %s, %i nodes\n", name, nav.numnodes);
+	return true;
+
+bad:
+	free (buf);
+	free (nav.colfirst);
+	free (nav.nodes);
+	nav.colfirst = NULL;
+	nav.nodes = NULL;
+	nav.numnodes = 0;
+	Con_DPrintf ("%s is out of date\n", name);
+	return false;
+}
+
+/*
+===============
+SV_NavLoad
+
+Loads or builds the graph for the current map, once
+===============
+*/
+static void SV_NavLoad (void)
+{
+	char	name[MAX_QPATH];
+	byte	*bsp;
+	int		bspcrc, bsplength;
+	int		i, n;
+
+	nav.loaded = true;
+
+	bsp = COM_LoadMallocFile (sv.modelname, NULL);
+	if (!bsp)
+		return;
+	bsplength = com_filesize;
+	bspcrc = CRC_Block (bsp, bsplength);
+	free (bsp);
+
+	COM_StripExtension (sv.modelname, name, sizeof(name));
+	q_strlcat (name, ".nav", sizeof(name));
+
+	if (!SV_NavRead (name, bspcrc, bsplength))
+	{
+		if (!SV_NavBuild ())
+			return;
+		SV_NavWrite (name, bspcrc, bsplength);
+	}
+
+	nav.numlinks = 0;
+	for (n = 0; n < nav.numnodes; n++)
+		for (i = 0; i < NAV_DIRS; i++)
+			if (nav.nodes[n].link[i] != -1)
+				nav.numlinks++;
+
+	nav.cost = (float *) malloc (q_max(nav.numnodes, 1) * sizeof(float));
+	nav.parent = (int *) malloc (q_max(nav.numnodes, 1) * sizeof(int));
+	nav.opened = (unsigned int *) calloc (q_max(nav.numnodes, 1), sizeof(unsigned int));
+	nav.closed = (unsigned int *) calloc (q_max(nav.numnodes, 1), sizeof(unsigned int));
+	nav.open = (navopen_t *) malloc ((NAV_MAXEXPAND * NAV_DIRS + 1) * sizeof(navopen_t));
+	if (!nav.cost || !nav.parent || !nav.opened || !nav.closed || !nav.open)
+		Sys_Error ("SV_NavLoad: out of memory");
+}
+
+/*
+===============
+SV_NavSpawn
+
+Called once the world model is in.  Loads the graph when some progs
+function is bound to walkpathtogoal, so the first call doesn't stall
+on the build.
+===============
+*/
+void SV_NavSpawn (void)
+{
+	int		i;
+
+	if (sv_navbudget.value <= 0)
+		return;
+	for (i = 1; i < progs->numfunctions; i++)
+	{
+		if (pr_funccalls[i].func == SV_WalkPathToGoal)
+		{
+			SV_NavLoad ();
+			return;
+		}
+	}
+}
+
+/*
+===============================================================================
+
+PATHS
+
+===============================================================================
+*/
+
+/*
+===============
+SV_NavPush / SV_NavPop
+
+A binary heap on f.  Nodes reached again for less are pushed again, and
+the stale entries skipped when they come out.
+===============
+*/
+static void SV_NavPush (int node, float f)
+{
+	navopen_t	*open = nav.open;
+	int		i, up;
+
+	for (i = nav.numopen++; i > 0; i = up)
+	{
+		up = (i - 1) / 2;
+		if (open[up].f <= f)
+			break;
+		open[i] = open[up];
+	}
+	open[i].f = f;
+	open[i].node = node;
+}
+
+static int SV_NavPop (void)
+{
+	navopen_t	*open = nav.open;
+	navopen_t	last;
+	int		i, child, node;
+
+	node = open[0].node;
+	last = open[--nav.numopen];
+	for (i = 0; (child = 2 * i + 1) < nav.numopen; i = child)
+	{
+		if (child + 1 < nav.numopen && open[child + 1].f < open[child].f)
+			child++;
+		if (last.f <= open[child].f)
+			break;
+		open[i] = open[child];
+	}
+	open[i] = last;
+	return node;
+}
+
+/*
+===============
+SV_NavDistance
+
+===============
+*/
+static float SV_NavDistance (const vec3_t a, const vec3_t b)
+{
+	vec3_t	d;
+
+	VectorSubtract (a, b, d);
+	return VectorLength (d);
+}
+
+/*
+===============
+SV_NavSearch
+
+A* from start to goal.  Fills in the first NAV_MAXPATH nodes of the path.
+===============
+*/
+static qboolean SV_NavSearch (int start, int goal, navpath_t *path)
+{
+	navnode_t	*node;
+	float	cost;
+	int		n, m, d, expanded, length;
+
+	navstats.searches++;
+
+	if (!++nav.search)
+	{
+		memset (nav.opened, 0, nav.numnodes * sizeof(unsigned int));
+		memset (nav.closed, 0, nav.numnodes * sizeof(unsigned int));
+		nav.search = 1;
+	}
+
+	nav.numopen = 0;
+	nav.cost[start] = 0;
+	nav.parent[start] = -1;
+	nav.opened[start] = nav.search;
+	SV_NavPush (start, SV_NavDistance (nav.nodes[start].origin, nav.nodes[goal].origin));
+
+	expanded = 0;
+	while (nav.numopen)
+	{
+		n = SV_NavPop ();
+		if (nav.closed[n] == nav.search)
+			continue;		// was pushed again for less
+		nav.closed[n] = nav.search;
+		if (n == goal || expanded == NAV_MAXEXPAND)
+			break;
+		expanded++;
+
+		node = &nav.nodes[n];
+		for (d = 0; d < NAV_DIRS; d++)
+		{
+			m = node->link[d];
+			if (m == -1 || nav.closed[m] == nav.search)
+				continue;
+			cost = nav.cost[n] + SV_NavDistance (node->origin, nav.nodes[m].origin);
+			if (nav.opened[m] == nav.search && cost >= nav.cost[m])
+				continue;
+			nav.opened[m] = nav.search;
+			nav.cost[m] = cost;
+			nav.parent[m] = n;
+			SV_NavPush (m, cost + SV_NavDistance (nav.nodes[m].origin, nav.nodes[goal].origin));
+		}
+	}
+	navstats.expanded += expanded;
+
+	if (nav.closed[goal] != nav.search)
+		return false;
+	navstats.found++;
+
+// walk back from the goal, keeping the start end of long paths
+	length = 0;
+	for (n = goal; n != -1; n = nav.parent[n])
+		length++;
+	path->complete = length <= NAV_MAXPATH;
+	for (n = goal; length > NAV_MAXPATH; n = nav.parent[n])
+		length--;
+	path->numpoints = length;
+	for ( ; n != -1; n = nav.parent[n])
+		path->points[--length] = n;
+	path->point = 0;
+	return true;
+}
+
+/*
+===============
+SV_NavNearest
+
+The closest node the point can see, -1 if there is none nearby
+===============
+*/
+static int SV_NavNearest (const vec3_t point)
+{
+	vec3_t	start;
+	trace_t	trace;
+	float	d, bestd;
+	int		x, y, cx, cy, c, n, best;
+
+	cx = Q_rint ((point[0] - nav.x0) / NAV_GRID);
+	cy = Q_rint ((point[1] - nav.y0) / NAV_GRID);
+	VectorCopy (point, start);
+
+	best = -1;
+	bestd = 0;
+	for (y = cy - 1; y <= cy + 1; y++)
+	{
+		if (y < 0 || y >= nav.columnsy)
+			continue;
+		for (x = cx - 1; x <= cx + 1; x++)
+		{
+			if (x < 0 || x >= nav.columnsx)
+				continue;
+			c = y * nav.columnsx + x;
+			for (n = nav.colfirst[c]; n < nav.colfirst[c + 1]; n++)
+			{
+				if (fabs (nav.nodes[n].origin[2] - point[2]) > 2 * STEPSIZE)
+					continue;
+				d = SV_NavDistance (nav.nodes[n].origin, point);
+				if (best != -1 && d >= bestd)
+					continue;
+				SV_NavTrace (start, nav.nodes[n].origin, &trace);
+				if (trace.allsolid || trace.fraction < 1)
+					continue;
+				best = n;
+				bestd = d;
+			}
+		}
+	}
+	return best;
+}
+
+/*
+===============
+SV_NavPathFor
+
+===============
+*/
+static navpath_t *SV_NavPathFor (edict_t *ent)
+{
+	navpath_t	*path;
+	int		num;
+
+	if (!nav_paths)
+	{
+		nav_numpaths = sv.max_edicts;
+		nav_paths = (navpath_t **) calloc (nav_numpaths, sizeof(navpath_t *));
+		if (!nav_paths)
+			Sys_Error ("SV_NavPathFor: out of memory");
+	}
+
+	num = NUM_FOR_EDICT(ent);
+	if (num >= nav_numpaths)
+		return NULL;
+	path = nav_paths[num];
+	if (!path)
+	{
+		path = nav_paths[num] = (navpath_t *) calloc (1, sizeof(navpath_t));
+		if (!path)
+			Sys_Error ("SV_NavPathFor: out of memory");
+		path->goalnode = -1;
+		path->goalnearest = -1;
+	}
+	else if (path->time <= ent->freetime)
+	{
+	// the edict has been freed and used again since
+		path->goalnode = -1;
+		path->goalnearest = -1;
+		path->numpoints = 0;
+	}
+	return path;
+}
+
+/*
+===============
+SV_NavDropPath
+
+For a step along the path that was blocked
+===============
+*/
+void SV_NavDropPath (edict_t *ent)
+{
+	navpath_t	*path;
+
+	path = SV_NavPathFor (ent);
+	if (path)
+		path->goalnode = -1;
+}
+
+/*
+===============
+SV_NavAdvance
+
+Moves on past the nodes ent has reached
+===============
+*/
+static void SV_NavAdvance (navpath_t *path, edict_t *ent)
+{
+	vec3_t	delta;
+
+	while (path->point < path->numpoints)
+	{
+		VectorSubtract (nav.nodes[path->points[path->point]].origin, ent->v.origin, delta);
+		delta[2] = 0;
+		if (VectorLength (delta) >= 1)
+			break;
+		path->point++;
+	}
+}
+
+/*
+===============
+SV_NavWaypoint
+
+For walkpathtogoal: sets point to where ent should head next on its way
+to goal and returns PATH_IN_PROGRESS, or returns PATH_COMPLETE or
+PATH_ERROR.  Each frame only sv_navbudget new searches are made; the
+others get PATH_ERROR (or keep the path they have) and try again later.
+===============
+*/
+int SV_NavWaypoint (edict_t *ent, const vec3_t goal, float dist, vec3_t point)
+{
+	navpath_t	*path;
+	vec3_t		delta;
+	int		start, goalnode;
+	qboolean	needsearch, wantsearch;
+
+	if (sv_navbudget.value <= 0)
+		return PATH_ERROR;
+	if (!nav.loaded)
+		SV_NavLoad ();
+	if (!nav.numnodes)
+		return PATH_ERROR;
+
+	VectorSubtract (goal, ent->v.origin, delta);
+	if (fabs (delta[2]) <= STEPSIZE)
+	{
+		delta[2] = 0;
+		if (VectorLength (delta) <= q_max(dist, NAV_GRID * 0.5f))
+			return PATH_COMPLETE;
+	}
+
+	path = SV_NavPathFor (ent);
+	if (!path)
+		return PATH_ERROR;
+
+// the goal node only needs looking up again once the goal has moved on
+	if (path->goalnearest == -1 || SV_NavDistance (goal, path->goalorigin) > NAV_GRID)
+	{
+		path->goalnearest = SV_NavNearest (goal);
+		VectorCopy (goal, path->goalorigin);
+	}
+	goalnode = path->goalnearest;
+	if (goalnode == -1)
+		return PATH_ERROR;
+
+	if (path->failed && goalnode == path->goalnode && sv.time - path->time < NAV_RETRY)
+		return PATH_ERROR;		// could not get there a moment ago
+
+	SV_NavAdvance (path, ent);
+	needsearch = path->goalnode == -1 || path->failed
+		|| (path->point == path->numpoints && !path->complete);
+	if (!needsearch && path->point < path->numpoints
+		&& SV_NavDistance (nav.nodes[path->points[path->point]].origin, ent->v.origin) > 2 * NAV_GRID)
+		needsearch = true;		// knocked away from the path
+	wantsearch = goalnode != path->goalnode && sv.time - path->time >= NAV_REPATH;
+
+	if (needsearch || wantsearch)
+	{
+		if (nav_budgettime != sv.time)
+		{
+			nav_budgettime = sv.time;
+			nav_budgetleft = (int) sv_navbudget.value;
+		}
+
+		if (!nav_budgetleft)
+		{
+			navstats.overbudget++;
+			if (needsearch)
+				return PATH_ERROR;
+		}
+		else
+		{
+			nav_budgetleft--;
+			path->goalnode = goalnode;
+			path->time = sv.time;
+			start = SV_NavNearest (ent->v.origin);
+			path->failed = start == -1 || !SV_NavSearch (start, goalnode, path);
+			if (path->failed)
+				return PATH_ERROR;
+			SV_NavAdvance (path, ent);
+		}
+	}
+
+	if (path->point < path->numpoints)
+	{
+		VectorCopy (nav.nodes[path->points[path->point]].origin, point);
+	}
+	else
+	{	// past the last node, so straight on to the goal
+		VectorCopy (goal, point);
+	}
+
+	navstats.steps++;
+	return PATH_IN_PROGRESS;
+}
+
+/*
+================
+SV_NavStats_f
+
+Prints the graph and resets the search counters
+================
+*/
+void SV_NavStats_f (void)
+{
+	if (!nav.loaded)
+		Con_Printf ("no navigation graph loaded\n");
+	else
+		Con_Printf ("%i nodes, %i links\n", nav.numnodes, nav.numlinks);
+
+	Con_Printf ("%i searches, %i found, %i nodes expanded, %i over budget\n",
+		navstats.searches, navstats.found, navstats.expanded, navstats.overbudget);
+	Con_Printf ("%i steps along paths\n", navstats.steps);
+
+	memset (&navstats, 0, sizeof(navstats));
+}
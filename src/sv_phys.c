@@ -47,11 +47,15 @@ cvar_t	sv_gravity = {"sv_gravity","800",CVAR_NOTIFY|CVAR_SERVERINFO};
 cvar_t	sv_maxvelocity = {"sv_maxvelocity","2000",CVAR_NONE};
 cvar_t	sv_nostep = {"sv_nostep","0",CVAR_NONE};
 cvar_t	sv_freezenonclients = {"sv_freezenonclients","0",CVAR_NONE};
+cvar_t	sv_hotfields = {"sv_hotfields","0",CVAR_NONE}; // takes effect on the next map
+cvar_t	sv_physjobs = {"sv_physjobs","0",CVAR_NONE};
+cvar_t	sv_dormant = {"sv_dormant","0",CVAR_NONE};
 
 
 #define	MOVE_EPSILON	0.01
 
 void SV_Physics_Toss (edict_t *ent);
+static qboolean SV_SpeculatedPush (edict_t *ent, vec3_t end, int type, trace_t *trace);
 
 /*
 ================
@@ -419,20 +423,26 @@ SV_PushEntity
 Does not change the entities velocity at all
 ============
 */
+static int SV_PushEntityType (edict_t *ent)
+{
+	if (ent->v.movetype == MOVETYPE_FLYMISSILE)
+		return MOVE_MISSILE;
+	if (ent->v.solid == SOLID_TRIGGER || ent->v.solid == SOLID_NOT)
+		return MOVE_NOMONSTERS;	// only clip against bmodels
+	return MOVE_NORMAL;
+}
+
 trace_t SV_PushEntity (edict_t *ent, vec3_t push)
 {
 	trace_t	trace;
 	vec3_t	end;
+	int		type;
 
 	VectorAdd (ent->v.origin, push, end);
 
-	if (ent->v.movetype == MOVETYPE_FLYMISSILE)
-		trace = SV_Move (ent->v.origin, ent->v.mins, ent->v.maxs, end, MOVE_MISSILE, ent);
-	else if (ent->v.solid == SOLID_TRIGGER || ent->v.solid == SOLID_NOT)
-	// only clip against bmodels
-		trace = SV_Move (ent->v.origin, ent->v.mins, ent->v.maxs, end, MOVE_NOMONSTERS, ent);
-	else
-		trace = SV_Move (ent->v.origin, ent->v.mins, ent->v.maxs, end, MOVE_NORMAL, ent);
+	type = SV_PushEntityType (ent);
+	if (!SV_SpeculatedPush (ent, end, type, &trace))
+		trace = SV_Move (ent->v.origin, ent->v.mins, ent->v.maxs, end, type, ent);
 
 	VectorCopy (trace.endpos, ent->v.origin);
 	SV_LinkEdict (ent, true);
@@ -444,6 +454,19 @@ trace_t SV_PushEntity (edict_t *ent, vec3_t push)
 }
 
 
+static	edict_t	**push_check;		// SV_PushMove scratch, kept between frames
+static	edict_t	**moved_edict;
+static	vec3_t	*moved_from;
+static	int		push_maxedicts;
+
+static int SV_EdictOrder (const void *a, const void *b)
+{
+	const edict_t	*ea = *(edict_t * const *) a;
+	const edict_t	*eb = *(edict_t * const *) b;
+
+	return (ea > eb) - (ea < eb);
+}
+
 /*
 ============
 SV_PushMove
@@ -455,10 +478,8 @@ void SV_PushMove (edict_t *pusher, float movetime)
 	edict_t		*check, *block;
 	vec3_t		mins, maxs, move;
 	vec3_t		entorig, pushorig;
-	int			num_moved;
-	edict_t		**moved_edict; //johnfitz -- dynamically allocate
-	vec3_t		*moved_from; //johnfitz -- dynamically allocate
-	int			mark; //johnfitz
+	vec3_t		checkmins, checkmaxs;
+	int			num_moved, num_check;
 
 	if (!pusher->v.velocity[0] && !pusher->v.velocity[1] && !pusher->v.velocity[2])
 	{
@@ -471,6 +492,9 @@ void SV_PushMove (edict_t *pusher, float movetime)
 		move[i] = pusher->v.velocity[i] * movetime;
 		mins[i] = pusher->v.absmin[i] + move[i];
 		maxs[i] = pusher->v.absmax[i] + move[i];
+	// anything that can be pushed touches the old or the new box, riders too
+		checkmins[i] = q_min (pusher->v.absmin[i], mins[i]);
+		checkmaxs[i] = q_max (pusher->v.absmax[i], maxs[i]);
 	}
 
 	VectorCopy (pusher->v.origin, pushorig);
@@ -481,17 +505,26 @@ void SV_PushMove (edict_t *pusher, float movetime)
 	pusher->v.ltime += movetime;
 	SV_LinkEdict (pusher, false);
 
-	//johnfitz -- dynamically allocate
-	mark = Hunk_LowMark ();
-	moved_edict = (edict_t **) Hunk_Alloc (sv.num_edicts*sizeof(edict_t *));
-	moved_from = (vec3_t *) Hunk_Alloc (sv.num_edicts*sizeof(vec3_t));
-	//johnfitz
+	if (push_maxedicts < sv.num_edicts)
+	{
+		push_maxedicts = sv.max_edicts;
+		push_check = (edict_t **) realloc (push_check, push_maxedicts*sizeof(edict_t *));
+		moved_edict = (edict_t **) realloc (moved_edict, push_maxedicts*sizeof(edict_t *));
+		moved_from = (vec3_t *) realloc (moved_from, push_maxedicts*sizeof(vec3_t));
+		if (!push_check || !moved_edict || !moved_from)
+			Sys_Error ("SV_PushMove: out of memory");
+	}
+
+// the area tree only hands back the edicts near the pusher, so put them
+// in edict order to push them in the same order as a walk over all edicts
+	num_check = SV_AreaEdicts (checkmins, checkmaxs, push_check, push_maxedicts, AREA_SOLID | AREA_TRIGGERS | AREA_NONSOLID);
+	qsort (push_check, num_check, sizeof(edict_t *), SV_EdictOrder);
 
 // see if any solid entities are inside the final position
 	num_moved = 0;
-	check = NEXT_EDICT(sv.edicts);
-	for (e=1 ; e<sv.num_edicts ; e++, check = NEXT_EDICT(check))
+	for (e=0 ; e<num_check ; e++)
 	{
+		check = push_check[e];
 		if (check->free)
 			continue;
 		if (check->v.movetype == MOVETYPE_PUSH
@@ -518,7 +551,10 @@ void SV_PushMove (edict_t *pusher, float movetime)
 
 	// remove the onground flag for non-players
 		if (check->v.movetype != MOVETYPE_WALK)
+		{
 			check->v.flags = (int)check->v.flags & ~FL_ONGROUND;
+			ED_HotDirty (check);
+		}
 
 		VectorCopy (check->v.origin, entorig);
 		VectorCopy (check->v.origin, moved_from[num_moved]);
@@ -568,13 +604,9 @@ void SV_PushMove (edict_t *pusher, float movetime)
 				VectorCopy (moved_from[i], moved_edict[i]->v.origin);
 				SV_LinkEdict (moved_edict[i], false);
 			}
-			Hunk_FreeToLowMark (mark); //johnfitz
 			return;
 		}
 	}
-
-	Hunk_FreeToLowMark (mark); //johnfitz
-
 }
 
 /*
@@ -1181,6 +1213,499 @@ void SV_Physics_Step (edict_t *ent)
 
 //============================================================================
 
+/*
+================
+SV_EdictIdle
+
+True if running physics on a non-client edict with these fields would do
+nothing this frame: no think is due and the movetype has nothing to do
+without one.  Anything left over from the last visit (sendinterval) stays
+correct while these fields don't change.
+================
+*/
+static qboolean SV_EdictIdle (int movetype, int flags, float nextthink)
+{
+	if (nextthink > 0 && nextthink <= sv.time + host_frametime)
+		return false;	// think is due
+
+	return ED_HotSleepable (movetype, flags);
+}
+
+/*
+================
+SV_HotFieldBench_f
+
+Times the idle edict filter of SV_Physics reading the edicts themselves
+against reading the hot field mirror
+================
+*/
+void SV_HotFieldBench_f (void)
+{
+	int		i, pass, passes, idle_ent, idle_hot;
+	double	start, time_ent, time_hot;
+	edict_t	*ent;
+
+	if (!sv.active)
+	{
+		Con_Printf ("Not running a server\n");
+		return;
+	}
+	if (!ed_hot.count)
+	{
+		Con_Printf ("Hot field mirror is off (set sv_hotfields 1 and reload the map)\n");
+		return;
+	}
+
+	passes = (Cmd_Argc() > 1) ? q_max (1, atoi (Cmd_Argv(1))) : 1000;
+
+	for (i = 0, ent = sv.edicts; i < sv.num_edicts; i++, ent = NEXT_EDICT(ent))
+		ED_HotRefresh (ent, i);
+
+	idle_ent = 0;
+	start = Sys_DoubleTime ();
+	for (pass = 0; pass < passes; pass++)
+	{
+		ent = EDICT_NUM(svs.maxclients + 1);
+		for (i = svs.maxclients + 1; i < sv.num_edicts; i++, ent = NEXT_EDICT(ent))
+		{
+			if (ent->free || SV_EdictIdle ((int)ent->v.movetype, (int)ent->v.flags, ent->v.nextthink))
+				idle_ent++;
+		}
+	}
+	time_ent = Sys_DoubleTime () - start;
+
+	idle_hot = 0;
+	start = Sys_DoubleTime ();
+	for (pass = 0; pass < passes; pass++)
+	{
+		for (i = svs.maxclients + 1; i < sv.num_edicts; i++)
+		{
+			if (ed_hot.free[i] || SV_EdictIdle (ed_hot.movetype[i], ed_hot.flags[i], ed_hot.nextthink[i]))
+				idle_hot++;
+		}
+	}
+	time_hot = Sys_DoubleTime () - start;
+
+	Con_Printf ("%i edicts, %i idle, %i passes\n", sv.num_edicts, idle_ent / passes, passes);
+	Con_Printf ("edicts: %7.3f us/pass, %i bytes/edict\n", time_ent * 1000000.0 / passes, pr_edict_size);
+	Con_Printf ("mirror: %7.3f us/pass, %i bytes/edict\n", time_hot * 1000000.0 / passes,
+		(int)(2 * sizeof(byte) + sizeof(byte) + sizeof(int) + 2 * sizeof(float)));
+	if (idle_ent != idle_hot)
+		Con_Printf ("mismatch: %i vs %i idle\n", idle_ent, idle_hot);
+}
+
+/*
+===============================================================================
+
+DORMANT REGIONS
+
+===============================================================================
+*/
+
+/*
+With sv_dormant N, edicts that no client can see and that are only
+waiting for their next think (ED_HotSleepable) have that think held
+back to the next of N ticks a second, so monsters far from every player
+stop running their AI each frame.  The ticks of different edicts are
+spread over the frames.  A held back think runs late, with its time
+clamped to sv.time as SV_RunThink does for any late think.
+
+An edict is never held back when it is a trigger, when it is not linked
+into any leaf (delayed SUB_UseTargets relays have no model) or into too
+many to tell, when its enemy or goalentity is a client, or when it sets
+a "nodormant" float field.  Nothing is held back while the progs'
+sight_entity_time is under 0.1 seconds old either: id1's FindTarget
+wakes every monster that thinks inside that window when one of them
+spots a player, and a held think would miss it.
+*/
+
+static	byte	*dormant_pvs;		// what any client can see, this frame
+static	int		dormant_pvsbytes;
+static	qboolean	dormant_active;
+static	int		dormant_fieldofs;	// of .float nodormant, 0 if the progs has none
+static	int		dormant_sightofs;	// of the sight_entity_time global, 0 if none
+static	int		dormant_held;		// for sv_physstats
+
+/*
+================
+SV_FindDormant
+
+Merges the fat PVS of every spawned client
+================
+*/
+static void SV_FindDormant (void)
+{
+	client_t	*client;
+	ddef_t	*def;
+	byte	*pvs;
+	int		i, j, row, clients;
+
+	dormant_active = false;
+	if (sv_dormant.value <= 0 || sv.state != ss_active || pr_global_struct->force_retouch)
+		return;
+
+	row = (sv.worldmodel->numleafs+7)>>3;
+	if (row > dormant_pvsbytes)
+	{
+		dormant_pvsbytes = row;
+		dormant_pvs = (byte *) realloc (dormant_pvs, dormant_pvsbytes);
+		if (!dormant_pvs)
+			Sys_Error ("SV_FindDormant: realloc() failed on %d bytes", dormant_pvsbytes);
+	}
+	memset (dormant_pvs, 0, row);
+
+	clients = 0;
+	for (i = 0, client = svs.clients; i < svs.maxclients; i++, client++)
+	{
+		if (!client->active || !client->spawned)
+			continue;
+		pvs = SV_ClientFatPVS (client->edict);
+		for (j = 0; j < row; j++)
+			dormant_pvs[j] |= pvs[j];
+		clients++;
+	}
+	if (!clients)
+		return;		// nobody to be unseen by yet
+
+	def = ED_FindField ("nodormant");
+	dormant_fieldofs = def ? def->ofs : 0;
+	def = ED_FindGlobal ("sight_entity_time");
+	dormant_sightofs = (def && (def->type & ~DEF_SAVEGLOBAL) == ev_float) ? def->ofs : 0;
+	dormant_active = true;
+}
+
+/*
+================
+SV_IsClientEdict
+
+================
+*/
+static qboolean SV_IsClientEdict (int prog)
+{
+	int		num;
+
+	num = NUM_FOR_EDICT(PROG_TO_EDICT(prog));
+	return num >= 1 && num <= svs.maxclients;
+}
+
+/*
+================
+SV_HoldDormant
+
+True if ent sits this frame out
+================
+*/
+static qboolean SV_HoldDormant (edict_t *ent, int i)
+{
+	double	phase;
+	int		j, leaf;
+
+	if (!ED_HotSleepable ((int)ent->v.movetype, (int)ent->v.flags))
+		return false;
+	if (ent->v.solid == SOLID_TRIGGER)
+		return false;
+	if (dormant_sightofs && G_FLOAT(dormant_sightofs) >= sv.time - 0.1)
+		return false;	// a monster may have just woken its group
+	if (!ent->num_leafs || ent->num_leafs == MAX_ENT_LEAFS)
+		return false;
+
+// run on the frames that cross one of its ticks
+	phase = i * 0.6180339887;
+	phase -= floor (phase);
+	if (floor (sv.time * sv_dormant.value + phase) != floor ((sv.time - host_frametime) * sv_dormant.value + phase))
+		return false;
+
+	if (SV_IsClientEdict (ent->v.enemy) || SV_IsClientEdict (ent->v.goalentity))
+		return false;
+	if (dormant_fieldofs && ((eval_t *)((char *)&ent->v + dormant_fieldofs*4))->_float)
+		return false;
+
+	for (j = 0; j < ent->num_leafs; j++)
+	{
+		leaf = ent->leafnums[j];
+		if (dormant_pvs[leaf >> 3] & (1 << (leaf & 7)))
+			return false;
+	}
+
+	dormant_held++;
+	return true;
+}
+
+/*
+================
+SV_PhysicsEdict
+
+Runs one edict's physics for this frame
+================
+*/
+static void SV_PhysicsEdict (edict_t *ent, int i)
+{
+	if (ent->free)
+	{
+		if (ed_hot.count)
+			ED_HotRefresh (ent, i);
+		return;
+	}
+
+	if (dormant_active && i > svs.maxclients && SV_HoldDormant (ent, i))
+	{
+		if (ed_hot.count)
+			ED_HotRefresh (ent, i);	// queues the held back think again
+		return;
+	}
+
+	if (pr_global_struct->force_retouch)
+	{
+		SV_LinkEdict (ent, true);	// force retouch even for stationary
+	}
+
+	if (i > 0 && i <= svs.maxclients)
+		SV_Physics_Client (ent, i);
+	else if (ent->v.movetype == MOVETYPE_PUSH)
+		SV_Physics_Pusher (ent);
+	else if (ent->v.movetype == MOVETYPE_NONE)
+		SV_Physics_None (ent);
+	else if (ent->v.movetype == MOVETYPE_NOCLIP)
+		SV_Physics_Noclip (ent);
+	else if (ent->v.movetype == MOVETYPE_STEP)
+		SV_Physics_Step (ent);
+	else if (ent->v.movetype == MOVETYPE_TOSS
+	|| ent->v.movetype == MOVETYPE_GIB
+	|| ent->v.movetype == MOVETYPE_BOUNCE
+	|| ent->v.movetype == MOVETYPE_FLY
+	|| ent->v.movetype == MOVETYPE_FLYMISSILE)
+		SV_Physics_Toss (ent);
+	else
+		Sys_Error ("SV_Physics: bad movetype %i", (int)ent->v.movetype);
+
+//johnfitz -- PROTOCOL_FITZQUAKE
+//capture interval to nextthink here and send it to client for better
+//lerp timing, but only if interval is not 0.1 (which client assumes)
+	ent->sendinterval = false;
+	if (!ent->free && ent->v.nextthink > sv.time && (ent->v.movetype == MOVETYPE_STEP || ent->v.movetype == MOVETYPE_WALK || ent->v.frame != ent->oldframe))
+	{
+		int j = Q_rint((ent->v.nextthink-ent->oldthinktime)*255);
+		if (j >= 0 && j < 256 && j != 25 && j != 26) //25 and 26 are close enough to 0.1 to not send
+			ent->sendinterval = true;
+	}
+//johnfitz
+
+	if (ed_hot.count)
+		ED_HotRefresh (ent, i);
+}
+
+/*
+===============================================================================
+
+PARALLEL PHYSICS
+
+===============================================================================
+*/
+
+/*
+With sv_physjobs 1, a frame is run in two phases.  First the moves
+that the tossed edicts (toss, gib, bounce, fly and missiles) will make
+are predicted and traced on the job pool against the world as it is
+after StartFrame; then SV_Physics runs exactly as usual, in edict order,
+with every link, touch and QC call on the main thread, and SV_PushEntity
+only takes a traced move that SV_SpeculatedMove proves is still what
+SV_Move would return.  The results are the same as with sv_physjobs 0.
+*/
+
+static	movespec_t	*phys_specs;
+static	int			phys_numspecs, phys_maxspecs;
+static	int			*phys_specindex;	// edict number -> spec + 1
+static	int			phys_specindexsize;
+
+static	struct
+{
+	int		traced, used, retraced;
+} physstats;
+
+/*
+================
+SV_TraceMoves
+
+================
+*/
+static void SV_TraceMoves (jobctx_t *ctx, void *data, int first, int last)
+{
+	int		i;
+
+	for (i = first; i < last; i++)
+		SV_SpeculateMove (&phys_specs[i]);
+}
+
+/*
+================
+SV_PredictToss
+
+Fills in the SV_PushEntity move SV_Physics_Toss will make for ent, if
+nothing changes it first.  False when the edict thinks first or will not
+move.
+================
+*/
+static qboolean SV_PredictToss (edict_t *ent, movespec_t *spec)
+{
+	vec3_t	velocity, move;
+	float	ent_gravity;
+	eval_t	*val;
+	int		i;
+
+	if (ent->v.nextthink > 0 && ent->v.nextthink <= sv.time + host_frametime)
+		return false;
+	if ((int)ent->v.flags & FL_ONGROUND)
+		return false;
+
+// SV_CheckVelocity
+	for (i=0 ; i<3 ; i++)
+	{
+		if (IS_NAN(ent->v.velocity[i]) || IS_NAN(ent->v.origin[i]))
+			return false;
+		velocity[i] = ent->v.velocity[i];
+		if (velocity[i] > sv_maxvelocity.value)
+			velocity[i] = sv_maxvelocity.value;
+		else if (velocity[i] < -sv_maxvelocity.value)
+			velocity[i] = -sv_maxvelocity.value;
+	}
+
+// SV_AddGravity
+	if (ent->v.movetype != MOVETYPE_FLY
+	&& ent->v.movetype != MOVETYPE_FLYMISSILE)
+	{
+		val = GetEdictFieldValue(ent, "gravity");
+		if (val && val->_float)
+			ent_gravity = val->_float;
+		else
+			ent_gravity = 1.0;
+		velocity[2] -= ent_gravity * sv_gravity.value * host_frametime;
+	}
+
+	VectorScale (velocity, host_frametime, move);
+	VectorCopy (ent->v.origin, spec->start);
+	VectorAdd (ent->v.origin, move, spec->end);
+	VectorCopy (ent->v.mins, spec->mins);
+	VectorCopy (ent->v.maxs, spec->maxs);
+	spec->type = SV_PushEntityType (ent);
+	spec->passedict = ent;
+	return true;
+}
+
+/*
+================
+SV_SpeculatePhysics
+
+The parallel phase
+================
+*/
+static void SV_SpeculatePhysics (int entity_cap)
+{
+	edict_t	*ent;
+	int		i;
+
+	if (phys_specindexsize < sv.max_edicts)
+	{
+		free (phys_specindex);
+		phys_specindexsize = sv.max_edicts;
+		phys_specindex = (int *) calloc (phys_specindexsize, sizeof(int));
+		if (!phys_specindex)
+			Sys_Error ("SV_SpeculatePhysics: out of memory");
+	}
+
+	phys_numspecs = 0;
+	for (i = svs.maxclients + 1; i < entity_cap; i++)
+	{
+		ent = EDICT_NUM(i);
+		if (ent->free)
+			continue;
+		if (ent->v.movetype != MOVETYPE_TOSS
+		&& ent->v.movetype != MOVETYPE_GIB
+		&& ent->v.movetype != MOVETYPE_BOUNCE
+		&& ent->v.movetype != MOVETYPE_FLY
+		&& ent->v.movetype != MOVETYPE_FLYMISSILE)
+			continue;
+
+		if (phys_numspecs == phys_maxspecs)
+		{
+			phys_maxspecs = phys_maxspecs ? phys_maxspecs * 2 : 64;
+			phys_specs = (movespec_t *) realloc (phys_specs, phys_maxspecs * sizeof(movespec_t));
+			if (!phys_specs)
+				Sys_Error ("SV_SpeculatePhysics: out of memory");
+		}
+		if (!SV_PredictToss (ent, &phys_specs[phys_numspecs]))
+			continue;
+		phys_specindex[i] = ++phys_numspecs;
+	}
+
+	if (!phys_numspecs)
+		return;
+
+	sv_speculating = true;
+	Jobs_Run ("physics", SV_TraceMoves, NULL, phys_numspecs, 16, 0);
+	sv_speculating = false;
+
+	physstats.traced += phys_numspecs;
+	SV_BeginSpeculation ();
+}
+
+/*
+================
+SV_FinishSpeculation
+
+Also run at the start of a frame, in case the last one was aborted
+================
+*/
+static void SV_FinishSpeculation (void)
+{
+	SV_EndSpeculation ();
+	if (phys_numspecs)
+		memset (phys_specindex, 0, phys_specindexsize * sizeof(int));
+	phys_numspecs = 0;
+}
+
+/*
+================
+SV_SpeculatedPush
+
+The serial phase side, for SV_PushEntity
+================
+*/
+static qboolean SV_SpeculatedPush (edict_t *ent, vec3_t end, int type, trace_t *trace)
+{
+	int		num;
+
+	if (!phys_numspecs)
+		return false;
+
+	num = NUM_FOR_EDICT(ent);
+	if (!phys_specindex[num])
+		return false;
+
+	if (SV_SpeculatedMove (&phys_specs[phys_specindex[num] - 1], ent->v.origin, ent->v.mins, ent->v.maxs, end, type, ent, trace))
+	{
+		physstats.used++;
+		return true;
+	}
+	physstats.retraced++;
+	return false;
+}
+
+/*
+================
+SV_PhysStats_f
+
+Prints and resets how many speculated moves were used, and how many
+edicts sv_dormant held back
+================
+*/
+void SV_PhysStats_f (void)
+{
+	Con_Printf ("%i moves traced ahead, %i used, %i traced again\n", physstats.traced, physstats.used, physstats.retraced);
+	Con_Printf ("%i edict frames held back in dormant regions\n", dormant_held);
+	memset (&physstats, 0, sizeof(physstats));
+	dormant_held = 0;
+}
+
 /*
 ================
 SV_Physics
@@ -1193,6 +1718,8 @@ void SV_Physics (void)
 	int	entity_cap; // For sv_freezenonclients 
 	edict_t	*ent;
 
+	SV_InvalidateTraces ();
+
 // let the progs know that a new frame has started
 	pr_global_struct->self = EDICT_TO_PROG(sv.edicts);
 	pr_global_struct->other = EDICT_TO_PROG(sv.edicts);
@@ -1201,6 +1728,8 @@ void SV_Physics (void)
 
 //SV_CheckAllEnts ();
 
+	ED_TrimFreeEdicts ();
+
 //
 // treat each object in turn
 //
@@ -1211,48 +1740,29 @@ void SV_Physics (void)
 	else
 	  entity_cap = sv.num_edicts;
 
-	//for (i=0 ; i<sv.num_edicts ; i++, ent = NEXT_EDICT(ent))
-	for (i=0 ; i<entity_cap ; i++, ent = NEXT_EDICT(ent))
-	{
-		if (ent->free)
-			continue;
-
-		if (pr_global_struct->force_retouch)
-		{
-			SV_LinkEdict (ent, true);	// force retouch even for stationary
-		}
-
-		if (i > 0 && i <= svs.maxclients)
-			SV_Physics_Client (ent, i);
-		else if (ent->v.movetype == MOVETYPE_PUSH)
-			SV_Physics_Pusher (ent);
-		else if (ent->v.movetype == MOVETYPE_NONE)
-			SV_Physics_None (ent);
-		else if (ent->v.movetype == MOVETYPE_NOCLIP)
-			SV_Physics_Noclip (ent);
-		else if (ent->v.movetype == MOVETYPE_STEP)
-			SV_Physics_Step (ent);
-		else if (ent->v.movetype == MOVETYPE_TOSS
-		|| ent->v.movetype == MOVETYPE_GIB
-		|| ent->v.movetype == MOVETYPE_BOUNCE
-		|| ent->v.movetype == MOVETYPE_FLY
-		|| ent->v.movetype == MOVETYPE_FLYMISSILE)
-			SV_Physics_Toss (ent);
-		else
-			Sys_Error ("SV_Physics: bad movetype %i", (int)ent->v.movetype);
+	SV_FinishSpeculation ();
+	if (sv_physjobs.value && !pr_global_struct->force_retouch)
+		SV_SpeculatePhysics (entity_cap);
+	SV_FindDormant ();
 
-	//johnfitz -- PROTOCOL_FITZQUAKE
-	//capture interval to nextthink here and send it to client for better
-	//lerp timing, but only if interval is not 0.1 (which client assumes)
-		ent->sendinterval = false;
-		if (!ent->free && ent->v.nextthink > sv.time && (ent->v.movetype == MOVETYPE_STEP || ent->v.movetype == MOVETYPE_WALK || ent->v.frame != ent->oldframe))
-		{
-			int j = Q_rint((ent->v.nextthink-ent->oldthinktime)*255);
-			if (j >= 0 && j < 256 && j != 25 && j != 26) //25 and 26 are close enough to 0.1 to not send
-				ent->sendinterval = true;
-		}
-	//johnfitz
+	if (ed_hot.count && !pr_global_struct->force_retouch)
+	{
+	// think scheduler: the world and clients, then only the awake edicts
+	// and the sleeping ones whose think is due, still in edict order
+		ED_HotWakeDue (sv.time + host_frametime);
+		for (i=0 ; i<entity_cap && i<=svs.maxclients ; i++, ent = NEXT_EDICT(ent))
+			SV_PhysicsEdict (ent, i);
+		for (i = ED_HotNextActive (svs.maxclients, entity_cap) ; i<entity_cap ; i = ED_HotNextActive (i, entity_cap))
+			SV_PhysicsEdict (EDICT_NUM(i), i);
 	}
+	else
+	{
+		//for (i=0 ; i<sv.num_edicts ; i++, ent = NEXT_EDICT(ent))
+		for (i=0 ; i<entity_cap ; i++, ent = NEXT_EDICT(ent))
+			SV_PhysicsEdict (ent, i);
+	}
+
+	SV_FinishSpeculation ();
 
 	if (pr_global_struct->force_retouch)
 		pr_global_struct->force_retouch--;
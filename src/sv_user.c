@@ -470,6 +470,8 @@ void SV_ReadClientMove (usercmd_t *move)
 	i = MSG_ReadByte ();
 	if (i)
 		host_client->edict->v.impulse = i;
+
+	SV_LockstepRecordMove (angle, move, bits, i);
 }
 
 /*
@@ -485,6 +487,9 @@ qboolean SV_ReadClientMessage (void)
 	int		ccmd;
 	const char	*s;
 
+	if (!host_client->netconnection)
+		return SV_LockstepReadClient ();
+
 	do
 	{
 nextmsg:
@@ -570,7 +575,10 @@ nextmsg:
 					ret = 1;
 
 				if (ret == 1)
+				{
+					SV_LockstepRecordCommand (s);
 					Cmd_ExecuteString (s, src_client);
+				}
 				else
 					Con_DPrintf("%s tried to %s\n", host_client->name, s);
 				break;
@@ -608,6 +616,7 @@ void SV_RunClients (void)
 
 		if (!SV_ReadClientMessage ())
 		{
+			SV_LockstepRecordDrop ();
 			SV_DropClient (false);	// client misbehaved...
 			continue;
 		}
@@ -42,10 +42,16 @@ typedef struct
 	trace_t		trace;
 	int			type;
 	edict_t		*passedict;
+	int			hullchecks;		// SV_RecursiveHullCheck calls, for sv_tracestats
+	movespec_t	*spec;			// run ahead by the physics jobs, may not error
+	qboolean	failed;			// spec hit something only the main thread may report
 } moveclip_t;
 
 
-int SV_HullPointContents (hull_t *hull, int num, vec3_t p);
+static qboolean SV_SpecTouch (movespec_t *spec, edict_t *ent);
+static void SV_BatchLinked (edict_t *ent);
+static void SV_ResetMoveBatch (void);
+static void SV_DirtyBox (float x0, float y0, float z0, float x1, float y1, float z1);
 
 /*
 ===============================================================================
@@ -59,6 +65,15 @@ HULL BOXES
 static	hull_t		box_hull;
 static	mclipnode_t	box_clipnodes[6]; //johnfitz -- was dclipnode_t
 static	mplane_t	box_planes[6];
+static	mhullnode_t	box_nodes[6];
+
+// each trace fills in its own copy of the box nodes, so the physics jobs
+// can clip against boxes at the same time
+typedef struct
+{
+	hull_t		hull;
+	mhullnode_t	nodes[6];
+} boxhull_t;
 
 /*
 ===================
@@ -70,11 +85,13 @@ can just be stored out and get a proper hull_t structure.
 */
 void SV_InitBoxHull (void)
 {
+	// box_planes never get their dists, the traces only read the nodes
 	int		i;
 	int		side;
 
 	box_hull.clipnodes = box_clipnodes;
 	box_hull.planes = box_planes;
+	box_hull.nodes = box_nodes;
 	box_hull.firstclipnode = 0;
 	box_hull.lastclipnode = 5;
 
@@ -92,6 +109,12 @@ void SV_InitBoxHull (void)
 
 		box_planes[i].type = i>>1;
 		box_planes[i].normal[i>>1] = 1;
+
+		box_nodes[i].type = i>>1;
+		box_nodes[i].normal[i>>1] = 1;
+		box_nodes[i].children[0] = box_clipnodes[i].children[0];
+		box_nodes[i].children[1] = box_clipnodes[i].children[1];
+		box_nodes[i].planenum = i;
 	}
 
 }
@@ -105,16 +128,20 @@ To keep everything totally uniform, bounding boxes are turned into small
 BSP trees instead of being compared directly.
 ===================
 */
-hull_t	*SV_HullForBox (vec3_t mins, vec3_t maxs)
+static hull_t *SV_HullForBox (vec3_t mins, vec3_t maxs, boxhull_t *box)
 {
-	box_planes[0].dist = maxs[0];
-	box_planes[1].dist = mins[0];
-	box_planes[2].dist = maxs[1];
-	box_planes[3].dist = mins[1];
-	box_planes[4].dist = maxs[2];
-	box_planes[5].dist = mins[2];
-
-	return &box_hull;
+	box->hull = box_hull;
+	box->hull.nodes = box->nodes;
+	memcpy (box->nodes, box_nodes, sizeof(box->nodes));
+
+	box->nodes[0].dist = maxs[0];
+	box->nodes[1].dist = mins[0];
+	box->nodes[2].dist = maxs[1];
+	box->nodes[3].dist = mins[1];
+	box->nodes[4].dist = maxs[2];
+	box->nodes[5].dist = mins[2];
+
+	return &box->hull;
 }
 
 
@@ -127,9 +154,10 @@ Returns a hull that can be used for testing or clipping an object of mins/maxs
 size.
 Offset is filled in to contain the adjustment that must be added to the
 testing object's origin to get a point to use with the returned hull.
+A bad brush entity returns NULL instead of an error when noerror is set.
 ================
 */
-hull_t *SV_HullForEntity (edict_t *ent, vec3_t mins, vec3_t maxs, vec3_t offset)
+static hull_t *SV_HullForEntity (edict_t *ent, vec3_t mins, vec3_t maxs, vec3_t offset, boxhull_t *box, qboolean noerror)
 {
 	qmodel_t	*model;
 	vec3_t		size;
@@ -139,12 +167,16 @@ hull_t *SV_HullForEntity (edict_t *ent, vec3_t mins, vec3_t maxs, vec3_t offset)
 // decide which clipping hull to use, based on the size
 	if (ent->v.solid == SOLID_BSP)
 	{	// explicit hulls in the BSP model
+		if (ent->v.movetype != MOVETYPE_PUSH && noerror)
+			return NULL;
 		if (ent->v.movetype != MOVETYPE_PUSH)
 			Host_Error ("SOLID_BSP without MOVETYPE_PUSH (%s at %f %f %f)",
 				    PR_GetString(ent->v.classname), ent->v.origin[0], ent->v.origin[1], ent->v.origin[2]);
 
 		model = sv.models[ (int)ent->v.modelindex ];
 
+		if ((!model || model->type != mod_brush) && noerror)
+			return NULL;
 		if (!model || model->type != mod_brush)
 			Host_Error ("SOLID_BSP with a non bsp model (%s at %f %f %f)",
 				    PR_GetString(ent->v.classname), ent->v.origin[0], ent->v.origin[1], ent->v.origin[2]);
@@ -166,7 +198,7 @@ hull_t *SV_HullForEntity (edict_t *ent, vec3_t mins, vec3_t maxs, vec3_t offset)
 
 		VectorSubtract (ent->v.mins, maxs, hullmins);
 		VectorSubtract (ent->v.maxs, mins, hullmaxs);
-		hull = SV_HullForBox (hullmins, hullmaxs);
+		hull = SV_HullForBox (hullmins, hullmaxs, box);
 
 		VectorCopy (ent->v.origin, offset);
 	}
@@ -183,20 +215,47 @@ ENTITY AREA CHECKING
 ===============================================================================
 */
 
+/*
+The area tree starts as a single leaf and splits a leaf, on the longest
+axis of its bounds (Z included), whenever it holds more than splitat
+edicts.  An edict lives in the first node its box crosses.  Each node
+keeps its solid and trigger edicts as columns of the abs box, edict
+number and solid type cached at link time, so the box rejects test four
+edicts at a time (SSE2 / NEON) and never touch the edicts themselves.
+SOLID_NOT edicts are kept in a third list that only SV_AreaEdicts looks
+at; it stays where it is when a leaf splits.  Every edict remembers its
+slot, and unlinking moves the last entry of the list into the hole.
+*/
+
+typedef struct
+{
+	float	*box[6];		// absmin[0..2], absmax[0..2]; box[0] owns the block
+	int		*edictnum;
+	int		*solid;
+	int		numents, maxents;	// maxents is a multiple of 4
+} arealist_t;
+
 typedef struct areanode_s
 {
 	int		axis;		// -1 = leaf node
 	float	dist;
 	struct areanode_s	*children[2];
-	link_t	trigger_edicts;
-	link_t	solid_edicts;
+	vec3_t	mins, maxs;
+	int		depth;
+	int		splitat;	// split the leaf once it holds this many edicts
+	arealist_t	trigger_edicts;
+	arealist_t	solid_edicts;
+	arealist_t	nonsolid_edicts;
 } areanode_t;
 
-#define	AREA_DEPTH	4
-#define	AREA_NODES	32
+#define	AREA_MAXDEPTH	12
+#define	AREA_NODES		1024
+#define	AREA_SPLIT		16		// edicts in a leaf before it splits
+#define	AREA_MINSIZE	128		// don't split nodes narrower than this
 
 static	areanode_t	sv_areanodes[AREA_NODES];
 static	int			sv_numareanodes;
+static	int			sv_areasplits;
 
 /*
 ===============
@@ -204,43 +263,290 @@ SV_CreateAreaNode
 
 ===============
 */
-areanode_t *SV_CreateAreaNode (int depth, vec3_t mins, vec3_t maxs)
+static areanode_t *SV_CreateAreaNode (int depth, const vec3_t mins, const vec3_t maxs)
 {
 	areanode_t	*anode;
-	vec3_t		size;
-	vec3_t		mins1, maxs1, mins2, maxs2;
 
 	anode = &sv_areanodes[sv_numareanodes];
 	sv_numareanodes++;
 
-	ClearLink (&anode->trigger_edicts);
-	ClearLink (&anode->solid_edicts);
+	memset (anode, 0, sizeof(*anode));
+	anode->axis = -1;
+	anode->depth = depth;
+	anode->splitat = AREA_SPLIT;
+	VectorCopy (mins, anode->mins);
+	VectorCopy (maxs, anode->maxs);
+
+	return anode;
+}
+
+/*
+===============
+SV_AreaListGrow
+
+The columns share one zeroed block, padded so that a four wide load
+starting at any multiple of 4 below numents stays inside it.
+===============
+*/
+static void SV_AreaListGrow (arealist_t *list)
+{
+	float	*block;
+	int		*ints;
+	int		j, maxents;
 
-	if (depth == AREA_DEPTH)
+	maxents = list->maxents ? list->maxents * 2 : 8;
+	block = (float *) calloc (maxents, 6 * sizeof(float) + 2 * sizeof(int));
+	if (!block)
+		Sys_Error ("SV_AreaListGrow: out of memory");
+	ints = (int *)(block + 6 * maxents);
+
+	if (list->numents)
 	{
-		anode->axis = -1;
-		anode->children[0] = anode->children[1] = NULL;
-		return anode;
+		for (j = 0; j < 6; j++)
+			memcpy (block + j * maxents, list->box[j], list->numents * sizeof(float));
+		memcpy (ints, list->edictnum, list->numents * sizeof(int));
+		memcpy (ints + maxents, list->solid, list->numents * sizeof(int));
 	}
+	free (list->box[0]);
 
-	VectorSubtract (maxs, mins, size);
-	if (size[0] > size[1])
-		anode->axis = 0;
-	else
-		anode->axis = 1;
+	for (j = 0; j < 6; j++)
+		list->box[j] = block + j * maxents;
+	list->edictnum = ints;
+	list->solid = ints + maxents;
+	list->maxents = maxents;
+}
+
+/*
+===============
+SV_AreaListAdd
+
+Returns the slot the edict went into
+===============
+*/
+static int SV_AreaListAdd (arealist_t *list, const vec3_t absmin, const vec3_t absmax, int edictnum, int solid)
+{
+	int		i;
 
-	anode->dist = 0.5 * (maxs[anode->axis] + mins[anode->axis]);
-	VectorCopy (mins, mins1);
-	VectorCopy (mins, mins2);
-	VectorCopy (maxs, maxs1);
-	VectorCopy (maxs, maxs2);
+	if (list->numents == list->maxents)
+		SV_AreaListGrow (list);
+
+	i = list->numents++;
+	list->box[0][i] = absmin[0];
+	list->box[1][i] = absmin[1];
+	list->box[2][i] = absmin[2];
+	list->box[3][i] = absmax[0];
+	list->box[4][i] = absmax[1];
+	list->box[5][i] = absmax[2];
+	list->edictnum[i] = edictnum;
+	list->solid[i] = solid;
+	return i;
+}
 
-	maxs1[anode->axis] = mins2[anode->axis] = anode->dist;
+/*
+===============
+SV_AreaListMove
 
-	anode->children[0] = SV_CreateAreaNode (depth+1, mins2, maxs2);
-	anode->children[1] = SV_CreateAreaNode (depth+1, mins1, maxs1);
+Copies entry "from" of one list over entry "to" of another (or the same)
+===============
+*/
+static void SV_AreaListMove (arealist_t *dst, int to, const arealist_t *src, int from)
+{
+	int		j;
 
-	return anode;
+	for (j = 0; j < 6; j++)
+		dst->box[j][to] = src->box[j][from];
+	dst->edictnum[to] = src->edictnum[from];
+	dst->solid[to] = src->solid[from];
+}
+
+/*
+===============
+SV_AreaListRemove
+
+Fills the slot with the last entry of the list
+===============
+*/
+static void SV_AreaListRemove (arealist_t *list, int slot)
+{
+	int		last;
+
+	last = --list->numents;
+	if (slot != last)
+	{
+		SV_AreaListMove (list, slot, list, last);
+		EDICT_NUM(list->edictnum[slot])->areaslot = slot;
+	}
+}
+
+/*
+===============
+SV_AreaListSplit
+
+Moves the entries that are entirely on one side of the new plane down
+into that child.
+===============
+*/
+static void SV_AreaListSplit (areanode_t *node, qboolean triggers)
+{
+	arealist_t	*list, *dst;
+	areanode_t	*child;
+	int			i, keep;
+
+	keep = 0;
+	list = triggers ? &node->trigger_edicts : &node->solid_edicts;
+	for (i = 0; i < list->numents; i++)
+	{
+		if (list->box[node->axis][i] > node->dist)
+			child = node->children[0];
+		else if (list->box[3 + node->axis][i] < node->dist)
+			child = node->children[1];
+		else
+		{
+			if (keep != i)
+			{
+				SV_AreaListMove (list, keep, list, i);
+				EDICT_NUM(list->edictnum[keep])->areaslot = keep;
+			}
+			keep++;
+			continue;
+		}
+		dst = triggers ? &child->trigger_edicts : &child->solid_edicts;
+		if (dst->numents == dst->maxents)
+			SV_AreaListGrow (dst);
+		SV_AreaListMove (dst, dst->numents, list, i);
+		EDICT_NUM(list->edictnum[i])->areanode = child;
+		EDICT_NUM(list->edictnum[i])->areaslot = dst->numents++;
+	}
+	list->numents = keep;
+}
+
+/*
+===============
+SV_AreaListCull
+
+Returns a bit for each of the (up to 32) entries from first on whose box
+touches mins/maxs.  The vector paths make the same comparisons as the
+scalar one, so a NaN box is kept by all of them.
+===============
+*/
+static qboolean	sv_areascalar;	// sv_movebench compares against the plain loop
+
+static unsigned int SV_AreaListCull (const arealist_t *list, int first, const vec3_t mins, const vec3_t maxs)
+{
+	unsigned int	mask;
+	int		i, count;
+
+	count = q_min (32, list->numents - first);
+	mask = 0;
+
+#if defined(USE_SSE2)
+	if (!sv_areascalar)
+	{
+		__m128	mn0 = _mm_set1_ps (mins[0]), mn1 = _mm_set1_ps (mins[1]), mn2 = _mm_set1_ps (mins[2]);
+		__m128	mx0 = _mm_set1_ps (maxs[0]), mx1 = _mm_set1_ps (maxs[1]), mx2 = _mm_set1_ps (maxs[2]);
+		__m128	out;
+
+		for (i = 0; i < count; i += 4)
+		{
+			out = _mm_cmpgt_ps (mn0, _mm_loadu_ps (list->box[3] + first + i));
+			out = _mm_or_ps (out, _mm_cmpgt_ps (mn1, _mm_loadu_ps (list->box[4] + first + i)));
+			out = _mm_or_ps (out, _mm_cmpgt_ps (mn2, _mm_loadu_ps (list->box[5] + first + i)));
+			out = _mm_or_ps (out, _mm_cmplt_ps (mx0, _mm_loadu_ps (list->box[0] + first + i)));
+			out = _mm_or_ps (out, _mm_cmplt_ps (mx1, _mm_loadu_ps (list->box[1] + first + i)));
+			out = _mm_or_ps (out, _mm_cmplt_ps (mx2, _mm_loadu_ps (list->box[2] + first + i)));
+			mask |= (unsigned int)(~_mm_movemask_ps (out) & 15) << i;
+		}
+		return (count < 32) ? mask & ((1u << count) - 1) : mask;
+	}
+#elif defined(USE_NEON)
+	if (!sv_areascalar)
+	{
+		static const uint32_t	bits[4] = {1, 2, 4, 8};
+		float32x4_t	mn0 = vdupq_n_f32 (mins[0]), mn1 = vdupq_n_f32 (mins[1]), mn2 = vdupq_n_f32 (mins[2]);
+		float32x4_t	mx0 = vdupq_n_f32 (maxs[0]), mx1 = vdupq_n_f32 (maxs[1]), mx2 = vdupq_n_f32 (maxs[2]);
+		uint32x4_t	out, lanes = vld1q_u32 (bits);
+
+		for (i = 0; i < count; i += 4)
+		{
+			out = vcgtq_f32 (mn0, vld1q_f32 (list->box[3] + first + i));
+			out = vorrq_u32 (out, vcgtq_f32 (mn1, vld1q_f32 (list->box[4] + first + i)));
+			out = vorrq_u32 (out, vcgtq_f32 (mn2, vld1q_f32 (list->box[5] + first + i)));
+			out = vorrq_u32 (out, vcltq_f32 (mx0, vld1q_f32 (list->box[0] + first + i)));
+			out = vorrq_u32 (out, vcltq_f32 (mx1, vld1q_f32 (list->box[1] + first + i)));
+			out = vorrq_u32 (out, vcltq_f32 (mx2, vld1q_f32 (list->box[2] + first + i)));
+			mask |= vaddvq_u32 (vbicq_u32 (lanes, out)) << i;
+		}
+		return (count < 32) ? mask & ((1u << count) - 1) : mask;
+	}
+#endif
+
+	for (i = 0; i < count; i++)
+	{
+		if (mins[0] > list->box[3][first + i]
+		|| mins[1] > list->box[4][first + i]
+		|| mins[2] > list->box[5][first + i]
+		|| maxs[0] < list->box[0][first + i]
+		|| maxs[1] < list->box[1][first + i]
+		|| maxs[2] < list->box[2][first + i] )
+			continue;
+		mask |= 1u << i;
+	}
+	return mask;
+}
+
+/*
+===============
+SV_SplitAreaNode
+
+Only splits when enough of the leaf would actually move down, otherwise
+waits until it has grown some more.
+===============
+*/
+static void SV_SplitAreaNode (areanode_t *node)
+{
+	vec3_t	size, mins, maxs;
+	arealist_t	*list;
+	float	dist;
+	int		axis, i, j, total, movable;
+
+	VectorSubtract (node->maxs, node->mins, size);
+	axis = (size[0] >= size[1]) ? 0 : 1;
+	if (size[2] > size[axis])
+		axis = 2;
+	dist = 0.5 * (node->maxs[axis] + node->mins[axis]);
+
+	total = node->solid_edicts.numents + node->trigger_edicts.numents;
+	movable = 0;
+	for (j = 0; j < 2; j++)
+	{
+		list = j ? &node->trigger_edicts : &node->solid_edicts;
+		for (i = 0; i < list->numents; i++)
+		{
+			if (list->box[axis][i] > dist || list->box[3 + axis][i] < dist)
+				movable++;
+		}
+	}
+
+	if (node->depth >= AREA_MAXDEPTH || size[axis] < AREA_MINSIZE
+		|| sv_numareanodes + 2 > AREA_NODES || movable * 2 < total)
+	{
+		node->splitat = total * 2;
+		return;
+	}
+
+	node->axis = axis;
+	node->dist = dist;
+	sv_areasplits++;	// changes the order the clips visit edicts in
+
+	VectorCopy (node->mins, mins);
+	VectorCopy (node->maxs, maxs);
+	mins[axis] = dist;
+	node->children[0] = SV_CreateAreaNode (node->depth + 1, mins, node->maxs);
+	maxs[axis] = dist;
+	node->children[1] = SV_CreateAreaNode (node->depth + 1, node->mins, maxs);
+
+	SV_AreaListSplit (node, false);
+	SV_AreaListSplit (node, true);
 }
 
 /*
@@ -251,8 +557,18 @@ SV_ClearWorld
 */
 void SV_ClearWorld (void)
 {
+	int		i;
+
 	SV_InitBoxHull ();
+	SV_InvalidateTraces ();
+	SV_ResetMoveBatch ();
 
+	for (i = 0; i < sv_numareanodes; i++)
+	{
+		free (sv_areanodes[i].solid_edicts.box[0]);
+		free (sv_areanodes[i].trigger_edicts.box[0]);
+		free (sv_areanodes[i].nonsolid_edicts.box[0]);
+	}
 	memset (sv_areanodes, 0, sizeof(sv_areanodes));
 	sv_numareanodes = 0;
 	SV_CreateAreaNode (0, sv.worldmodel->mins, sv.worldmodel->maxs);
@@ -267,10 +583,41 @@ SV_UnlinkEdict
 */
 void SV_UnlinkEdict (edict_t *ent)
 {
-	if (!ent->area.prev)
+	areanode_t	*node;
+	arealist_t	*list;
+	int			num, slot, last;
+
+	node = ent->areanode;
+	if (!node)
 		return;		// not linked in anywhere
-	RemoveLink (&ent->area);
-	ent->area.prev = ent->area.next = NULL;
+	ent->areanode = NULL;
+	num = NUM_FOR_EDICT(ent);
+	slot = ent->areaslot;
+
+// find the list by the edict number in the slot; v.solid may have changed
+	list = &node->nonsolid_edicts;
+	if (slot < list->numents && list->edictnum[slot] == num)
+	{
+		SV_AreaListRemove (list, slot);
+		return;		// nothing ever clipped against it
+	}
+	list = &node->solid_edicts;
+	if (slot >= list->numents || list->edictnum[slot] != num)
+		list = &node->trigger_edicts;
+
+	SV_InvalidateTraces ();
+	SV_BatchLinked (ent);
+	SV_DirtyBox (list->box[0][slot], list->box[1][slot], list->box[2][slot],
+		list->box[3][slot], list->box[4][slot], list->box[5][slot]);
+	last = list->numents - 1;
+	if (slot != last)
+	{	// the last entry moves up in the clip order, which is a relink as
+		// far as speculated moves and move batches are concerned
+		SV_DirtyBox (list->box[0][last], list->box[1][last], list->box[2][last],
+			list->box[3][last], list->box[4][last], list->box[5][last]);
+		SV_BatchLinked (EDICT_NUM(list->edictnum[last]));
+	}
+	SV_AreaListRemove (list, slot);
 }
 
 
@@ -285,26 +632,31 @@ them and risking the list getting corrupt.
 static void
 SV_AreaTriggerEdicts ( edict_t *ent, areanode_t *node, edict_t **list, int *listcount, const int listspace )
 {
-	link_t		*l, *next;
+	arealist_t	*alist;
+	unsigned int	mask;
 	edict_t		*touch;
+	int			i;
 
 // touch linked edicts
-	for (l = node->trigger_edicts.next ; l != &node->trigger_edicts ; l = next)
+	alist = &node->trigger_edicts;
+	mask = 0;
+	for (i = 0 ; i < alist->numents ; i++, mask >>= 1)
 	{
-		next = l->next;
-		touch = EDICT_FROM_AREA(l);
+		if (!(i & 31))
+			mask = SV_AreaListCull (alist, i, ent->v.absmin, ent->v.absmax);
+		if (!mask)
+		{
+			i |= 31;	// nothing left in this block
+			continue;
+		}
+		if (!(mask & 1))
+			continue;
+		touch = EDICT_NUM(alist->edictnum[i]);
 		if (touch == ent)
 			continue;
 		// [tuorqai] don't check .touch
 		if (/*!touch->v.touch || */ touch->v.solid != SOLID_TRIGGER)
 			continue;
-		if (ent->v.absmin[0] > touch->v.absmax[0]
-		|| ent->v.absmin[1] > touch->v.absmax[1]
-		|| ent->v.absmin[2] > touch->v.absmax[2]
-		|| ent->v.absmax[0] < touch->v.absmin[0]
-		|| ent->v.absmax[1] < touch->v.absmin[1]
-		|| ent->v.absmax[2] < touch->v.absmin[2] )
-			continue;
 
 		if (*listcount == listspace)
 			return; // should never happen
@@ -323,6 +675,76 @@ SV_AreaTriggerEdicts ( edict_t *ent, areanode_t *node, edict_t **list, int *list
 		SV_AreaTriggerEdicts ( ent, node->children[1], list, listcount, listspace );
 }
 
+/*
+====================
+SV_AreaEdictsRecursive
+====================
+*/
+static void SV_AreaEdictsRecursive (const vec3_t mins, const vec3_t maxs, areanode_t *node, edict_t **list, int *listcount, const int listspace, int areatype)
+{
+	arealist_t	*alist;
+	unsigned int	mask;
+	int		i, j;
+
+	for (i = 0; i < 3; i++)
+	{
+		if (!(areatype & (1 << i)))
+			continue;	// AREA_SOLID, AREA_TRIGGERS, AREA_NONSOLID
+		if (i == 0)
+			alist = &node->solid_edicts;
+		else if (i == 1)
+			alist = &node->trigger_edicts;
+		else
+			alist = &node->nonsolid_edicts;
+		mask = 0;
+		for (j = 0 ; j < alist->numents ; j++, mask >>= 1)
+		{
+			if (!(j & 31))
+				mask = SV_AreaListCull (alist, j, mins, maxs);
+			if (!mask)
+			{
+				j |= 31;	// nothing left in this block
+				continue;
+			}
+			if (!(mask & 1))
+				continue;
+
+			if (*listcount == listspace)
+				return; // should never happen
+
+			list[*listcount] = EDICT_NUM(alist->edictnum[j]);
+			(*listcount)++;
+		}
+	}
+
+// recurse down both sides
+	if (node->axis == -1)
+		return;
+
+	if ( maxs[node->axis] > node->dist )
+		SV_AreaEdictsRecursive ( mins, maxs, node->children[0], list, listcount, listspace, areatype );
+	if ( mins[node->axis] < node->dist )
+		SV_AreaEdictsRecursive ( mins, maxs, node->children[1], list, listcount, listspace, areatype );
+}
+
+/*
+====================
+SV_AreaEdicts
+
+Fills list with every linked edict of the requested AREA_* kinds whose abs
+box touches mins/maxs, in no particular order.  Returns the number of edicts
+found.
+====================
+*/
+int SV_AreaEdicts (const vec3_t mins, const vec3_t maxs, edict_t **list, int listspace, int areatype)
+{
+	int		listcount = 0;
+
+	SV_AreaEdictsRecursive (mins, maxs, sv_areanodes, list, &listcount, listspace, areatype);
+	return listcount;
+}
+
+
 /*
 ====================
 SV_TouchLinks
@@ -443,7 +865,7 @@ void SV_LinkEdict (edict_t *ent, qboolean touch_triggers)
 {
 	areanode_t	*node;
 
-	if (ent->area.prev)
+	if (ent->areanode)
 		SV_UnlinkEdict (ent);	// unlink from old position
 
 	if (ent == sv.edicts)
@@ -452,6 +874,8 @@ void SV_LinkEdict (edict_t *ent, qboolean touch_triggers)
 	if (ent->free)
 		return;
 
+	ED_HotDirty (ent);	// wakes it for the water check of SV_Physics_Step
+
 // set the abs box
 	VectorAdd (ent->v.origin, ent->v.mins, ent->v.absmin);
 	VectorAdd (ent->v.origin, ent->v.maxs, ent->v.absmax);
@@ -483,8 +907,11 @@ void SV_LinkEdict (edict_t *ent, qboolean touch_triggers)
 	if (ent->v.modelindex)
 		SV_FindTouchedLeafs (ent, sv.worldmodel->nodes);
 
-	if (ent->v.solid == SOLID_NOT)
-		return;
+	if (ent->v.solid != SOLID_NOT)
+	{
+		SV_InvalidateTraces ();
+		SV_BatchLinked (ent);
+	}
 
 // find the first node that the ent's box crosses
 	node = sv_areanodes;
@@ -501,11 +928,20 @@ void SV_LinkEdict (edict_t *ent, qboolean touch_triggers)
 	}
 
 // link it in
+	if (ent->v.solid == SOLID_NOT)
+	{	// only SV_AreaEdicts will see it
+		ent->areaslot = SV_AreaListAdd (&node->nonsolid_edicts, ent->v.absmin, ent->v.absmax, NUM_FOR_EDICT(ent), SOLID_NOT);
+		ent->areanode = node;
+		return;
+	}
+	ent->areaslot = SV_AreaListAdd ((ent->v.solid == SOLID_TRIGGER) ? &node->trigger_edicts : &node->solid_edicts,
+		ent->v.absmin, ent->v.absmax, NUM_FOR_EDICT(ent), (int)ent->v.solid);
+	SV_DirtyBox (ent->v.absmin[0], ent->v.absmin[1], ent->v.absmin[2],
+		ent->v.absmax[0], ent->v.absmax[1], ent->v.absmax[2]);
+	ent->areanode = node;
 
-	if (ent->v.solid == SOLID_TRIGGER)
-		InsertLinkBefore (&ent->area, &node->trigger_edicts);
-	else
-		InsertLinkBefore (&ent->area, &node->solid_edicts);
+	if (node->axis == -1 && node->solid_edicts.numents + node->trigger_edicts.numents >= node->splitat)
+		SV_SplitAreaNode (node);
 
 // if touch_triggers, touch all entities at this node and decend for more
 	if (touch_triggers)
@@ -531,21 +967,19 @@ SV_HullPointContents
 int SV_HullPointContents (hull_t *hull, int num, vec3_t p)
 {
 	float		d;
-	mclipnode_t	*node; //johnfitz -- was dclipnode_t
-	mplane_t	*plane;
+	mhullnode_t	*node;
 
 	while (num >= 0)
 	{
 		if (num < hull->firstclipnode || num > hull->lastclipnode)
 			Sys_Error ("SV_HullPointContents: bad node number");
 
-		node = hull->clipnodes + num;
-		plane = hull->planes + node->planenum;
+		node = hull->nodes + num;
 
-		if (plane->type < 3)
-			d = p[plane->type] - plane->dist;
+		if (node->type < 3)
+			d = p[node->type] - node->dist;
 		else
-			d = DoublePrecisionDotProduct (plane->normal, p) - plane->dist;
+			d = DoublePrecisionDotProduct (node->normal, p) - node->dist;
 		if (d < 0)
 			num = node->children[1];
 		else
@@ -611,22 +1045,99 @@ LINE TESTING IN HULLS
 ==================
 SV_RecursiveHullCheck
 
+Walks the packed hull nodes with an explicit stack; the name is kept from
+the recursive version.  A frame is only pushed where the move crosses a
+plane, and is popped once the near side has come back empty.  All the
+float math is done in the same order and precision as the recursive walk
+(kept below for sv_tracefuzz), so traces stay bit for bit the same.
 ==================
 */
+#define	HULLCHECK_STACK		256
+
+typedef struct
+{
+	const mhullnode_t	*node;
+	int			side;
+	float		p1f, p2f, midf, frac;
+	vec3_t		p1, p2, mid;
+} hullframe_t;
+
 qboolean SV_RecursiveHullCheck (hull_t *hull, int num, float p1f, float p2f, vec3_t p1, vec3_t p2, trace_t *trace)
 {
-	mclipnode_t	*node; //johnfitz -- was dclipnode_t
-	mplane_t	*plane;
+	hullframe_t	stack[HULLCHECK_STACK], *f;
+	const mhullnode_t	*node;
 	float		t1, t2;
 	float		frac;
-	int			i;
-	vec3_t		mid;
-	int			side;
-	float		midf;
+	vec3_t		start, end;
+	int			i, depth;
 
-// check for empty
-	if (num < 0)
+	VectorCopy (p1, start);
+	VectorCopy (p2, end);
+	depth = 0;
+
+	while (1)
 	{
+	// go down to a leaf, stacking the planes the move crosses
+		while (num >= 0)
+		{
+			if (num < hull->firstclipnode || num > hull->lastclipnode)
+				Sys_Error ("SV_RecursiveHullCheck: bad node number");
+
+			node = hull->nodes + num;
+			if (node->type < 3)
+			{
+				t1 = start[node->type] - node->dist;
+				t2 = end[node->type] - node->dist;
+			}
+			else
+			{
+				t1 = DoublePrecisionDotProduct (node->normal, start) - node->dist;
+				t2 = DoublePrecisionDotProduct (node->normal, end) - node->dist;
+			}
+
+			if (t1 >= 0 && t2 >= 0)
+			{
+				num = node->children[0];
+				continue;
+			}
+			if (t1 < 0 && t2 < 0)
+			{
+				num = node->children[1];
+				continue;
+			}
+
+			if (depth == HULLCHECK_STACK)
+				Sys_Error ("SV_RecursiveHullCheck: stack overflow");
+			f = &stack[depth++];
+
+		// put the crosspoint DIST_EPSILON pixels on the near side
+			if (t1 < 0)
+				frac = (t1 + DIST_EPSILON)/(t1-t2);
+			else
+				frac = (t1 - DIST_EPSILON)/(t1-t2);
+			if (frac < 0)
+				frac = 0;
+			if (frac > 1)
+				frac = 1;
+
+			f->node = node;
+			f->side = (t1 < 0);
+			f->frac = frac;
+			f->p1f = p1f;
+			f->p2f = p2f;
+			f->midf = p1f + (p2f - p1f)*frac;
+			for (i=0 ; i<3 ; i++)
+				f->mid[i] = start[i] + frac*(end[i] - start[i]);
+			VectorCopy (start, f->p1);
+			VectorCopy (end, f->p2);
+
+		// move up to the node
+			num = node->children[f->side];
+			p2f = f->midf;
+			VectorCopy (f->mid, end);
+		}
+
+	// check for empty
 		if (num != CONTENTS_SOLID)
 		{
 			trace->allsolid = false;
@@ -637,81 +1148,186 @@ qboolean SV_RecursiveHullCheck (hull_t *hull, int num, float p1f, float p2f, vec
 		}
 		else
 			trace->startsolid = true;
-		return true;		// empty
-	}
 
-	if (num < hull->firstclipnode || num > hull->lastclipnode)
-		Sys_Error ("SV_RecursiveHullCheck: bad node number");
+		if (!depth)
+			return true;		// empty
 
-//
-// find the point distances
-//
-	node = hull->clipnodes + num;
-	plane = hull->planes + node->planenum;
+	// the near side of the innermost crossing was empty
+		f = &stack[--depth];
+		node = f->node;
 
-	if (plane->type < 3)
-	{
-		t1 = p1[plane->type] - plane->dist;
-		t2 = p2[plane->type] - plane->dist;
-	}
-	else
-	{
-		t1 = DoublePrecisionDotProduct (plane->normal, p1) - plane->dist;
-		t2 = DoublePrecisionDotProduct (plane->normal, p2) - plane->dist;
-	}
+		if (SV_HullPointContents (hull, node->children[f->side^1], f->mid)
+		!= CONTENTS_SOLID)
+		{
+		// go past the node
+			num = node->children[f->side^1];
+			p1f = f->midf;
+			p2f = f->p2f;
+			VectorCopy (f->mid, start);
+			VectorCopy (f->p2, end);
+			continue;
+		}
 
-#if 1
-	if (t1 >= 0 && t2 >= 0)
-		return SV_RecursiveHullCheck (hull, node->children[0], p1f, p2f, p1, p2, trace);
-	if (t1 < 0 && t2 < 0)
-		return SV_RecursiveHullCheck (hull, node->children[1], p1f, p2f, p1, p2, trace);
-#else
-	if ( (t1 >= DIST_EPSILON && t2 >= DIST_EPSILON) || (t2 > t1 && t1 >= 0) )
-		return SV_RecursiveHullCheck (hull, node->children[0], p1f, p2f, p1, p2, trace);
-	if ( (t1 <= -DIST_EPSILON && t2 <= -DIST_EPSILON) || (t2 < t1 && t1 <= 0) )
-		return SV_RecursiveHullCheck (hull, node->children[1], p1f, p2f, p1, p2, trace);
-#endif
+		if (trace->allsolid)
+			return false;		// never got out of the solid area
 
-// put the crosspoint DIST_EPSILON pixels on the near side
-	if (t1 < 0)
-		frac = (t1 + DIST_EPSILON)/(t1-t2);
-	else
-		frac = (t1 - DIST_EPSILON)/(t1-t2);
-	if (frac < 0)
-		frac = 0;
-	if (frac > 1)
-		frac = 1;
+	//==================
+	// the other side of the node is solid, this is the impact point
+	//==================
+		if (!f->side)
+		{
+			VectorCopy (node->normal, trace->plane.normal);
+			trace->plane.dist = node->dist;
+		}
+		else
+		{
+			VectorSubtract (vec3_origin, node->normal, trace->plane.normal);
+			trace->plane.dist = -node->dist;
+		}
 
-	midf = p1f + (p2f - p1f)*frac;
-	for (i=0 ; i<3 ; i++)
-		mid[i] = p1[i] + frac*(p2[i] - p1[i]);
+		frac = f->frac;
+		while (SV_HullPointContents (hull, hull->firstclipnode, f->mid)
+		== CONTENTS_SOLID)
+		{ // shouldn't really happen, but does occasionally
+			frac -= 0.1;
+			if (frac < 0)
+			{
+				trace->fraction = f->midf;
+				VectorCopy (f->mid, trace->endpos);
+				if (!sv_speculating)
+					Con_DPrintf ("backup past 0\n");
+				return false;
+			}
+			f->midf = f->p1f + (f->p2f - f->p1f)*frac;
+			for (i=0 ; i<3 ; i++)
+				f->mid[i] = f->p1[i] + frac*(f->p2[i] - f->p1[i]);
+		}
 
-	side = (t1 < 0);
+		trace->fraction = f->midf;
+		VectorCopy (f->mid, trace->endpos);
 
-// move up to the node
-	if (!SV_RecursiveHullCheck (hull, node->children[side], p1f, midf, p1, mid, trace) )
 		return false;
+	}
+}
 
-#ifdef PARANOID
-	if (SV_HullPointContents (sv_hullmodel, mid, node->children[side])
-	== CONTENTS_SOLID)
+
+/*
+===============================================================================
+
+TRACE FUZZING
+
+===============================================================================
+*/
+
+/*
+==================
+SV_HullPointContentsRef
+
+SV_HullPointContents on the unpacked clipnodes and planes
+==================
+*/
+static int SV_HullPointContentsRef (hull_t *hull, int num, vec3_t p)
+{
+	float		d;
+	mclipnode_t	*node;
+	mplane_t	*plane;
+
+	while (num >= 0)
 	{
-		Con_Printf ("mid PointInHullSolid\n");
-		return false;
+		node = hull->clipnodes + num;
+		plane = hull->planes + node->planenum;
+
+		if (plane->type < 3)
+			d = p[plane->type] - plane->dist;
+		else
+			d = DoublePrecisionDotProduct (plane->normal, p) - plane->dist;
+		if (d < 0)
+			num = node->children[1];
+		else
+			num = node->children[0];
 	}
-#endif
 
-	if (SV_HullPointContents (hull, node->children[side^1], mid)
+	return num;
+}
+
+/*
+==================
+SV_RecursiveHullCheckRef
+
+The original recursive hull check, only used as the reference for
+sv_tracefuzz
+==================
+*/
+static qboolean SV_RecursiveHullCheckRef (hull_t *hull, int num, float p1f, float p2f, vec3_t p1, vec3_t p2, trace_t *trace)
+{
+	mclipnode_t	*node;
+	mplane_t	*plane;
+	float		t1, t2;
+	float		frac;
+	int			i;
+	vec3_t		mid;
+	int			side;
+	float		midf;
+
+	if (num < 0)
+	{
+		if (num != CONTENTS_SOLID)
+		{
+			trace->allsolid = false;
+			if (num == CONTENTS_EMPTY)
+				trace->inopen = true;
+			else
+				trace->inwater = true;
+		}
+		else
+			trace->startsolid = true;
+		return true;
+	}
+
+	node = hull->clipnodes + num;
+	plane = hull->planes + node->planenum;
+
+	if (plane->type < 3)
+	{
+		t1 = p1[plane->type] - plane->dist;
+		t2 = p2[plane->type] - plane->dist;
+	}
+	else
+	{
+		t1 = DoublePrecisionDotProduct (plane->normal, p1) - plane->dist;
+		t2 = DoublePrecisionDotProduct (plane->normal, p2) - plane->dist;
+	}
+
+	if (t1 >= 0 && t2 >= 0)
+		return SV_RecursiveHullCheckRef (hull, node->children[0], p1f, p2f, p1, p2, trace);
+	if (t1 < 0 && t2 < 0)
+		return SV_RecursiveHullCheckRef (hull, node->children[1], p1f, p2f, p1, p2, trace);
+
+	if (t1 < 0)
+		frac = (t1 + DIST_EPSILON)/(t1-t2);
+	else
+		frac = (t1 - DIST_EPSILON)/(t1-t2);
+	if (frac < 0)
+		frac = 0;
+	if (frac > 1)
+		frac = 1;
+
+	midf = p1f + (p2f - p1f)*frac;
+	for (i=0 ; i<3 ; i++)
+		mid[i] = p1[i] + frac*(p2[i] - p1[i]);
+
+	side = (t1 < 0);
+
+	if (!SV_RecursiveHullCheckRef (hull, node->children[side], p1f, midf, p1, mid, trace) )
+		return false;
+
+	if (SV_HullPointContentsRef (hull, node->children[side^1], mid)
 	!= CONTENTS_SOLID)
-// go past the node
-		return SV_RecursiveHullCheck (hull, node->children[side^1], midf, p2f, mid, p2, trace);
+		return SV_RecursiveHullCheckRef (hull, node->children[side^1], midf, p2f, mid, p2, trace);
 
 	if (trace->allsolid)
-		return false;		// never got out of the solid area
+		return false;
 
-//==================
-// the other side of the node is solid, this is the impact point
-//==================
 	if (!side)
 	{
 		VectorCopy (plane->normal, trace->plane.normal);
@@ -723,15 +1339,14 @@ qboolean SV_RecursiveHullCheck (hull_t *hull, int num, float p1f, float p2f, vec
 		trace->plane.dist = -plane->dist;
 	}
 
-	while (SV_HullPointContents (hull, hull->firstclipnode, mid)
+	while (SV_HullPointContentsRef (hull, hull->firstclipnode, mid)
 	== CONTENTS_SOLID)
-	{ // shouldn't really happen, but does occasionally
+	{
 		frac -= 0.1;
 		if (frac < 0)
 		{
 			trace->fraction = midf;
 			VectorCopy (mid, trace->endpos);
-			Con_DPrintf ("backup past 0\n");
 			return false;
 		}
 		midf = p1f + (p2f - p1f)*frac;
@@ -745,6 +1360,99 @@ qboolean SV_RecursiveHullCheck (hull_t *hull, int num, float p1f, float p2f, vec
 	return false;
 }
 
+static unsigned int	fuzz_seed;
+
+static float SV_FuzzRandom (float lo, float hi)
+{
+	fuzz_seed = fuzz_seed * 1664525 + 1013904223;
+	return lo + (hi - lo) * (float)((fuzz_seed >> 8) / 16777216.0);
+}
+
+/*
+==================
+SV_TraceFuzz_f
+
+Runs random traces through every hull of the loaded brush models with
+the iterative hull check and the recursive reference, and reports any
+trace that is not bit for bit the same
+==================
+*/
+void SV_TraceFuzz_f (void)
+{
+	qmodel_t	*models[MAX_MODELS], *mod;
+	hull_t		*hull;
+	trace_t		trace[2];
+	qboolean	ret[2];
+	vec3_t		start, end;
+	int			i, n, count, nummodels, bad;
+
+	if (!sv.active)
+	{
+		Con_Printf ("Not running a server\n");
+		return;
+	}
+
+	count = (Cmd_Argc() > 1) ? q_max (1, atoi (Cmd_Argv(1))) : 100000;
+	fuzz_seed = (Cmd_Argc() > 2) ? (unsigned int)atoi (Cmd_Argv(2)) : 1;
+
+	nummodels = 0;
+	for (i = 1; i < MAX_MODELS && sv.models[i]; i++)
+	{
+		if (sv.models[i]->type == mod_brush)
+			models[nummodels++] = sv.models[i];
+	}
+	if (!nummodels)
+		return;
+
+	bad = 0;
+	for (n = 0; n < count; n++)
+	{
+		mod = models[(fuzz_seed >> 16) % nummodels];
+		hull = &mod->hulls[(fuzz_seed >> 8) % 3];
+
+		for (i = 0; i < 3; i++)
+			start[i] = SV_FuzzRandom (mod->mins[i] - 64, mod->maxs[i] + 64);
+		switch ((fuzz_seed >> 4) & 3)
+		{
+		case 0:		// standing still
+			VectorCopy (start, end);
+			break;
+		case 1:		// a single physics step
+			for (i = 0; i < 3; i++)
+				end[i] = start[i] + SV_FuzzRandom (-16, 16);
+			break;
+		case 2:		// along one axis
+			VectorCopy (start, end);
+			i = (fuzz_seed >> 12) % 3;
+			end[i] = SV_FuzzRandom (mod->mins[i] - 64, mod->maxs[i] + 64);
+			break;
+		default:
+			for (i = 0; i < 3; i++)
+				end[i] = SV_FuzzRandom (mod->mins[i] - 64, mod->maxs[i] + 64);
+			break;
+		}
+
+		for (i = 0; i < 2; i++)
+		{
+			memset (&trace[i], 0, sizeof(trace_t));
+			trace[i].fraction = 1;
+			trace[i].allsolid = true;
+			VectorCopy (end, trace[i].endpos);
+		}
+		ret[0] = SV_RecursiveHullCheck (hull, hull->firstclipnode, 0, 1, start, end, &trace[0]);
+		ret[1] = SV_RecursiveHullCheckRef (hull, hull->firstclipnode, 0, 1, start, end, &trace[1]);
+
+		if (ret[0] != ret[1] || memcmp (&trace[0], &trace[1], sizeof(trace_t)))
+		{
+			if (++bad <= 8)
+				Con_Printf ("%s hull %i: (%.9g %.9g %.9g) to (%.9g %.9g %.9g): %.9g vs %.9g\n",
+					mod->name, (int)(hull - mod->hulls), start[0], start[1], start[2],
+					end[0], end[1], end[2], trace[0].fraction, trace[1].fraction);
+		}
+	}
+
+	Con_Printf ("%i traces over %i models, %i differ\n", count, nummodels, bad);
+}
 
 /*
 ==================
@@ -754,12 +1462,13 @@ Handles selection or creation of a clipping hull, and offseting (and
 eventually rotation) of the end points
 ==================
 */
-trace_t SV_ClipMoveToEntity (edict_t *ent, vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end)
+static trace_t SV_ClipMoveToEntity (moveclip_t *clip, edict_t *ent, vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end)
 {
 	trace_t		trace;
 	vec3_t		offset;
 	vec3_t		start_l, end_l;
 	hull_t		*hull;
+	boxhull_t	box;
 
 // fill in a default trace
 	memset (&trace, 0, sizeof(trace_t));
@@ -768,7 +1477,13 @@ trace_t SV_ClipMoveToEntity (edict_t *ent, vec3_t start, vec3_t mins, vec3_t max
 	VectorCopy (end, trace.endpos);
 
 // get the clipping hull
-	hull = SV_HullForEntity (ent, mins, maxs, offset);
+	hull = SV_HullForEntity (ent, mins, maxs, offset, &box, clip->spec != NULL);
+	if (!hull)
+	{
+		clip->failed = true;
+		return trace;
+	}
+	clip->hullchecks++;
 
 	VectorSubtract (start, offset, start_l);
 	VectorSubtract (end, offset, end_l);
@@ -791,72 +1506,108 @@ trace_t SV_ClipMoveToEntity (edict_t *ent, vec3_t start, vec3_t mins, vec3_t max
 
 /*
 ====================
-SV_ClipToLinks
+SV_ClipToLink
 
-Mins and maxs enclose the entire area swept by the move
+One entry of an area list, for SV_ClipToLinks and the move batches.
+Returns false when nothing more can change the clip.
 ====================
 */
-void SV_ClipToLinks ( areanode_t *node, moveclip_t *clip )
+static qboolean SV_ClipToLink (moveclip_t *clip, int edictnum, int solid)
 {
-	link_t		*l, *next;
 	edict_t		*touch;
 	trace_t		trace;
 
-// touch linked edicts
-	for (l = node->solid_edicts.next ; l != &node->solid_edicts ; l = next)
-	{
-		next = l->next;
-		touch = EDICT_FROM_AREA(l);
-		if (touch->v.solid == SOLID_NOT)
-			continue;
-		if (touch == clip->passedict)
-			continue;
-		if (touch->v.solid == SOLID_TRIGGER)
-			Sys_Error ("Trigger in clipping list");
+	if (clip->type == MOVE_NOMONSTERS && solid != SOLID_BSP)
+		return true;
 
-		if (clip->type == MOVE_NOMONSTERS && touch->v.solid != SOLID_BSP)
-			continue;
+	touch = EDICT_NUM(edictnum);
+	if (clip->spec && !SV_SpecTouch (clip->spec, touch))
+	{
+		clip->failed = true;
+		return false;
+	}
+	if (touch->v.solid == SOLID_NOT)
+		return true;
+	if (touch == clip->passedict)
+		return true;
+	if (touch->v.solid == SOLID_TRIGGER)
+	{
+		if (clip->spec)
+		{
+			clip->failed = true;
+			return false;
+		}
+		Sys_Error ("Trigger in clipping list");
+	}
+	if (clip->type == MOVE_NOMONSTERS && touch->v.solid != SOLID_BSP)
+		return true;
 
-		if (clip->boxmins[0] > touch->v.absmax[0]
-		|| clip->boxmins[1] > touch->v.absmax[1]
-		|| clip->boxmins[2] > touch->v.absmax[2]
-		|| clip->boxmaxs[0] < touch->v.absmin[0]
-		|| clip->boxmaxs[1] < touch->v.absmin[1]
-		|| clip->boxmaxs[2] < touch->v.absmin[2] )
-			continue;
+	if (clip->passedict && clip->passedict->v.size[0] && !touch->v.size[0])
+		return true;	// points never interact
 
-		if (clip->passedict && clip->passedict->v.size[0] && !touch->v.size[0])
-			continue;	// points never interact
+// might intersect, so do an exact clip
+	if (clip->trace.allsolid)
+		return false;
+	if (clip->passedict)
+	{
+	 	if (PROG_TO_EDICT(touch->v.owner) == clip->passedict)
+			return true;	// don't clip against own missiles
+		if (PROG_TO_EDICT(clip->passedict->v.owner) == touch)
+			return true;	// don't clip against owner
+	}
 
-	// might intersect, so do an exact clip
-		if (clip->trace.allsolid)
-			return;
-		if (clip->passedict)
+	if ((int)touch->v.flags & FL_MONSTER)
+		trace = SV_ClipMoveToEntity (clip, touch, clip->start, clip->mins2, clip->maxs2, clip->end);
+	else
+		trace = SV_ClipMoveToEntity (clip, touch, clip->start, clip->mins, clip->maxs, clip->end);
+	if (clip->failed)
+		return false;
+	if (trace.allsolid || trace.startsolid ||
+	trace.fraction < clip->trace.fraction)
+	{
+		trace.ent = touch;
+	 	if (clip->trace.startsolid)
 		{
-		 	if (PROG_TO_EDICT(touch->v.owner) == clip->passedict)
-				continue;	// don't clip against own missiles
-			if (PROG_TO_EDICT(clip->passedict->v.owner) == touch)
-				continue;	// don't clip against owner
+			clip->trace = trace;
+			clip->trace.startsolid = true;
 		}
-
-		if ((int)touch->v.flags & FL_MONSTER)
-			trace = SV_ClipMoveToEntity (touch, clip->start, clip->mins2, clip->maxs2, clip->end);
 		else
-			trace = SV_ClipMoveToEntity (touch, clip->start, clip->mins, clip->maxs, clip->end);
-		if (trace.allsolid || trace.startsolid ||
-		trace.fraction < clip->trace.fraction)
+			clip->trace = trace;
+	}
+	else if (trace.startsolid)
+		clip->trace.startsolid = true;
+	return true;
+}
+
+/*
+====================
+SV_ClipToLinks
+
+Mins and maxs enclose the entire area swept by the move
+====================
+*/
+static void SV_ClipToLinks ( areanode_t *node, moveclip_t *clip )
+{
+	arealist_t	*alist;
+	unsigned int	mask;
+	int			i;
+
+// touch linked edicts
+	alist = &node->solid_edicts;
+	mask = 0;
+	for (i = 0 ; i < alist->numents ; i++, mask >>= 1)
+	{
+		if (!(i & 31))
+			mask = SV_AreaListCull (alist, i, clip->boxmins, clip->boxmaxs);
+		if (!mask)
 		{
-			trace.ent = touch;
-		 	if (clip->trace.startsolid)
-			{
-				clip->trace = trace;
-				clip->trace.startsolid = true;
-			}
-			else
-				clip->trace = trace;
+			i |= 31;	// nothing left in this block
+			continue;
 		}
-		else if (trace.startsolid)
-			clip->trace.startsolid = true;
+		if (!(mask & 1))
+			continue;
+		if (!SV_ClipToLink (clip, alist->edictnum[i], alist->solid[i]))
+			return;
 	}
 
 // recurse down both sides
@@ -869,6 +1620,181 @@ void SV_ClipToLinks ( areanode_t *node, moveclip_t *clip )
 		SV_ClipToLinks ( node->children[1], clip );
 }
 
+/*
+===============================================================================
+
+MOVE BATCHES
+
+===============================================================================
+*/
+
+/*
+A caller about to make many traces for one edict inside a known box
+(every direction a monster might step in, with its bottom checks) opens
+a batch for that box.  The first clip for that passedict walks the area
+tree once and keeps the solid entries that touch the box, in the order
+SV_ClipToLinks would visit them; later clips whose swept box fits inside
+it only cull that short list.  Linking or unlinking any other edict, or
+a leaf split, closes the batch for the rest of its life, so the traces
+are always the ones the tree would give.  The passedict itself can
+relink freely, since its own entries are left out, as long as its
+unlink doesn't move another edict up in the clip order.
+*/
+
+static	struct
+{
+	int			depth;			// nested SV_BeginMoveBatch calls
+	edict_t		*passedict;
+	vec3_t		mins, maxs;
+	qboolean	gathered, stale;
+	int			splits;
+	arealist_t	list;
+	int			clips, gathers;	// for sv_tracestats
+} sv_movebatch;
+
+/*
+===============
+SV_GatherLinks
+
+===============
+*/
+static void SV_GatherLinks (areanode_t *node, int passnum)
+{
+	arealist_t	*alist;
+	unsigned int	mask;
+	int			i;
+
+	alist = &node->solid_edicts;
+	mask = 0;
+	for (i = 0 ; i < alist->numents ; i++, mask >>= 1)
+	{
+		if (!(i & 31))
+			mask = SV_AreaListCull (alist, i, sv_movebatch.mins, sv_movebatch.maxs);
+		if (!mask)
+		{
+			i |= 31;	// nothing left in this block
+			continue;
+		}
+		if (!(mask & 1) || alist->edictnum[i] == passnum)
+			continue;
+		if (sv_movebatch.list.numents == sv_movebatch.list.maxents)
+			SV_AreaListGrow (&sv_movebatch.list);
+		SV_AreaListMove (&sv_movebatch.list, sv_movebatch.list.numents++, alist, i);
+	}
+
+	if (node->axis == -1)
+		return;
+
+	if ( sv_movebatch.maxs[node->axis] > node->dist )
+		SV_GatherLinks ( node->children[0], passnum );
+	if ( sv_movebatch.mins[node->axis] < node->dist )
+		SV_GatherLinks ( node->children[1], passnum );
+}
+
+/*
+===============
+SV_BeginMoveBatch / SV_EndMoveBatch
+
+A batch opened inside another one (from a touch function) does nothing
+===============
+*/
+void SV_BeginMoveBatch (edict_t *passedict, const vec3_t mins, const vec3_t maxs)
+{
+	if (sv_movebatch.depth++)
+		return;
+
+	sv_movebatch.passedict = passedict;
+	VectorCopy (mins, sv_movebatch.mins);
+	VectorCopy (maxs, sv_movebatch.maxs);
+	sv_movebatch.gathered = false;
+	sv_movebatch.stale = false;
+}
+
+void SV_EndMoveBatch (void)
+{
+	if (--sv_movebatch.depth)
+		return;
+
+	sv_movebatch.passedict = NULL;
+}
+
+/*
+===============
+SV_ResetMoveBatch
+
+For SV_ClearWorld, in case a Host_Error left a batch open
+===============
+*/
+static void SV_ResetMoveBatch (void)
+{
+	sv_movebatch.depth = 0;
+	sv_movebatch.passedict = NULL;
+}
+
+/*
+===============
+SV_BatchLinked
+
+Called for every solid or trigger link and unlink
+===============
+*/
+static void SV_BatchLinked (edict_t *ent)
+{
+	if (ent != sv_movebatch.passedict)
+		sv_movebatch.stale = true;
+}
+
+/*
+===============
+SV_ClipToBatch
+
+SV_ClipToLinks from the open batch, false when it can't be used
+===============
+*/
+static qboolean SV_ClipToBatch (moveclip_t *clip)
+{
+	arealist_t	*alist;
+	unsigned int	mask;
+	int			i;
+
+	if (!sv_movebatch.passedict || clip->passedict != sv_movebatch.passedict)
+		return false;
+	if (sv_movebatch.stale || (sv_movebatch.gathered && sv_movebatch.splits != sv_areasplits))
+		return false;
+	for (i = 0; i < 3; i++)
+	{
+		if (clip->boxmins[i] < sv_movebatch.mins[i] || clip->boxmaxs[i] > sv_movebatch.maxs[i])
+			return false;
+	}
+
+	alist = &sv_movebatch.list;
+	if (!sv_movebatch.gathered)
+	{
+		alist->numents = 0;
+		SV_GatherLinks (sv_areanodes, NUM_FOR_EDICT(sv_movebatch.passedict));
+		sv_movebatch.splits = sv_areasplits;
+		sv_movebatch.gathered = true;
+		sv_movebatch.gathers++;
+	}
+	sv_movebatch.clips++;
+
+	mask = 0;
+	for (i = 0 ; i < alist->numents ; i++, mask >>= 1)
+	{
+		if (!(i & 31))
+			mask = SV_AreaListCull (alist, i, clip->boxmins, clip->boxmaxs);
+		if (!mask)
+		{
+			i |= 31;	// nothing left in this block
+			continue;
+		}
+		if (!(mask & 1))
+			continue;
+		if (!SV_ClipToLink (clip, alist->edictnum[i], alist->solid[i]))
+			break;
+	}
+	return true;
+}
 
 /*
 ==================
@@ -902,46 +1828,463 @@ boxmaxs[0] = boxmaxs[1] = boxmaxs[2] = 9999;
 
 /*
 ==================
-SV_Move
+SV_RunClip
+
+The uncached SV_Move, into a cleared clip
 ==================
 */
-trace_t SV_Move (vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, edict_t *passedict)
+static void SV_RunClip (moveclip_t *clip, vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, edict_t *passedict)
 {
-	moveclip_t	clip;
 	int			i;
 
-	memset ( &clip, 0, sizeof ( moveclip_t ) );
-
 // clip to world
-	clip.trace = SV_ClipMoveToEntity ( sv.edicts, start, mins, maxs, end );
+	clip->trace = SV_ClipMoveToEntity ( clip, sv.edicts, start, mins, maxs, end );
+	if (clip->failed)
+		return;
 
-	clip.start = start;
-	clip.end = end;
-	clip.mins = mins;
-	clip.maxs = maxs;
-	clip.type = type;
-	clip.passedict = passedict;
+	clip->start = start;
+	clip->end = end;
+	clip->mins = mins;
+	clip->maxs = maxs;
+	clip->type = type;
+	clip->passedict = passedict;
 
 	if (type == MOVE_MISSILE)
 	{
 		for (i=0 ; i<3 ; i++)
 		{
-			clip.mins2[i] = -15;
-			clip.maxs2[i] = 15;
+			clip->mins2[i] = -15;
+			clip->maxs2[i] = 15;
 		}
 	}
 	else
 	{
-		VectorCopy (mins, clip.mins2);
-		VectorCopy (maxs, clip.maxs2);
+		VectorCopy (mins, clip->mins2);
+		VectorCopy (maxs, clip->maxs2);
 	}
 
 // create the bounding box of the entire move
-	SV_MoveBounds ( start, clip.mins2, clip.maxs2, end, clip.boxmins, clip.boxmaxs );
+	SV_MoveBounds ( start, clip->mins2, clip->maxs2, end, clip->boxmins, clip->boxmaxs );
 
 // clip to entities
-	SV_ClipToLinks ( sv_areanodes, &clip );
+	if (clip->spec || !SV_ClipToBatch (clip))
+		SV_ClipToLinks ( sv_areanodes, clip );
+}
+
+/*
+==================
+SV_ClipMove
+
+==================
+*/
+static trace_t SV_ClipMove (vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, edict_t *passedict)
+{
+	moveclip_t	clip;
+
+	memset ( &clip, 0, sizeof ( moveclip_t ) );
+	SV_RunClip ( &clip, start, mins, maxs, end, type, passedict );
 
 	return clip.trace;
 }
 
+
+/*
+===============================================================================
+
+TRACE CACHE
+
+===============================================================================
+*/
+
+/*
+With sv_tracecache 1, SV_Move remembers its results until the next
+frame or the next time any edict is linked or unlinked, so identical
+traces in between (every monster checking the same player, for one)
+are answered without touching the hulls.  Fields changed by QC without
+a relink (owner, solid, flags) are not noticed until then.
+*/
+cvar_t	sv_tracecache = {"sv_tracecache", "0", CVAR_NONE};
+
+#define	TRACECACHE_SIZE		512		// must be a power of two
+
+typedef struct
+{
+	float		key[12];		// start, end, mins, maxs
+	int			type;
+	edict_t		*passedict;
+	unsigned int	generation;	// 0 is never current
+	int			hullchecks;		// SV_RecursiveHullCheck calls the trace took
+	trace_t		trace;
+} tracecache_t;
+
+static	tracecache_t	*sv_tracecache_table;
+static	unsigned int	sv_tracegen;
+
+static	struct
+{
+	int		lookups, hits, invalidations;
+	int		hullchecks, hullsaved;
+} tracestats;
+
+/*
+===============
+SV_InvalidateTraces
+
+===============
+*/
+void SV_InvalidateTraces (void)
+{
+	if (!++sv_tracegen)
+		sv_tracegen = 1;
+	tracestats.invalidations++;
+}
+
+/*
+==================
+SV_Move
+
+Looks the trace up by the exact bits of its arguments before clipping.
+==================
+*/
+trace_t SV_Move (vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, edict_t *passedict)
+{
+	tracecache_t	*tc;
+	moveclip_t	clip;
+	float		key[12];
+	unsigned int	hash, bits;
+	int			i;
+
+	if (!sv_tracecache.value)
+		return SV_ClipMove (start, mins, maxs, end, type, passedict);
+
+	if (!sv_tracecache_table)
+	{
+		sv_tracecache_table = (tracecache_t *) calloc (TRACECACHE_SIZE, sizeof(tracecache_t));
+		if (!sv_tracecache_table)
+			Sys_Error ("SV_Move: out of memory");
+		SV_InvalidateTraces ();
+	}
+
+	VectorCopy (start, key);
+	VectorCopy (end, key + 3);
+	VectorCopy (mins, key + 6);
+	VectorCopy (maxs, key + 9);
+
+	hash = 2166136261u ^ (unsigned int)type ^ ((unsigned int)(passedict ? NUM_FOR_EDICT(passedict) : -1) << 2);
+	for (i = 0; i < 12; i++)
+	{
+		memcpy (&bits, &key[i], sizeof(bits));
+		hash = (hash ^ bits) * 16777619u;
+	}
+	tc = &sv_tracecache_table[(hash ^ (hash >> 15)) & (TRACECACHE_SIZE - 1)];
+
+	tracestats.lookups++;
+	if (tc->generation == sv_tracegen && tc->type == type && tc->passedict == passedict
+		&& !memcmp (tc->key, key, sizeof(key)))
+	{
+		tracestats.hits++;
+		tracestats.hullsaved += tc->hullchecks;
+		return tc->trace;
+	}
+
+	memset (&clip, 0, sizeof(clip));
+	SV_RunClip (&clip, start, mins, maxs, end, type, passedict);
+	tc->trace = clip.trace;
+	tc->hullchecks = clip.hullchecks;
+	tracestats.hullchecks += tc->hullchecks;
+
+	memcpy (tc->key, key, sizeof(key));
+	tc->type = type;
+	tc->passedict = passedict;
+	tc->generation = sv_tracegen;
+	return tc->trace;
+}
+
+/*
+================
+SV_TraceStats_f
+
+Prints and resets the trace cache counters
+================
+*/
+void SV_TraceStats_f (void)
+{
+	if (!sv_tracecache.value)
+		Con_Printf ("sv_tracecache is off\n");
+
+	Con_Printf ("%i traces, %i hits (%.1f%%), %i invalidations\n", tracestats.lookups, tracestats.hits,
+		tracestats.lookups ? tracestats.hits * 100.0 / tracestats.lookups : 0.0, tracestats.invalidations);
+	Con_Printf ("%i hull checks run, %i saved\n", tracestats.hullchecks, tracestats.hullsaved);
+	Con_Printf ("%i batched clips from %i gathers\n", sv_movebatch.clips, sv_movebatch.gathers);
+
+	memset (&tracestats, 0, sizeof(tracestats));
+	sv_movebatch.clips = sv_movebatch.gathers = 0;
+}
+
+/*
+===============================================================================
+
+SPECULATIVE MOVES
+
+===============================================================================
+*/
+
+/*
+The parallel physics phase runs SV_Move for the tossed edicts against the
+world as it stands at the start of the frame.  While the serial phase
+then runs, every box linked into or unlinked from the area tree is
+recorded, and a speculated trace is only handed out when its arguments
+are bit for bit the ones the serial code asks for, no recorded box
+touches its move, the area tree has not been split, and none of the
+edicts it read (the world, the passedict and every edict that got past
+the box reject) has changed a field the clip looks at.  Anything else is
+traced again, so the result is always what the serial SV_Move returns.
+*/
+
+qboolean	sv_speculating;		// jobs are tracing, so nothing may print
+
+static	qboolean	sv_specrecord;
+static	float		*sv_dirtyboxes;
+static	int			sv_numdirty, sv_maxdirty;
+
+/*
+===============
+SV_DirtyBox
+
+===============
+*/
+static void SV_DirtyBox (float x0, float y0, float z0, float x1, float y1, float z1)
+{
+	float	*b;
+
+	if (!sv_specrecord)
+		return;
+
+	if (sv_numdirty == sv_maxdirty)
+	{
+		sv_maxdirty = sv_maxdirty ? sv_maxdirty * 2 : 256;
+		sv_dirtyboxes = (float *) realloc (sv_dirtyboxes, sv_maxdirty * 6 * sizeof(float));
+		if (!sv_dirtyboxes)
+			Sys_Error ("SV_DirtyBox: out of memory");
+	}
+
+	b = sv_dirtyboxes + 6 * sv_numdirty++;
+	b[0] = x0;
+	b[1] = y0;
+	b[2] = z0;
+	b[3] = x1;
+	b[4] = y1;
+	b[5] = z1;
+}
+
+/*
+===============
+SV_SpecFields
+
+The fields of a clipped edict that SV_ClipToLinks and SV_HullForEntity
+read
+===============
+*/
+static void SV_SpecFields (edict_t *ent, spectouch_t *t)
+{
+	t->owner = ent->v.owner;
+	t->fields[0] = ent->v.solid;
+	t->fields[1] = ent->v.movetype;
+	t->fields[2] = ent->v.modelindex;
+	t->fields[3] = ent->v.flags;
+	t->fields[4] = ent->v.size[0];
+	VectorCopy (ent->v.origin, t->fields + 5);
+	VectorCopy (ent->v.mins, t->fields + 8);
+	VectorCopy (ent->v.maxs, t->fields + 11);
+}
+
+/*
+===============
+SV_SpecTouch
+
+Remembers an edict a speculated clip read, false when there are too many
+===============
+*/
+static qboolean SV_SpecTouch (movespec_t *spec, edict_t *ent)
+{
+	spectouch_t	*t;
+
+	if (spec->numtouched == MAX_SPECTOUCH)
+		return false;
+
+	t = &spec->touched[spec->numtouched++];
+	t->edictnum = NUM_FOR_EDICT(ent);
+	SV_SpecFields (ent, t);
+	return true;
+}
+
+/*
+===============
+SV_BeginSpeculation / SV_EndSpeculation
+
+Bracket the serial phase of a frame that has speculated moves
+===============
+*/
+void SV_BeginSpeculation (void)
+{
+	sv_numdirty = 0;
+	sv_specrecord = true;
+}
+
+void SV_EndSpeculation (void)
+{
+	sv_specrecord = false;
+	sv_numdirty = 0;
+}
+
+/*
+===============
+SV_SpeculateMove
+
+Runs the move in spec against the current world.  Does not write any
+shared state, so the physics jobs call it side by side; nothing may be
+linked or unlinked while they do.
+===============
+*/
+void SV_SpeculateMove (movespec_t *spec)
+{
+	moveclip_t	clip;
+
+	spec->valid = false;
+	spec->numtouched = 0;
+	spec->splits = sv_areasplits;
+	spec->passowner = spec->passedict ? spec->passedict->v.owner : 0;
+	spec->passsize = spec->passedict ? spec->passedict->v.size[0] : 0;
+
+	SV_SpecTouch (spec, sv.edicts);
+
+	memset (&clip, 0, sizeof(clip));
+	clip.spec = spec;
+	SV_RunClip (&clip, spec->start, spec->mins, spec->maxs, spec->end, spec->type, spec->passedict);
+	if (clip.failed)
+		return;
+
+	spec->trace = clip.trace;
+	VectorCopy (clip.boxmins, spec->boxmins);
+	VectorCopy (clip.boxmaxs, spec->boxmaxs);
+	spec->valid = true;
+}
+
+/*
+===============
+SV_SpeculatedMove
+
+Fills in trace and returns true when spec is still exactly what SV_Move
+would return for these arguments
+===============
+*/
+qboolean SV_SpeculatedMove (movespec_t *spec, vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, edict_t *passedict, trace_t *trace)
+{
+	spectouch_t	now;
+	float		*b;
+	int			i;
+
+	if (!spec->valid || spec->splits != sv_areasplits)
+		return false;
+	if (spec->type != type || spec->passedict != passedict)
+		return false;
+	if (memcmp (spec->start, start, sizeof(vec3_t)) || memcmp (spec->end, end, sizeof(vec3_t))
+		|| memcmp (spec->mins, mins, sizeof(vec3_t)) || memcmp (spec->maxs, maxs, sizeof(vec3_t)))
+		return false;
+	if (passedict && (passedict->v.owner != spec->passowner
+		|| memcmp (&passedict->v.size[0], &spec->passsize, sizeof(float))))
+		return false;
+
+	for (i = 0; i < spec->numtouched; i++)
+	{
+		SV_SpecFields (EDICT_NUM(spec->touched[i].edictnum), &now);
+		if (now.owner != spec->touched[i].owner
+			|| memcmp (now.fields, spec->touched[i].fields, sizeof(now.fields)))
+			return false;
+	}
+
+	for (i = 0, b = sv_dirtyboxes; i < sv_numdirty; i++, b += 6)
+	{
+		if (spec->boxmins[0] > b[3]
+		|| spec->boxmins[1] > b[4]
+		|| spec->boxmins[2] > b[5]
+		|| spec->boxmaxs[0] < b[0]
+		|| spec->boxmaxs[1] < b[1]
+		|| spec->boxmaxs[2] < b[2] )
+			continue;
+		return false;
+	}
+
+	*trace = spec->trace;
+	return true;
+}
+
+/*
+================
+SV_MoveBench_f
+
+Times the uncached SV_Move for every solid edict over a fan of eight moves, once
+with the vector box reject and once with the plain loop.  The number of
+edicts hit must come out the same for both.
+================
+*/
+void SV_MoveBench_f (void)
+{
+	static const float	dirs[8][2] = {
+		{1, 0}, {0.7071f, 0.7071f}, {0, 1}, {-0.7071f, 0.7071f},
+		{-1, 0}, {-0.7071f, -0.7071f}, {0, -1}, {0.7071f, -0.7071f}
+	};
+	int		i, j, pass, passes, scalar, traces, hits[2];
+	double	start, elapsed[2];
+	edict_t	*ent;
+	vec3_t	end;
+	trace_t	trace;
+
+	if (!sv.active)
+	{
+		Con_Printf ("Not running a server\n");
+		return;
+	}
+
+	passes = (Cmd_Argc() > 1) ? q_max (1, atoi (Cmd_Argv(1))) : 100;
+
+	traces = 0;
+	for (scalar = 0; scalar < 2; scalar++)
+	{
+		sv_areascalar = scalar;
+		traces = hits[scalar] = 0;
+		start = Sys_DoubleTime ();
+		for (pass = 0; pass < passes; pass++)
+		{
+			ent = NEXT_EDICT(sv.edicts);
+			for (i = 1; i < sv.num_edicts; i++, ent = NEXT_EDICT(ent))
+			{
+				if (ent->free || ent->v.solid == SOLID_NOT || ent->v.solid == SOLID_TRIGGER)
+					continue;
+				for (j = 0; j < 8; j++)
+				{
+					end[0] = ent->v.origin[0] + dirs[j][0] * 128;
+					end[1] = ent->v.origin[1] + dirs[j][1] * 128;
+					end[2] = ent->v.origin[2];
+					trace = SV_ClipMove (ent->v.origin, ent->v.mins, ent->v.maxs, end, MOVE_NORMAL, ent);
+					if (trace.ent && trace.ent != sv.edicts)
+						hits[scalar]++;
+					traces++;
+				}
+			}
+		}
+		elapsed[scalar] = Sys_DoubleTime () - start;
+	}
+	sv_areascalar = false;
+
+	if (!traces)
+	{
+		Con_Printf ("No solid edicts\n");
+		return;
+	}
+	Con_Printf ("%i edicts, %i area nodes, %i traces/pass\n", sv.num_edicts, sv_numareanodes, traces / passes);
+	Con_Printf ("vector: %7.3f us/trace, %7.3f us/pass\n", elapsed[0] * 1000000.0 / traces, elapsed[0] * 1000000.0 / passes);
+	Con_Printf ("scalar: %7.3f us/trace, %7.3f us/pass\n", elapsed[1] * 1000000.0 / traces, elapsed[1] * 1000000.0 / passes);
+	if (hits[0] != hits[1])
+		Con_Printf ("edict hits differ: %i vector, %i scalar\n", hits[0] / passes, hits[1] / passes);
+}
@@ -60,6 +60,14 @@ void SV_LinkEdict (edict_t *ent, qboolean touch_triggers);
 // sets ent->v.absmin and ent->v.absmax
 // if touchtriggers, calls prog functions for the intersected triggers
 
+#define	AREA_SOLID		1
+#define	AREA_TRIGGERS	2
+#define	AREA_NONSOLID	4
+
+int SV_AreaEdicts (const vec3_t mins, const vec3_t maxs, edict_t **list, int listspace, int areatype);
+// fills list with the linked edicts of the AREA_* kinds whose abs boxes touch
+// mins/maxs, returns the count.
+
 int SV_PointContents (vec3_t p);
 int SV_TruePointContents (vec3_t p);
 // returns the CONTENTS_* value from the world at the given point.
@@ -81,7 +89,53 @@ trace_t SV_Move (vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, e
 
 // passedict is explicitly excluded from clipping checks (normally NULL)
 
+void SV_BeginMoveBatch (edict_t *passedict, const vec3_t mins, const vec3_t maxs);
+void SV_EndMoveBatch (void);
+// until the matching end, SV_Move calls for passedict whose whole move
+// stays inside mins/maxs share one walk of the area tree.  results are
+// unchanged.
+
 qboolean SV_RecursiveHullCheck (hull_t *hull, int num, float p1f, float p2f, vec3_t p1, vec3_t p2, trace_t *trace);
+int SV_HullPointContents (hull_t *hull, int num, vec3_t p);
+
+void SV_MoveBench_f (void);
+void SV_TraceFuzz_f (void);
+
+void SV_InvalidateTraces (void);
+void SV_TraceStats_f (void);
+
+// moves traced ahead of time by the parallel physics phase
+#define	MAX_SPECTOUCH	8
+
+typedef struct
+{
+	int			edictnum;
+	int			owner;
+	float		fields[14];		// solid, movetype, modelindex, flags, size[0], origin, mins, maxs
+} spectouch_t;
+
+typedef struct
+{
+	vec3_t		start, end, mins, maxs;		// filled in by the caller
+	int			type;
+	edict_t		*passedict;
+
+	qboolean	valid;
+	int			splits;
+	int			passowner;
+	float		passsize;
+	int			numtouched;
+	spectouch_t	touched[MAX_SPECTOUCH];		// edicts the clip read, the world first
+	vec3_t		boxmins, boxmaxs;
+	trace_t		trace;
+} movespec_t;
+
+extern	qboolean	sv_speculating;
+
+void SV_SpeculateMove (movespec_t *spec);
+qboolean SV_SpeculatedMove (movespec_t *spec, vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, edict_t *passedict, trace_t *trace);
+void SV_BeginSpeculation (void);
+void SV_EndSpeculation (void);
 
 #endif	/* _QUAKE_WORLD_H */
 